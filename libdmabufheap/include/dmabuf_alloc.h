@@ -16,6 +16,8 @@
 #ifndef LIB_DMA_BUF_HEAP_H
 #define LIB_DMA_BUF_HEAP_H
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <linux/dma-buf.h>
 #include <linux/dma-heap.h>
@@ -35,6 +37,11 @@ typedef enum {
     DMA_BUF_HEAP_BUF_SYNC_WRITE = DMA_BUF_SYNC_WRITE,
 } DmabufHeapBufferSyncType;
 
+typedef struct {
+    uint64_t issued;            /* DMA_BUF_IOCTL_SYNC issued */
+    uint64_t elided;            /* syncs found redundant in the tracked mode */
+} DmabufHeapSyncStats;
+
 typedef struct {
     unsigned int fd;
     size_t size;
@@ -58,10 +65,39 @@ int DmabufHeapBufferAlloc(unsigned int heapFd, DmabufHeapBuffer *buffer);
 
 int DmabufHeapBufferFree(DmabufHeapBuffer *buffer);
 
+/*
+ * DmabufHeapBufferAllocBatch: allocate @count buffers, each of its own size and heapFlags.
+ * Either all of them are allocated or none is. Buffers of 1M or more are allocated in parallel.
+ * Each buffer is accounted on its own, it may be freed alone by DmabufHeapBufferFree().
+ */
+int DmabufHeapBufferAllocBatch(unsigned int heapFd, DmabufHeapBuffer *buffers, unsigned int count);
+
+int DmabufHeapBufferFreeBatch(DmabufHeapBuffer *buffers, unsigned int count);
+
+/*
+ * DmabufHeapImportMemfd: make a dma-buf of the @len bytes of @memfd from @offset by /dev/udmabuf,
+ * sharing the pages of @memfd without any copy. @offset and @len must be page aligned.
+ * @memfd is sealed with F_SEAL_SHRINK if it is not yet, as udmabuf requires, and may be closed
+ * after the import. @buffer->heapFlags keeps its owner id, the other fields are set.
+ * The buffer is synced and freed as an allocated one.
+ * Return:  0 if succ, -EINVAL for wrong args, or -errno, e.g. -ENOENT without /dev/udmabuf.
+ */
+int DmabufHeapImportMemfd(int memfd, size_t offset, size_t len, DmabufHeapBuffer *buffer);
+
 int DmabufHeapBufferSyncStart(unsigned int bufferFd, DmabufHeapBufferSyncType syncType);
 
 int DmabufHeapBufferSyncEnd(unsigned int bufferFd, DmabufHeapBufferSyncType syncType);
 
+/*
+ * In the tracked mode, the CPU access state of each buffer is kept, so that only its outermost
+ * start and end issue DMA_BUF_IOCTL_SYNC. A start nested in an access of the same or a wider
+ * type, e.g. READ inside RW, is elided; a wider one restarts the access with both types,
+ * and the outermost end ends all the types of the access.
+ */
+void DmabufHeapSetSyncTracking(bool enabled);
+
+int DmabufHeapGetSyncStats(DmabufHeapSyncStats *stats);
+
 #ifdef __cplusplus
 #if __cplusplus
 }
@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIB_DMA_BUF_HEAP_BUFFER_H
+#define LIB_DMA_BUF_HEAP_BUFFER_H
+
+#include <memory> /* shared_ptr */
+#include <utility> /* move */
+
+#include "dmabuf_alloc.h"
+#include "dmabuf_heap_registry.h"
+#include "dmabuf_map.h"
+#include "dmabuf_pool.h"
+
+namespace OHOS {
+namespace Dmabuf {
+/* Shared by a DmabufHeap and its buffers, so pooled buffers may outlive the DmabufHeap obj. */
+struct DmabufHeapState {
+    explicit DmabufHeapState(int heapFd) : fd(heapFd) {}
+
+    ~DmabufHeapState()
+    {
+        DmabufHeapPoolDestroy(pool);
+        if (fd >= 0) {
+            DmabufHeapRelease(static_cast<unsigned int>(fd));
+        }
+    }
+
+    DmabufHeapState(const DmabufHeapState&) = delete;
+    DmabufHeapState& operator = (const DmabufHeapState&) = delete;
+
+    int fd;
+    DmabufHeapPool *pool = nullptr;
+};
+
+/*
+ * Class DmabufBuffer owns the fd of a buffer and the CPU mapping taken by Map().
+ * It is move only. Its destruction unmaps the buffer and closes it, or gives it back to the
+ * pool of the DmabufHeap it was allocated from.
+ */
+class DmabufBuffer {
+public:
+    DmabufBuffer() = default;
+
+    ~DmabufBuffer()
+    {
+        Reset();
+    }
+
+    DmabufBuffer(DmabufBuffer &&other) noexcept
+    {
+        MoveFrom(other);
+    }
+
+    DmabufBuffer& operator = (DmabufBuffer &&other) noexcept
+    {
+        if (this != &other) {
+            Reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    DmabufBuffer(const DmabufBuffer&) = delete;
+    DmabufBuffer& operator = (const DmabufBuffer&) = delete;
+
+    bool IsValid() const
+    {
+        return valid_;
+    }
+
+    unsigned int GetFd() const
+    {
+        return buffer_.fd;
+    }
+
+    size_t GetSize() const
+    {
+        return buffer_.size;
+    }
+
+    const DmabufHeapBuffer &GetBuffer() const
+    {
+        return buffer_;
+    }
+
+    /* Return:  start address of the mapping kept until destruction, nullptr if it fails */
+    void *Map()
+    {
+        if (addr_ == nullptr && valid_) {
+            addr_ = DmabufHeapBufferMap(&buffer_);
+        }
+        return addr_;
+    }
+
+    /* unmap, then close the buffer or give it back to the pool */
+    void Reset()
+    {
+        if (!valid_) {
+            return;
+        }
+        if (addr_ != nullptr) {
+            DmabufHeapBufferUnmap(&buffer_);
+            addr_ = nullptr;
+        }
+        if (heap_ != nullptr && heap_->pool != nullptr) {
+            DmabufHeapPoolFree(heap_->pool, &buffer_);
+        } else {
+            DmabufHeapBufferFree(&buffer_);
+        }
+        heap_.reset();
+        valid_ = false;
+    }
+
+    /* give up the ownership, the caller frees the returned buffer by DmabufHeapBufferFree() */
+    DmabufHeapBuffer Release()
+    {
+        if (addr_ != nullptr) {
+            DmabufHeapBufferUnmap(&buffer_);
+            addr_ = nullptr;
+        }
+        heap_.reset();
+        valid_ = false;
+        return buffer_;
+    }
+
+private:
+    DmabufBuffer(const DmabufHeapBuffer &buffer, std::shared_ptr<DmabufHeapState> heap)
+        : buffer_(buffer), valid_(true), heap_(std::move(heap)) {}
+
+    void MoveFrom(DmabufBuffer &other)
+    {
+        buffer_ = other.buffer_;
+        valid_ = other.valid_;
+        addr_ = other.addr_;
+        heap_ = std::move(other.heap_);
+        other.valid_ = false;
+        other.addr_ = nullptr;
+    }
+
+    DmabufHeapBuffer buffer_ = {};
+    bool valid_ = false;
+    void *addr_ = nullptr;
+    std::shared_ptr<DmabufHeapState> heap_;
+    friend class DmabufHeap;
+};
+
+/*
+ * Class DmabufHeap is a handle of a heap of the process wide registry.
+ * Buffers are allocated from its pool once EnablePool() is called, and EnableRefill() keeps the
+ * pool topped up in the background.
+ */
+class DmabufHeap {
+public:
+    explicit DmabufHeap(const char *heapName)
+    {
+        int fd = DmabufHeapAcquire(heapName);
+        if (fd >= 0) {
+            state_ = std::make_shared<DmabufHeapState>(fd);
+        }
+    }
+
+    DmabufHeap(DmabufHeap &&other) noexcept = default;
+    DmabufHeap& operator = (DmabufHeap &&other) noexcept = default;
+    DmabufHeap(const DmabufHeap&) = delete;
+    DmabufHeap& operator = (const DmabufHeap&) = delete;
+
+    bool IsValid() const
+    {
+        return state_ != nullptr;
+    }
+
+    int GetFd() const
+    {
+        return (state_ != nullptr) ? state_->fd : -1;
+    }
+
+    /* Return:  false if the pool is enabled already or cannot be created */
+    bool EnablePool(const DmabufHeapPoolConfig *config = nullptr)
+    {
+        if (state_ == nullptr || state_->pool != nullptr) {
+            return false;
+        }
+        state_->pool = DmabufHeapPoolCreate(static_cast<unsigned int>(state_->fd), config);
+        return state_->pool != nullptr;
+    }
+
+    /* Return:  false if the pool is not enabled or its refiller cannot start */
+    bool EnableRefill(const DmabufHeapPoolRefillConfig *config = nullptr)
+    {
+        if (state_ == nullptr || state_->pool == nullptr) {
+            return false;
+        }
+        return DmabufHeapPoolStartRefill(state_->pool, config) == 0;
+    }
+
+    DmabufHeapPool *GetPool() const
+    {
+        return (state_ != nullptr) ? state_->pool : nullptr;
+    }
+
+    /* Return:  the allocated buffer, invalid if the allocation fails */
+    DmabufBuffer Alloc(size_t size, enum DmaHeapFlagOwnerId ownerId = DMA_OWNER_DEFAULT)
+    {
+        if (state_ == nullptr) {
+            return DmabufBuffer();
+        }
+        DmabufHeapBuffer buffer = { .fd = 0, .size = size, .heapFlags = 0 };
+        SetOwnerIdForHeapFlags(&buffer, ownerId);
+        int ret = (state_->pool != nullptr) ? DmabufHeapPoolAlloc(state_->pool, &buffer) :
+            DmabufHeapBufferAlloc(static_cast<unsigned int>(state_->fd), &buffer);
+        if (ret != 0) {
+            return DmabufBuffer();
+        }
+        return DmabufBuffer(buffer, (state_->pool != nullptr) ? state_ : nullptr);
+    }
+
+private:
+    std::shared_ptr<DmabufHeapState> state_;
+};
+
+/* Class ScopedCpuAccess maps @buffer and brackets the scope by exactly one sync start and end. */
+class ScopedCpuAccess {
+public:
+    ScopedCpuAccess(DmabufBuffer &buffer, DmabufHeapBufferSyncType syncType)
+        : buffer_(buffer), syncType_(syncType)
+    {
+        void *addr = buffer_.Map();
+        if (addr != nullptr && DmabufHeapBufferSyncStart(buffer_.GetFd(), syncType_) == 0) {
+            addr_ = addr;
+        }
+    }
+
+    ~ScopedCpuAccess()
+    {
+        if (addr_ != nullptr) {
+            DmabufHeapBufferSyncEnd(buffer_.GetFd(), syncType_);
+        }
+    }
+
+    ScopedCpuAccess(const ScopedCpuAccess&) = delete;
+    ScopedCpuAccess& operator = (const ScopedCpuAccess&) = delete;
+
+    bool IsValid() const
+    {
+        return addr_ != nullptr;
+    }
+
+    /* Return:  start address of the buffer, nullptr if the access failed to start */
+    void *GetAddr() const
+    {
+        return addr_;
+    }
+
+private:
+    DmabufBuffer &buffer_;
+    DmabufHeapBufferSyncType syncType_;
+    void *addr_ = nullptr;
+};
+} /* namespace Dmabuf */
+} /* namespace OHOS */
+#endif /* LIB_DMA_BUF_HEAP_BUFFER_H */
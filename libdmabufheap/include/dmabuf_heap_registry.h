@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIB_DMA_BUF_HEAP_REGISTRY_H
+#define LIB_DMA_BUF_HEAP_REGISTRY_H
+
+#include "dmabuf_alloc.h"
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif /* End of #if __cplusplus */
+#endif /* End of #ifdef __cplusplus */
+
+/*
+ * Process wide registry of the heaps under /dev/dma_heap/, enumerated once on first use.
+ * Each heap is opened once by its first DmabufHeapAcquire() and the fd is shared by all the
+ * users of the process, until the last DmabufHeapRelease().
+ * Once an emulated provider is selected, DMA_HEAP_PROVIDER_EMULATED_HEAP is listed as well.
+ */
+#define DMA_HEAP_REGISTRY_MAX_COUNT 32
+#define DMA_HEAP_REGISTRY_NAME_LEN 128
+
+/* capabilities, guessed from the conventional heap names, e.g. "system-uncached", "linux,cma" */
+#define DMA_HEAP_CAP_UNCACHED 0x1u
+#define DMA_HEAP_CAP_CONTIGUOUS 0x2u
+
+typedef struct {
+    char name[DMA_HEAP_REGISTRY_NAME_LEN + 1];
+    unsigned int caps;
+    unsigned int refCount;
+} DmabufHeapInfo;
+
+/* Return:  number of heaps found under /dev/dma_heap/, and of the emulated one */
+unsigned int DmabufHeapGetCount(void);
+
+/* Return:  0 if succ, -EINVAL if @index is out of range */
+int DmabufHeapGetInfo(unsigned int index, DmabufHeapInfo *info);
+
+/*
+ * DmabufHeapAcquire: get the shared fd of heap @heapName, opened on the first call.
+ * The fd must be given back by DmabufHeapRelease(), never by DmabufHeapClose().
+ * Return:  fd of the heap, -ENOENT if no such heap, or the error of DmabufHeapOpen().
+ * The provider of a heap is the one selected when it is opened.
+ */
+int DmabufHeapAcquire(const char *heapName);
+
+/* Return:  0 if succ, -EINVAL if @heapFd is not acquired */
+int DmabufHeapRelease(unsigned int heapFd);
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* End of #if __cplusplus */
+#endif /* End of #ifdef __cplusplus */
+
+#endif /* LIB_DMA_BUF_HEAP_REGISTRY_H */
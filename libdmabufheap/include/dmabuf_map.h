@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIB_DMA_BUF_HEAP_MAP_H
+#define LIB_DMA_BUF_HEAP_MAP_H
+
+#include <stdbool.h>
+#include "dmabuf_alloc.h"
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif /* End of #if __cplusplus */
+#endif /* End of #ifdef __cplusplus */
+
+/*
+ * CPU mappings of buffers, cached per buffer fd: the first DmabufHeapBufferMap() mmaps the
+ * buffer, later ones only take a reference, and the last DmabufHeapBufferUnmap() munmaps it
+ * unless the mapping is persistent. DmabufHeapBufferFree() drops the mapping of the buffer.
+ * A mapping does not make CPU access coherent, each access is still bracketed by
+ * DmabufHeapBufferSyncStart() and DmabufHeapBufferSyncEnd(), or done between
+ * DmabufHeapBufferBeginCpuAccess() and DmabufHeapBufferEndCpuAccess().
+ */
+
+/* Return:  start address of the mapping, NULL if @buffer cannot be mapped */
+void *DmabufHeapBufferMap(const DmabufHeapBuffer *buffer);
+
+/* Return:  0 if succ, -EINVAL if @buffer is not mapped */
+int DmabufHeapBufferUnmap(const DmabufHeapBuffer *buffer);
+
+/* keep the mapping of @buffer after its last unmap, until it is freed, e.g. for pooled buffers */
+int DmabufHeapBufferSetPersistentMap(const DmabufHeapBuffer *buffer, bool persistent);
+
+/* map @buffer and start a CPU access of @syncType, NULL if either fails */
+void *DmabufHeapBufferBeginCpuAccess(const DmabufHeapBuffer *buffer, DmabufHeapBufferSyncType syncType);
+
+/* end the CPU access of @syncType and unmap @buffer */
+int DmabufHeapBufferEndCpuAccess(const DmabufHeapBuffer *buffer, DmabufHeapBufferSyncType syncType);
+
+/* munmap the cached mapping of @fd, must be called before @fd is closed other than by this library */
+void DmabufHeapBufferDropMap(unsigned int fd);
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* End of #if __cplusplus */
+#endif /* End of #ifdef __cplusplus */
+
+#endif /* LIB_DMA_BUF_HEAP_MAP_H */
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIB_DMA_BUF_HEAP_POOL_H
+#define LIB_DMA_BUF_HEAP_POOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "dmabuf_alloc.h"
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif /* End of #if __cplusplus */
+#endif /* End of #ifdef __cplusplus */
+
+/*
+ * A DmabufHeapPool keeps the buffers freed to it and hands them back to later allocations
+ * of the same size class and heapFlags (including the owner id), without any syscall.
+ * Size classes are the page rounded sizes, so buffers of 1000 and 4096 bytes share a class.
+ * Each thread frees to and allocates from its own magazine first, without any lock; the
+ * per class depot behind the magazines is locked. When both are empty, an allocation takes
+ * the buffers freed to the magazines of other threads.
+ * A recycled buffer keeps the content written by its previous user in this process.
+ */
+typedef struct DmabufHeapPool DmabufHeapPool;
+
+typedef struct {
+    unsigned int lowWatermark;  /* buffers of each class kept by DmabufHeapPoolTrim() */
+    unsigned int highWatermark; /* buffers of each class cached at most, more frees close the buffer */
+    bool persistentMap;         /* keep the CPU mapping of each buffer while it is pooled */
+} DmabufHeapPoolConfig;
+
+typedef struct {
+    uint64_t hits;              /* allocations served from the pool */
+    uint64_t misses;            /* allocations done by DMA_HEAP_IOCTL_ALLOC */
+    uint64_t cachedBuffers;
+    uint64_t cachedBytes;
+    uint64_t refilled;          /* buffers allocated by the refiller */
+} DmabufHeapPoolStats;
+
+typedef struct {
+    unsigned int intervalMs;    /* period of the demand sampling and the refill */
+    unsigned int minAvailableKb; /* no refill while MemAvailable is below it, 0 to refill always */
+} DmabufHeapPoolRefillConfig;
+
+/* @heapFd is not owned and must stay open until the pool is destroyed, @config NULL for defaults */
+DmabufHeapPool *DmabufHeapPoolCreate(unsigned int heapFd, const DmabufHeapPoolConfig *config);
+
+/* close all the cached buffers, no other call on @pool may be in progress */
+void DmabufHeapPoolDestroy(DmabufHeapPool *pool);
+
+/* same as DmabufHeapBufferAlloc(), @buffer->size and @buffer->heapFlags select the class */
+int DmabufHeapPoolAlloc(DmabufHeapPool *pool, DmabufHeapBuffer *buffer);
+
+/*
+ * DmabufHeapPoolAllocBatch: allocate @count buffers, from the pool first, the others by
+ * DmabufHeapBufferAllocBatch(). Either all of them are allocated or none is.
+ * Each buffer is given back by DmabufHeapPoolFree(), or freed as any other buffer without caching it.
+ */
+int DmabufHeapPoolAllocBatch(DmabufHeapPool *pool, DmabufHeapBuffer *buffers, unsigned int count);
+
+/* give @buffer back to @pool, it is closed if its class already caches highWatermark buffers */
+int DmabufHeapPoolFree(DmabufHeapPool *pool, DmabufHeapBuffer *buffer);
+
+/*
+ * DmabufHeapPoolReserve: allocate buffers of the class of @size and @heapFlags until it caches
+ * @count buffers, at most highWatermark, e.g. before a resolution switch.
+ * Return:  0 if succ, or the error of DmabufHeapBufferAlloc().
+ */
+int DmabufHeapPoolReserve(DmabufHeapPool *pool, size_t size, __u64 heapFlags, unsigned int count);
+
+/*
+ * DmabufHeapPoolTrim: close the cached buffers above lowWatermark in each class,
+ * including those in the magazines of all threads.
+ * Return:  number of buffers closed.
+ */
+unsigned int DmabufHeapPoolTrim(DmabufHeapPool *pool);
+
+/*
+ * DmabufHeapPoolStartRefill: start a low priority thread which tops up each class of @pool
+ * in the background, so allocations do not wait in DMA_HEAP_IOCTL_ALLOC.
+ * Each period, the target depth of a class is predicted from its allocations in the recent
+ * periods, at most highWatermark. A miss wakes the thread before the end of the period.
+ * The refill stops as soon as MemAvailable is below @config->minAvailableKb.
+ * @config NULL for defaults.
+ * Return:  0 if succ, -EBUSY if the refiller runs already.
+ */
+int DmabufHeapPoolStartRefill(DmabufHeapPool *pool, const DmabufHeapPoolRefillConfig *config);
+
+/* stop the refiller and wait for its exit, the cached buffers are kept; also done by destroy */
+void DmabufHeapPoolStopRefill(DmabufHeapPool *pool);
+
+int DmabufHeapPoolGetStats(DmabufHeapPool *pool, DmabufHeapPoolStats *stats);
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* End of #if __cplusplus */
+#endif /* End of #ifdef __cplusplus */
+
+#endif /* LIB_DMA_BUF_HEAP_POOL_H */
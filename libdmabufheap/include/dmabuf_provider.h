@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIB_DMA_BUF_HEAP_PROVIDER_H
+#define LIB_DMA_BUF_HEAP_PROVIDER_H
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif /* End of #if __cplusplus */
+#endif /* End of #ifdef __cplusplus */
+
+/*
+ * The provider makes the heaps opened by DmabufHeapOpen() and the buffers allocated from them.
+ * The emulated providers serve a single heap, DMA_HEAP_PROVIDER_EMULATED_HEAP, so the library,
+ * its pools, mappings and syncs can run on hosts without /dev/dma_heap, e.g. in CI.
+ * They ignore heapFlags.
+ */
+#define DMA_HEAP_PROVIDER_EMULATED_HEAP "system"
+
+typedef enum {
+    DMA_HEAP_PROVIDER_KERNEL,   /* /dev/dma_heap/<name>, the default */
+    DMA_HEAP_PROVIDER_UDMABUF,  /* real dma-bufs made by /dev/udmabuf from memfd pages */
+    DMA_HEAP_PROVIDER_MEMFD,    /* sealed memfds, not dma-bufs, their syncs do nothing */
+    DMA_HEAP_PROVIDER_EMULATED, /* UDMABUF if /dev/udmabuf can be opened, else MEMFD */
+} DmabufHeapProviderType;
+
+/*
+ * DmabufHeapSetProvider: select the provider of the heaps opened later, the heaps opened
+ * before keep theirs until DmabufHeapClose().
+ * Return:  0 if succ, -EINVAL for an unknown type, or the error of opening /dev/udmabuf.
+ */
+int DmabufHeapSetProvider(DmabufHeapProviderType type);
+
+/* Return:  the selected provider, DMA_HEAP_PROVIDER_EMULATED is never returned */
+DmabufHeapProviderType DmabufHeapGetProvider(void);
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* End of #if __cplusplus */
+#endif /* End of #ifdef __cplusplus */
+
+#endif /* LIB_DMA_BUF_HEAP_PROVIDER_H */
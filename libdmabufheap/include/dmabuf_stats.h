@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIB_DMA_BUF_HEAP_STATS_H
+#define LIB_DMA_BUF_HEAP_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "dmabuf_alloc.h"
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif /* End of #if __cplusplus */
+#endif /* End of #ifdef __cplusplus */
+
+/*
+ * Counters of the buffers allocated by this library in the calling process, per heap and
+ * per owner id of heapFlags. A buffer counts from its DMA_HEAP_IOCTL_ALLOC until it is closed,
+ * so buffers cached by a DmabufHeapPool count as live.
+ * Heaps are known by the names given to DmabufHeapOpen(), heap 0 counts the buffers
+ * allocated from fds opened otherwise.
+ */
+#define DMA_HEAP_STATS_MAX_HEAPS 8
+#define DMA_HEAP_STATS_NAME_LEN 32
+#define DMA_HEAP_STATS_HISTOGRAM_BUCKETS 16 /* bucket i counts sizes up to 4K << i, the last one also bigger ones */
+
+typedef struct {
+    uint64_t liveBytes;
+    uint64_t liveBuffers;
+    uint64_t allocCount;        /* ever allocated */
+    uint64_t allocBytes;        /* ever allocated */
+} DmabufHeapCounters;
+
+typedef struct {
+    uint64_t timeNs;            /* CLOCK_MONOTONIC, allocation rates are deltas between two snapshots */
+    unsigned int heapCount;
+    char heapNames[DMA_HEAP_STATS_MAX_HEAPS][DMA_HEAP_STATS_NAME_LEN];
+    DmabufHeapCounters heaps[DMA_HEAP_STATS_MAX_HEAPS];
+    char ownerNames[COUNT_DMA_OWNER][DMA_HEAP_STATS_NAME_LEN]; /* indexed by DmaHeapFlagOwnerId */
+    DmabufHeapCounters owners[COUNT_DMA_OWNER];
+    uint64_t sizeHistogram[DMA_HEAP_STATS_HISTOGRAM_BUCKETS]; /* allocations ever done, by size */
+} DmabufHeapStatsSnapshot;
+
+/* Return:  0 if succ, -EINVAL if @snapshot is NULL */
+int DmabufHeapGetStatsSnapshot(DmabufHeapStatsSnapshot *snapshot);
+
+/* name each new buffer "<heap name>:<owner>" by DMA_BUF_SET_NAME, shown in the dma-buf debug info */
+void DmabufHeapSetBufferNaming(bool enabled);
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* End of #if __cplusplus */
+#endif /* End of #ifdef __cplusplus */
+
+#endif /* LIB_DMA_BUF_HEAP_STATS_H */
@@ -15,20 +15,54 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <sys/ioctl.h>
 #include "securec.h"
 #include "hilog/log.h"
 #include "dmabuf_alloc.h"
+#include "dmabuf_map.h"
+#include "dmabuf_provider_inner.h"
+#include "dmabuf_stats_inner.h"
+#include "dmabuf_sync_inner.h"
 #include "memory_trace.h"
 
 #define DMA_BUF_HEAP_ROOT "/dev/dma_heap/"
 #define HEAP_ROOT_LEN strlen(DMA_BUF_HEAP_ROOT)
 #define HEAP_NAME_MAX_LEN 128
 #define HEAP_PATH_LEN (HEAP_ROOT_LEN + HEAP_NAME_MAX_LEN + 1)
+#define BATCH_PARALLEL_MIN_SIZE (1024 * 1024)
+#define BATCH_MAX_THREADS 4
+#define SYNC_TABLE_MIN_CAPACITY 64
+
+typedef struct {
+    unsigned int heapFd;
+    DmabufHeapBuffer *buffers;
+    unsigned int count;
+    bool *allocated;
+    _Atomic unsigned int next;
+    _Atomic int ret;
+} BatchAllocTask;
+
+typedef struct {
+    unsigned int mode;          /* DMA_BUF_SYNC_READ/WRITE bits of the ongoing CPU access */
+    unsigned int depth;         /* nesting depth of the ongoing CPU access, 0 if none */
+    bool busy;                  /* a start or end ioctl of the buffer is in progress */
+} SyncState;
+
+static _Atomic bool g_syncTracking = false;
+static _Atomic uint64_t g_syncIssued = 0;
+static _Atomic uint64_t g_syncElided = 0;
+static pthread_mutex_t g_syncTableLock = PTHREAD_MUTEX_INITIALIZER;
+/* the ioctl is issued without any lock, a transition of a busy buffer waits here for it */
+static pthread_cond_t g_syncIdleCond = PTHREAD_COND_INITIALIZER;
+static SyncState *g_syncStates = NULL; /* indexed by buffer fd */
+static unsigned int g_syncCapacity = 0;
 
 static bool IsHeapNameValid(const char *heapName)
 {
@@ -54,6 +88,16 @@ static bool IsSyncTypeValid(DmabufHeapBufferSyncType syncType)
     }
 }
 
+/*
+ * Each buffer is recorded by its fd, as a heap is, so the record matches whichever free closes it,
+ * e.g. a buffer of a batch freed alone, or a pool buffer closed from the cache.
+ */
+static void TraceBuffer(unsigned int fd, size_t size, bool isUsing)
+{
+    long newFd = fd;
+    memtrace((void *)newFd, size, "DmabufHeap", isUsing);
+}
+
 void SetOwnerIdForHeapFlags(DmabufHeapBuffer *buffer, enum DmaHeapFlagOwnerId ownerId)
 {
     if (buffer) {
@@ -61,25 +105,33 @@ void SetOwnerIdForHeapFlags(DmabufHeapBuffer *buffer, enum DmaHeapFlagOwnerId ow
     }
 }
 
-int DmabufHeapOpen(const char *heapName)
+static int OpenKernelHeap(const char *heapName)
 {
-    if (!IsHeapNameValid(heapName)) {
-        HILOG_ERROR(LOG_CORE, "heapName is wrong, name = %s.", (heapName == NULL) ? "NULL" : heapName);
-        return -EINVAL;
-    }
     char heapPath[HEAP_PATH_LEN] = DMA_BUF_HEAP_ROOT;
     errno_t ret = strcat_s(heapPath, HEAP_PATH_LEN, heapName);
     if (ret != EOK) {
         HILOG_ERROR(LOG_CORE, "strcat_s is wrong, heapName = %s, ret = %d.", heapName, ret);
         return -EINVAL;
     }
-    int fd = open(heapPath, O_RDONLY | O_CLOEXEC);
+    return open(heapPath, O_RDONLY | O_CLOEXEC);
+}
+
+int DmabufHeapOpen(const char *heapName)
+{
+    if (!IsHeapNameValid(heapName)) {
+        HILOG_ERROR(LOG_CORE, "heapName is wrong, name = %s.", (heapName == NULL) ? "NULL" : heapName);
+        return -EINVAL;
+    }
+    const DmabufHeapProviderOps *ops = DmabufProviderGetSelected();
+    int fd = (ops != NULL) ? ops->openHeap(heapName) : OpenKernelHeap(heapName);
     if (fd < 0) {
         HILOG_ERROR(LOG_CORE, "file open faild, heapName = %s, errno = %d.", heapName, errno);
         return fd;
     }
+    DmabufProviderOnHeapOpen(fd, ops);
     long newFd = fd;
     memtrace((void *)newFd, HEAP_NAME_MAX_LEN, "DmabufHeap", true);
+    DmabufStatsOnHeapOpen(fd, heapName);
     return fd;
 }
 
@@ -87,9 +139,38 @@ int DmabufHeapClose(unsigned int fd)
 {
     long newFd = fd;
     memtrace((void *)newFd, HEAP_NAME_MAX_LEN, "DmabufHeap", false);
+    DmabufStatsOnHeapClose(fd);
+    DmabufProviderOnHeapClose(fd);
     return close(fd);
 }
 
+static int AllocBuffer(unsigned int heapFd, DmabufHeapBuffer *buffer)
+{
+    const DmabufHeapProviderOps *ops = DmabufProviderFind(heapFd);
+    if (ops != NULL) {
+        int ret = ops->allocBuffer(heapFd, buffer);
+        if (ret < 0) {
+            HILOG_ERROR(LOG_CORE, "alloc emulated buffer failed, size = %zu, ret = %d.", buffer->size, ret);
+            return ret;
+        }
+        DmabufStatsOnAlloc(heapFd, buffer);
+        return ret;
+    }
+    struct dma_heap_allocation_data data = {
+        .len = buffer->size,
+        .fd_flags = O_RDWR | O_CLOEXEC,
+        .heap_flags = buffer->heapFlags,
+    };
+    int ret = ioctl(heapFd, DMA_HEAP_IOCTL_ALLOC, &data);
+    if (ret < 0) {
+        HILOG_ERROR(LOG_CORE, "alloc buffer failed, size = %zu, ret = %d.", buffer->size, ret);
+        return ret;
+    }
+    buffer->fd = data.fd;
+    DmabufStatsOnAlloc(heapFd, buffer);
+    return ret;
+}
+
 int DmabufHeapBufferAlloc(unsigned int heapFd, DmabufHeapBuffer *buffer)
 {
     if (buffer == NULL) {
@@ -101,35 +182,281 @@ int DmabufHeapBufferAlloc(unsigned int heapFd, DmabufHeapBuffer *buffer)
         return -EINVAL;
     }
 
-    struct dma_heap_allocation_data data = {
-        .len = buffer->size,
-        .fd_flags = O_RDWR | O_CLOEXEC,
-        .heap_flags = buffer->heapFlags,
-    };
-    int ret = ioctl(heapFd, DMA_HEAP_IOCTL_ALLOC, &data);
+    int ret = AllocBuffer(heapFd, buffer);
     if (ret < 0) {
-        HILOG_ERROR(LOG_CORE, "alloc buffer failed, size = %zu, ret = %d.", buffer->size, ret);
         return ret;
     }
-    memtrace((void *)buffer, buffer->size, "DmabufHeap", true);
-    buffer->fd = data.fd;
+    TraceBuffer(buffer->fd, buffer->size, true);
+    return ret;
+}
+
+static void *BatchAllocWorker(void *arg)
+{
+    BatchAllocTask *task = (BatchAllocTask *)arg;
+    while (atomic_load_explicit(&task->ret, memory_order_relaxed) == 0) {
+        unsigned int i = atomic_fetch_add_explicit(&task->next, 1, memory_order_relaxed);
+        if (i >= task->count) {
+            break;
+        }
+        int ret = AllocBuffer(task->heapFd, &task->buffers[i]);
+        if (ret < 0) {
+            int expected = 0;
+            atomic_compare_exchange_strong(&task->ret, &expected, ret);
+            break;
+        }
+        task->allocated[i] = true;
+    }
+    return NULL;
+}
+
+int DmabufHeapBufferAllocBatch(unsigned int heapFd, DmabufHeapBuffer *buffers, unsigned int count)
+{
+    if (buffers == NULL || count == 0) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: buffers is NULL or count is 0!", __func__);
+        return -EINVAL;
+    }
+    size_t minSize = SIZE_MAX;
+    for (unsigned int i = 0; i < count; i++) {
+        if (buffers[i].size == 0) {
+            HILOG_ERROR(LOG_CORE, "alloc buffer size is wrong, index = %u.", i);
+            return -EINVAL;
+        }
+        minSize = (buffers[i].size < minSize) ? buffers[i].size : minSize;
+    }
+    BatchAllocTask task = { .heapFd = heapFd, .buffers = buffers, .count = count };
+    task.allocated = (bool *)calloc(count, sizeof(bool));
+    if (task.allocated == NULL) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: calloc fail", __func__);
+        return -ENOMEM;
+    }
+    atomic_init(&task.next, 0);
+    atomic_init(&task.ret, 0);
+
+    /* the kernel zeroes every page it allocates, large buffers are worth a few helper threads */
+    pthread_t helpers[BATCH_MAX_THREADS - 1];
+    unsigned int helperCount = 0;
+    if (minSize >= BATCH_PARALLEL_MIN_SIZE) {
+        unsigned int wanted = (count < BATCH_MAX_THREADS) ? count - 1 : BATCH_MAX_THREADS - 1;
+        while (helperCount < wanted && pthread_create(&helpers[helperCount], NULL, BatchAllocWorker, &task) == 0) {
+            helperCount++;
+        }
+    }
+    BatchAllocWorker(&task);
+    for (unsigned int i = 0; i < helperCount; i++) {
+        pthread_join(helpers[i], NULL);
+    }
+
+    int ret = atomic_load(&task.ret);
+    if (ret < 0) {
+        for (unsigned int i = 0; i < count; i++) {
+            if (task.allocated[i]) {
+                DmabufStatsOnFree(buffers[i].fd);
+                close(buffers[i].fd);
+            }
+        }
+    } else {
+        for (unsigned int i = 0; i < count; i++) {
+            TraceBuffer(buffers[i].fd, buffers[i].size, true);
+        }
+    }
+    free(task.allocated);
     return ret;
 }
 
+static int SyncIoctl(unsigned int fd, __u64 flags)
+{
+    struct dma_buf_sync sync = {0};
+    sync.flags = flags;
+    atomic_fetch_add_explicit(&g_syncIssued, 1, memory_order_relaxed);
+    int ret = ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync);
+    if (ret < 0 && errno == ENOTTY && DmabufProviderIsCpuOnlyBuffer(fd)) {
+        return 0; /* a buffer of the memfd provider is coherent, there is nothing to sync */
+    }
+    return ret;
+}
+
+static SyncState *GetSyncStateLocked(unsigned int fd, bool create)
+{
+    if (fd < g_syncCapacity) {
+        return &g_syncStates[fd];
+    }
+    if (!create) {
+        return NULL;
+    }
+    unsigned int capacity = (g_syncCapacity == 0) ? SYNC_TABLE_MIN_CAPACITY : g_syncCapacity;
+    while (capacity <= fd) {
+        capacity *= 2; /* 2: grow by doubling */
+    }
+    SyncState *states = (SyncState *)realloc(g_syncStates, capacity * sizeof(SyncState));
+    if (states == NULL) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: realloc fail", __func__);
+        return NULL;
+    }
+    (void)memset_s(states + g_syncCapacity, (capacity - g_syncCapacity) * sizeof(SyncState), 0,
+        (capacity - g_syncCapacity) * sizeof(SyncState));
+    g_syncStates = states;
+    g_syncCapacity = capacity;
+    return &g_syncStates[fd];
+}
+
+/* called with g_syncTableLock held, return the state of @fd once no ioctl of it is in progress */
+static SyncState *WaitSyncIdleLocked(unsigned int fd)
+{
+    SyncState *state = GetSyncStateLocked(fd, false);
+    while (state != NULL && state->busy) {
+        pthread_cond_wait(&g_syncIdleCond, &g_syncTableLock);
+        state = GetSyncStateLocked(fd, false); /* the table may have been reallocated */
+    }
+    return state;
+}
+
+void DmabufSyncResetState(unsigned int fd)
+{
+    pthread_mutex_lock(&g_syncTableLock);
+    SyncState *state = WaitSyncIdleLocked(fd);
+    if (state != NULL) {
+        state->mode = 0;
+        state->depth = 0;
+    }
+    pthread_mutex_unlock(&g_syncTableLock);
+}
+
 int DmabufHeapBufferFree(DmabufHeapBuffer *buffer)
 {
     if (buffer == NULL) {
         HILOG_ERROR(LOG_CORE, "%{public}s: buffer is NULL!", __func__);
         return -EINVAL;
     }
-    memtrace((void *)buffer, buffer->size, "DmabufHeap", false);
     if (buffer->fd < 0) {
         HILOG_ERROR(LOG_CORE, "%{public}s: Invalid file descriptor!", __func__);
         return -EINVAL;
     }
+    TraceBuffer(buffer->fd, buffer->size, false);
+    DmabufHeapBufferDropMap(buffer->fd);
+    DmabufSyncResetState(buffer->fd);
+    DmabufStatsOnFree(buffer->fd);
     return close(buffer->fd);
 }
 
+int DmabufHeapBufferFreeBatch(DmabufHeapBuffer *buffers, unsigned int count)
+{
+    if (buffers == NULL || count == 0) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: buffers is NULL or count is 0!", __func__);
+        return -EINVAL;
+    }
+    int ret = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        TraceBuffer(buffers[i].fd, buffers[i].size, false);
+        DmabufHeapBufferDropMap(buffers[i].fd);
+        DmabufSyncResetState(buffers[i].fd);
+        DmabufStatsOnFree(buffers[i].fd);
+        if (close(buffers[i].fd) < 0 && ret == 0) {
+            ret = -errno;
+        }
+    }
+    return ret;
+}
+
+int DmabufHeapImportMemfd(int memfd, size_t offset, size_t len, DmabufHeapBuffer *buffer)
+{
+    size_t pageMask = (size_t)sysconf(_SC_PAGESIZE) - 1;
+    if (buffer == NULL || memfd < 0 || len == 0 || (offset & pageMask) != 0 || (len & pageMask) != 0) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: buffer is NULL, or memfd, offset or len is wrong!", __func__);
+        return -EINVAL;
+    }
+    int fd = DmabufProviderImportMemfd(memfd, offset, len);
+    if (fd < 0) {
+        return fd;
+    }
+    buffer->fd = (unsigned int)fd;
+    buffer->size = len;
+    DmabufStatsOnAlloc((unsigned int)DmabufProviderGetImportDev(), buffer);
+    TraceBuffer(buffer->fd, buffer->size, true);
+    return 0;
+}
+
+/* a nested start covered by the ongoing access, e.g. READ inside RW, only deepens it */
+static int TrackedSyncStart(unsigned int fd, unsigned int syncType)
+{
+    pthread_mutex_lock(&g_syncTableLock);
+    SyncState *state = (GetSyncStateLocked(fd, true) != NULL) ? WaitSyncIdleLocked(fd) : NULL;
+    if (state == NULL) {
+        pthread_mutex_unlock(&g_syncTableLock);
+        return SyncIoctl(fd, DMA_BUF_SYNC_START | syncType);
+    }
+    if (state->depth > 0 && (state->mode | syncType) == state->mode) {
+        state->depth++;
+        pthread_mutex_unlock(&g_syncTableLock);
+        atomic_fetch_add_explicit(&g_syncElided, 1, memory_order_relaxed);
+        return 0;
+    }
+    /* widen the ongoing access, e.g. READ then WRITE becomes RW */
+    unsigned int mode = state->mode | syncType;
+    state->busy = true;
+    pthread_mutex_unlock(&g_syncTableLock);
+
+    int ret = SyncIoctl(fd, DMA_BUF_SYNC_START | mode);
+
+    pthread_mutex_lock(&g_syncTableLock);
+    state = GetSyncStateLocked(fd, false);
+    state->busy = false;
+    if (ret == 0) {
+        state->mode = mode;
+        state->depth++;
+    }
+    pthread_cond_broadcast(&g_syncIdleCond);
+    pthread_mutex_unlock(&g_syncTableLock);
+    return ret;
+}
+
+/* only the end of the outermost access is issued, for all the access types of its nesting */
+static int TrackedSyncEnd(unsigned int fd, unsigned int syncType)
+{
+    pthread_mutex_lock(&g_syncTableLock);
+    SyncState *state = WaitSyncIdleLocked(fd);
+    if (state == NULL || state->depth == 0) {
+        pthread_mutex_unlock(&g_syncTableLock);
+        /* an end without start is issued as is, as in the untracked mode */
+        return SyncIoctl(fd, DMA_BUF_SYNC_END | syncType);
+    }
+    if (state->depth > 1) {
+        state->depth--;
+        pthread_mutex_unlock(&g_syncTableLock);
+        atomic_fetch_add_explicit(&g_syncElided, 1, memory_order_relaxed);
+        return 0;
+    }
+    unsigned int mode = state->mode;
+    state->busy = true;
+    pthread_mutex_unlock(&g_syncTableLock);
+
+    int ret = SyncIoctl(fd, DMA_BUF_SYNC_END | mode);
+
+    pthread_mutex_lock(&g_syncTableLock);
+    state = GetSyncStateLocked(fd, false);
+    state->busy = false;
+    state->depth = 0;
+    state->mode = 0;
+    pthread_cond_broadcast(&g_syncIdleCond);
+    pthread_mutex_unlock(&g_syncTableLock);
+    return ret;
+}
+
+void DmabufHeapSetSyncTracking(bool enabled)
+{
+    atomic_store_explicit(&g_syncTracking, enabled, memory_order_relaxed);
+}
+
+int DmabufHeapGetSyncStats(DmabufHeapSyncStats *stats)
+{
+    if (stats == NULL) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: stats is NULL!", __func__);
+        return -EINVAL;
+    }
+    stats->issued = atomic_load_explicit(&g_syncIssued, memory_order_relaxed);
+    stats->elided = atomic_load_explicit(&g_syncElided, memory_order_relaxed);
+    return 0;
+}
+
 int DmabufHeapBufferSyncStart(unsigned int fd, DmabufHeapBufferSyncType syncType)
 {
     if (!IsSyncTypeValid(syncType)) {
@@ -137,9 +464,10 @@ int DmabufHeapBufferSyncStart(unsigned int fd, DmabufHeapBufferSyncType syncType
         return -EINVAL;
     }
 
-    struct dma_buf_sync sync = {0};
-    sync.flags = DMA_BUF_SYNC_START | syncType;
-    return ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync);
+    if (atomic_load_explicit(&g_syncTracking, memory_order_relaxed)) {
+        return TrackedSyncStart(fd, (unsigned int)syncType);
+    }
+    return SyncIoctl(fd, DMA_BUF_SYNC_START | syncType);
 }
 
 int DmabufHeapBufferSyncEnd(unsigned int fd, DmabufHeapBufferSyncType syncType)
@@ -149,7 +477,8 @@ int DmabufHeapBufferSyncEnd(unsigned int fd, DmabufHeapBufferSyncType syncType)
         return -EINVAL;
     }
 
-    struct dma_buf_sync sync = {0};
-    sync.flags = DMA_BUF_SYNC_END | syncType;
-    return ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync);
+    if (atomic_load_explicit(&g_syncTracking, memory_order_relaxed)) {
+        return TrackedSyncEnd(fd, (unsigned int)syncType);
+    }
+    return SyncIoctl(fd, DMA_BUF_SYNC_END | syncType);
 }
\ No newline at end of file
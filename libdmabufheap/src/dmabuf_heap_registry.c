@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
+#include "securec.h"
+#include "hilog/log.h"
+#include "dmabuf_heap_registry.h"
+#include "dmabuf_provider.h"
+
+#define DMA_BUF_HEAP_ROOT "/dev/dma_heap/"
+
+typedef struct {
+    DmabufHeapInfo info;
+    int fd;                     /* valid while info.refCount > 0 */
+} HeapEntry;
+
+static pthread_once_t g_scanOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t g_heapsLock = PTHREAD_MUTEX_INITIALIZER;
+static HeapEntry g_heaps[DMA_HEAP_REGISTRY_MAX_COUNT];
+static unsigned int g_heapCount = 0; /* only grows, by the scan and the emulated heap */
+static bool g_emulatedAdded = false;
+
+static unsigned int GuessCaps(const char *name)
+{
+    unsigned int caps = 0;
+    if (strstr(name, "uncached") != NULL) {
+        caps |= DMA_HEAP_CAP_UNCACHED;
+    }
+    if (strstr(name, "cma") != NULL || strstr(name, "contig") != NULL) {
+        caps |= DMA_HEAP_CAP_CONTIGUOUS;
+    }
+    return caps;
+}
+
+static void ScanHeaps(void)
+{
+    DIR *dir = opendir(DMA_BUF_HEAP_ROOT);
+    if (dir == NULL) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: open %{public}s fail, errno = %d.", __func__, DMA_BUF_HEAP_ROOT, errno);
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && g_heapCount < DMA_HEAP_REGISTRY_MAX_COUNT) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        HeapEntry *heap = &g_heaps[g_heapCount];
+        if (strcpy_s(heap->info.name, sizeof(heap->info.name), entry->d_name) != EOK) {
+            continue;
+        }
+        heap->info.caps = GuessCaps(entry->d_name);
+        heap->info.refCount = 0;
+        heap->fd = -1;
+        g_heapCount++;
+    }
+    closedir(dir);
+}
+
+static HeapEntry *FindHeapByName(const char *heapName)
+{
+    for (unsigned int i = 0; i < g_heapCount; i++) {
+        if (strcmp(g_heaps[i].info.name, heapName) == 0) {
+            return &g_heaps[i];
+        }
+    }
+    return NULL;
+}
+
+/* list the heap of the emulated providers once one is selected, unless the kernel has it too */
+static void AddEmulatedHeapLocked(void)
+{
+    if (g_emulatedAdded || DmabufHeapGetProvider() == DMA_HEAP_PROVIDER_KERNEL) {
+        return;
+    }
+    g_emulatedAdded = true;
+    if (FindHeapByName(DMA_HEAP_PROVIDER_EMULATED_HEAP) != NULL || g_heapCount == DMA_HEAP_REGISTRY_MAX_COUNT) {
+        return;
+    }
+    HeapEntry *heap = &g_heaps[g_heapCount];
+    (void)strcpy_s(heap->info.name, sizeof(heap->info.name), DMA_HEAP_PROVIDER_EMULATED_HEAP);
+    heap->info.caps = 0;
+    heap->info.refCount = 0;
+    heap->fd = -1;
+    g_heapCount++;
+}
+
+static HeapEntry *FindHeapByFd(unsigned int heapFd)
+{
+    for (unsigned int i = 0; i < g_heapCount; i++) {
+        if (g_heaps[i].info.refCount > 0 && (unsigned int)g_heaps[i].fd == heapFd) {
+            return &g_heaps[i];
+        }
+    }
+    return NULL;
+}
+
+unsigned int DmabufHeapGetCount(void)
+{
+    pthread_once(&g_scanOnce, ScanHeaps);
+    pthread_mutex_lock(&g_heapsLock);
+    AddEmulatedHeapLocked();
+    unsigned int count = g_heapCount;
+    pthread_mutex_unlock(&g_heapsLock);
+    return count;
+}
+
+int DmabufHeapGetInfo(unsigned int index, DmabufHeapInfo *info)
+{
+    pthread_once(&g_scanOnce, ScanHeaps);
+    pthread_mutex_lock(&g_heapsLock);
+    AddEmulatedHeapLocked();
+    if (info == NULL || index >= g_heapCount) {
+        pthread_mutex_unlock(&g_heapsLock);
+        HILOG_ERROR(LOG_CORE, "%{public}s: info is NULL or index %u is wrong.", __func__, index);
+        return -EINVAL;
+    }
+    *info = g_heaps[index].info;
+    pthread_mutex_unlock(&g_heapsLock);
+    return 0;
+}
+
+int DmabufHeapAcquire(const char *heapName)
+{
+    if (heapName == NULL) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: heapName is NULL!", __func__);
+        return -EINVAL;
+    }
+    pthread_once(&g_scanOnce, ScanHeaps);
+    pthread_mutex_lock(&g_heapsLock);
+    AddEmulatedHeapLocked();
+    HeapEntry *heap = FindHeapByName(heapName);
+    if (heap == NULL) {
+        pthread_mutex_unlock(&g_heapsLock);
+        HILOG_ERROR(LOG_CORE, "%{public}s: no heap named %s.", __func__, heapName);
+        return -ENOENT;
+    }
+    if (heap->info.refCount == 0) {
+        int fd = DmabufHeapOpen(heapName);
+        if (fd < 0) {
+            pthread_mutex_unlock(&g_heapsLock);
+            return fd;
+        }
+        heap->fd = fd;
+    }
+    heap->info.refCount++;
+    int fd = heap->fd;
+    pthread_mutex_unlock(&g_heapsLock);
+    return fd;
+}
+
+int DmabufHeapRelease(unsigned int heapFd)
+{
+    pthread_once(&g_scanOnce, ScanHeaps);
+    pthread_mutex_lock(&g_heapsLock);
+    HeapEntry *heap = FindHeapByFd(heapFd);
+    if (heap == NULL) {
+        pthread_mutex_unlock(&g_heapsLock);
+        HILOG_ERROR(LOG_CORE, "%{public}s: heapFd %u is not acquired.", __func__, heapFd);
+        return -EINVAL;
+    }
+    int ret = 0;
+    if (--heap->info.refCount == 0) {
+        ret = DmabufHeapClose((unsigned int)heap->fd);
+        heap->fd = -1;
+    }
+    pthread_mutex_unlock(&g_heapsLock);
+    return ret;
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "securec.h"
+#include "hilog/log.h"
+#include "dmabuf_map.h"
+
+#define MAP_TABLE_MIN_CAPACITY 64
+
+typedef struct {
+    void *addr;                 /* NULL if not mapped */
+    size_t size;
+    unsigned int refCount;
+    bool persistent;
+} MapEntry;
+
+static pthread_mutex_t g_mapLock = PTHREAD_MUTEX_INITIALIZER;
+static MapEntry *g_maps = NULL; /* indexed by buffer fd */
+static unsigned int g_mapCapacity = 0;
+
+static MapEntry *GetEntryLocked(unsigned int fd, bool create)
+{
+    if (fd < g_mapCapacity) {
+        return &g_maps[fd];
+    }
+    if (!create) {
+        return NULL;
+    }
+    unsigned int capacity = (g_mapCapacity == 0) ? MAP_TABLE_MIN_CAPACITY : g_mapCapacity;
+    while (capacity <= fd) {
+        capacity *= 2; /* 2: grow by doubling */
+    }
+    MapEntry *maps = (MapEntry *)realloc(g_maps, capacity * sizeof(MapEntry));
+    if (maps == NULL) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: realloc fail", __func__);
+        return NULL;
+    }
+    (void)memset_s(maps + g_mapCapacity, (capacity - g_mapCapacity) * sizeof(MapEntry), 0,
+        (capacity - g_mapCapacity) * sizeof(MapEntry));
+    g_maps = maps;
+    g_mapCapacity = capacity;
+    return &g_maps[fd];
+}
+
+static void UnmapEntry(MapEntry *entry)
+{
+    if (entry->addr != NULL && munmap(entry->addr, entry->size) != 0) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: munmap fail, errno = %d.", __func__, errno);
+    }
+    entry->addr = NULL;
+    entry->size = 0;
+}
+
+void *DmabufHeapBufferMap(const DmabufHeapBuffer *buffer)
+{
+    if (buffer == NULL || buffer->size == 0) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: buffer is NULL or size is 0!", __func__);
+        return NULL;
+    }
+    pthread_mutex_lock(&g_mapLock);
+    MapEntry *entry = GetEntryLocked(buffer->fd, true);
+    if (entry == NULL) {
+        pthread_mutex_unlock(&g_mapLock);
+        return NULL;
+    }
+    /* a recycled buffer may be mapped by a bigger size than before */
+    if (entry->addr != NULL && entry->size < buffer->size) {
+        if (entry->refCount > 0) {
+            pthread_mutex_unlock(&g_mapLock);
+            HILOG_ERROR(LOG_CORE, "%{public}s: mapped by %zu, size = %zu.", __func__, entry->size, buffer->size);
+            return NULL;
+        }
+        UnmapEntry(entry);
+    }
+    if (entry->addr == NULL) {
+        void *addr = mmap(NULL, buffer->size, PROT_READ | PROT_WRITE, MAP_SHARED, buffer->fd, 0);
+        if (addr == MAP_FAILED) {
+            pthread_mutex_unlock(&g_mapLock);
+            HILOG_ERROR(LOG_CORE, "%{public}s: mmap fail, size = %zu, errno = %d.", __func__, buffer->size, errno);
+            return NULL;
+        }
+        entry->addr = addr;
+        entry->size = buffer->size;
+    }
+    entry->refCount++;
+    void *addr = entry->addr;
+    pthread_mutex_unlock(&g_mapLock);
+    return addr;
+}
+
+int DmabufHeapBufferUnmap(const DmabufHeapBuffer *buffer)
+{
+    if (buffer == NULL) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: buffer is NULL!", __func__);
+        return -EINVAL;
+    }
+    pthread_mutex_lock(&g_mapLock);
+    MapEntry *entry = GetEntryLocked(buffer->fd, false);
+    if (entry == NULL || entry->refCount == 0) {
+        pthread_mutex_unlock(&g_mapLock);
+        HILOG_ERROR(LOG_CORE, "%{public}s: buffer is not mapped, fd = %u.", __func__, buffer->fd);
+        return -EINVAL;
+    }
+    if (--entry->refCount == 0 && !entry->persistent) {
+        UnmapEntry(entry);
+    }
+    pthread_mutex_unlock(&g_mapLock);
+    return 0;
+}
+
+int DmabufHeapBufferSetPersistentMap(const DmabufHeapBuffer *buffer, bool persistent)
+{
+    if (buffer == NULL) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: buffer is NULL!", __func__);
+        return -EINVAL;
+    }
+    pthread_mutex_lock(&g_mapLock);
+    MapEntry *entry = GetEntryLocked(buffer->fd, true);
+    if (entry == NULL) {
+        pthread_mutex_unlock(&g_mapLock);
+        return -ENOMEM;
+    }
+    entry->persistent = persistent;
+    if (!persistent && entry->refCount == 0) {
+        UnmapEntry(entry);
+    }
+    pthread_mutex_unlock(&g_mapLock);
+    return 0;
+}
+
+void *DmabufHeapBufferBeginCpuAccess(const DmabufHeapBuffer *buffer, DmabufHeapBufferSyncType syncType)
+{
+    void *addr = DmabufHeapBufferMap(buffer);
+    if (addr == NULL) {
+        return NULL;
+    }
+    if (DmabufHeapBufferSyncStart(buffer->fd, syncType) != 0) {
+        DmabufHeapBufferUnmap(buffer);
+        return NULL;
+    }
+    return addr;
+}
+
+int DmabufHeapBufferEndCpuAccess(const DmabufHeapBuffer *buffer, DmabufHeapBufferSyncType syncType)
+{
+    if (buffer == NULL) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: buffer is NULL!", __func__);
+        return -EINVAL;
+    }
+    int ret = DmabufHeapBufferSyncEnd(buffer->fd, syncType);
+    int unmapRet = DmabufHeapBufferUnmap(buffer);
+    return (ret != 0) ? ret : unmapRet;
+}
+
+void DmabufHeapBufferDropMap(unsigned int fd)
+{
+    pthread_mutex_lock(&g_mapLock);
+    MapEntry *entry = GetEntryLocked(fd, false);
+    if (entry != NULL) {
+        if (entry->refCount > 0) {
+            HILOG_ERROR(LOG_CORE, "%{public}s: buffer is still mapped, fd = %u.", __func__, fd);
+        }
+        UnmapEntry(entry);
+        entry->refCount = 0;
+        entry->persistent = false;
+    }
+    pthread_mutex_unlock(&g_mapLock);
+}
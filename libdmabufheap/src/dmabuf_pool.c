@@ -0,0 +1,693 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "securec.h"
+#include "hilog/log.h"
+#include "dmabuf_map.h"
+#include "dmabuf_pool.h"
+#include "dmabuf_sync_inner.h"
+
+#define POOL_MAX_CLASSES 32
+#define POOL_MAGAZINES 16 /* power of 2, threads beyond it share magazines */
+#define MAGAZINE_SIZE 4
+#define POOL_CACHE_LINE_SIZE 64
+#define DEFAULT_LOW_WATERMARK 0
+#define DEFAULT_HIGH_WATERMARK 8
+#define DEFAULT_REFILL_INTERVAL_MS 50
+#define DEFAULT_REFILL_MIN_AVAILABLE_KB (256 * 1024)
+#define REFILL_NICE 10
+#define MEMINFO_LINE_LEN 128
+#define NS_PER_SEC 1000000000LL
+#define NS_PER_MS 1000000LL
+
+struct PoolClass {
+    size_t size;                /* page rounded */
+    __u64 heapFlags;
+    _Atomic unsigned int cached; /* buffers in the depot and the magazines, at most highWatermark */
+    _Atomic uint64_t hits;
+    _Atomic unsigned int demand; /* allocations not yet seen by the refiller, counted while it runs */
+    unsigned int periodDemand;  /* allocations of the current refill period, only used by the refiller */
+    unsigned int predicted;     /* average allocations per period, only used by the refiller */
+    pthread_mutex_t lock;       /* protects the depot */
+    unsigned int depotCount;
+    unsigned int *depot;        /* highWatermark entries */
+};
+
+struct PoolMagazine {
+    _Alignas(POOL_CACHE_LINE_SIZE) _Atomic bool busy; /* taken by the owner thread, or by trim */
+    unsigned int count;
+    _Atomic uint64_t hits;
+    struct {
+        unsigned int classId;
+        unsigned int fd;
+    } slots[MAGAZINE_SIZE];
+};
+
+struct DmabufHeapPool {
+    unsigned int heapFd;
+    unsigned int lowWatermark;
+    unsigned int highWatermark;
+    bool persistentMap;
+    size_t pageSize;
+    _Atomic uint64_t misses;
+    pthread_mutex_t classLock;  /* serializes the creation of classes, lookups are lock free */
+    _Atomic unsigned int classCount;
+    struct PoolClass classes[POOL_MAX_CLASSES];
+    struct PoolMagazine magazines[POOL_MAGAZINES];
+    _Atomic bool refilling;     /* the refiller runs */
+    _Atomic bool refillStop;
+    _Atomic uint64_t refilled;
+    pthread_mutex_t refillLock; /* protects the fields below */
+    pthread_cond_t refillCond;
+    pthread_t refillThread;
+    bool refillWake;
+    DmabufHeapPoolRefillConfig refillConfig;
+};
+
+static _Atomic unsigned int g_threadCount = 0;
+static _Thread_local unsigned int g_threadSlot = 0; /* 0 until the thread first uses a pool */
+
+static struct PoolMagazine *GetMagazine(DmabufHeapPool *pool)
+{
+    if (g_threadSlot == 0) {
+        g_threadSlot = atomic_fetch_add_explicit(&g_threadCount, 1, memory_order_relaxed) + 1;
+    }
+    return &pool->magazines[(g_threadSlot - 1) & (POOL_MAGAZINES - 1)];
+}
+
+static bool TryLockMagazine(struct PoolMagazine *mag)
+{
+    bool expected = false;
+    return atomic_compare_exchange_strong_explicit(&mag->busy, &expected, true,
+        memory_order_acquire, memory_order_relaxed);
+}
+
+static void LockMagazine(struct PoolMagazine *mag)
+{
+    while (!TryLockMagazine(mag)) {
+        sched_yield();
+    }
+}
+
+static void UnlockMagazine(struct PoolMagazine *mag)
+{
+    atomic_store_explicit(&mag->busy, false, memory_order_release);
+}
+
+static void CloseCached(struct PoolClass *cls, unsigned int fd)
+{
+    DmabufHeapBuffer buffer = { .fd = fd, .size = cls->size, .heapFlags = cls->heapFlags };
+    DmabufHeapBufferFree(&buffer);
+}
+
+static int FindClass(DmabufHeapPool *pool, size_t size, __u64 heapFlags)
+{
+    size_t classSize = (size + pool->pageSize - 1) & ~(pool->pageSize - 1);
+    unsigned int count = atomic_load_explicit(&pool->classCount, memory_order_acquire);
+    for (unsigned int i = 0; i < count; i++) {
+        if (pool->classes[i].size == classSize && pool->classes[i].heapFlags == heapFlags) {
+            return (int)i;
+        }
+    }
+    pthread_mutex_lock(&pool->classLock);
+    unsigned int newCount = atomic_load_explicit(&pool->classCount, memory_order_relaxed);
+    for (unsigned int i = count; i < newCount; i++) {
+        if (pool->classes[i].size == classSize && pool->classes[i].heapFlags == heapFlags) {
+            pthread_mutex_unlock(&pool->classLock);
+            return (int)i;
+        }
+    }
+    if (newCount == POOL_MAX_CLASSES) {
+        pthread_mutex_unlock(&pool->classLock);
+        return -1;
+    }
+    struct PoolClass *cls = &pool->classes[newCount];
+    cls->depot = (unsigned int *)calloc(pool->highWatermark, sizeof(unsigned int));
+    if (cls->depot == NULL) {
+        pthread_mutex_unlock(&pool->classLock);
+        HILOG_ERROR(LOG_CORE, "%{public}s: calloc depot fail", __func__);
+        return -1;
+    }
+    cls->size = classSize;
+    cls->heapFlags = heapFlags;
+    cls->depotCount = 0;
+    atomic_init(&cls->cached, 0);
+    atomic_init(&cls->hits, 0);
+    atomic_init(&cls->demand, 0);
+    cls->periodDemand = 0;
+    cls->predicted = 0;
+    pthread_mutex_init(&cls->lock, NULL);
+    /* publish the class after it is initialized */
+    atomic_store_explicit(&pool->classCount, newCount + 1, memory_order_release);
+    pthread_mutex_unlock(&pool->classLock);
+    return (int)newCount;
+}
+
+static bool TakeFromMagazine(struct PoolMagazine *mag, struct PoolClass *cls, int classId, unsigned int *fd)
+{
+    if (!TryLockMagazine(mag)) {
+        return false;
+    }
+    for (unsigned int i = mag->count; i > 0; i--) {
+        if (mag->slots[i - 1].classId != (unsigned int)classId) {
+            continue;
+        }
+        *fd = mag->slots[i - 1].fd;
+        mag->slots[i - 1] = mag->slots[--mag->count];
+        atomic_fetch_add_explicit(&mag->hits, 1, memory_order_relaxed);
+        UnlockMagazine(mag);
+        atomic_fetch_sub_explicit(&cls->cached, 1, memory_order_relaxed);
+        return true;
+    }
+    UnlockMagazine(mag);
+    return false;
+}
+
+static bool TakeCached(DmabufHeapPool *pool, int classId, unsigned int *fd)
+{
+    struct PoolClass *cls = &pool->classes[classId];
+    if (atomic_load_explicit(&cls->cached, memory_order_relaxed) == 0) {
+        return false;
+    }
+    struct PoolMagazine *mag = GetMagazine(pool);
+    if (TakeFromMagazine(mag, cls, classId, fd)) {
+        return true;
+    }
+    bool found = false;
+    pthread_mutex_lock(&cls->lock);
+    if (cls->depotCount > 0) {
+        *fd = cls->depot[--cls->depotCount];
+        found = true;
+    }
+    pthread_mutex_unlock(&cls->lock);
+    if (found) {
+        atomic_fetch_add_explicit(&cls->hits, 1, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&cls->cached, 1, memory_order_relaxed);
+        return true;
+    }
+    /* buffers freed by other threads, e.g. a compositor freeing what a decoder allocates */
+    for (unsigned int i = 0; i < POOL_MAGAZINES; i++) {
+        if (&pool->magazines[i] != mag && TakeFromMagazine(&pool->magazines[i], cls, classId, fd)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Return:  false if the class is full, then @fd is not cached */
+static bool PutCached(DmabufHeapPool *pool, int classId, unsigned int fd, bool toMagazine)
+{
+    struct PoolClass *cls = &pool->classes[classId];
+    if (atomic_fetch_add_explicit(&cls->cached, 1, memory_order_relaxed) >= pool->highWatermark) {
+        atomic_fetch_sub_explicit(&cls->cached, 1, memory_order_relaxed);
+        return false;
+    }
+    if (toMagazine) {
+        struct PoolMagazine *mag = GetMagazine(pool);
+        if (TryLockMagazine(mag)) {
+            bool put = mag->count < MAGAZINE_SIZE;
+            if (put) {
+                mag->slots[mag->count].classId = (unsigned int)classId;
+                mag->slots[mag->count].fd = fd;
+                mag->count++;
+            }
+            UnlockMagazine(mag);
+            if (put) {
+                return true;
+            }
+        }
+    }
+    /* cached never exceeds highWatermark, so the depot has room */
+    pthread_mutex_lock(&cls->lock);
+    cls->depot[cls->depotCount++] = fd;
+    pthread_mutex_unlock(&cls->lock);
+    return true;
+}
+
+/* allocate one buffer of the class to its depot, Return:  -ENOSPC if the class is full */
+static int ReserveOne(DmabufHeapPool *pool, int classId)
+{
+    struct PoolClass *cls = &pool->classes[classId];
+    DmabufHeapBuffer buffer = { .size = cls->size, .heapFlags = cls->heapFlags };
+    int ret = DmabufHeapBufferAlloc(pool->heapFd, &buffer);
+    if (ret < 0) {
+        return ret;
+    }
+    if (pool->persistentMap) {
+        DmabufHeapBufferSetPersistentMap(&buffer, true);
+    }
+    /* reserved buffers go to the depot, where every thread finds them */
+    if (!PutCached(pool, classId, buffer.fd, false)) {
+        DmabufHeapBufferFree(&buffer);
+        return -ENOSPC;
+    }
+    return 0;
+}
+
+static void CountDemand(DmabufHeapPool *pool, int classId)
+{
+    if (classId >= 0 && atomic_load_explicit(&pool->refilling, memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&pool->classes[classId].demand, 1, memory_order_relaxed);
+    }
+}
+
+static void WakeRefiller(DmabufHeapPool *pool)
+{
+    if (!atomic_load_explicit(&pool->refilling, memory_order_relaxed)) {
+        return;
+    }
+    pthread_mutex_lock(&pool->refillLock);
+    pool->refillWake = true;
+    pthread_cond_signal(&pool->refillCond);
+    pthread_mutex_unlock(&pool->refillLock);
+}
+
+static bool IsMemoryLow(unsigned int minAvailableKb)
+{
+    if (minAvailableKb == 0) {
+        return false;
+    }
+    FILE *fp = fopen("/proc/meminfo", "re");
+    if (fp == NULL) {
+        return false;
+    }
+    static const char key[] = "MemAvailable:";
+    char line[MEMINFO_LINE_LEN];
+    bool low = false;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (strncmp(line, key, sizeof(key) - 1) == 0) {
+            low = strtoull(line + sizeof(key) - 1, NULL, 10) < minAvailableKb; /* 10: decimal */
+            break;
+        }
+    }
+    (void)fclose(fp);
+    return low;
+}
+
+/* top up each class to its target, @periodEnd is true once per refill period */
+static void RefillClasses(DmabufHeapPool *pool, bool periodEnd)
+{
+    unsigned int count = atomic_load_explicit(&pool->classCount, memory_order_acquire);
+    for (unsigned int i = 0; i < count; i++) {
+        struct PoolClass *cls = &pool->classes[i];
+        cls->periodDemand += atomic_exchange_explicit(&cls->demand, 0, memory_order_relaxed);
+        unsigned int target = cls->periodDemand;
+        if (periodEnd) {
+            /* halve the weight of the older periods at each period end */
+            cls->predicted = (cls->predicted + cls->periodDemand + 1) / 2;
+            cls->periodDemand = 0;
+        }
+        if (target < cls->predicted) {
+            target = cls->predicted;
+        }
+        if (target > pool->highWatermark) {
+            target = pool->highWatermark;
+        }
+        while (atomic_load_explicit(&cls->cached, memory_order_relaxed) < target) {
+            if (atomic_load_explicit(&pool->refillStop, memory_order_relaxed) ||
+                IsMemoryLow(pool->refillConfig.minAvailableKb)) {
+                return;
+            }
+            if (ReserveOne(pool, (int)i) != 0) {
+                break;
+            }
+            atomic_fetch_add_explicit(&pool->refilled, 1, memory_order_relaxed);
+        }
+    }
+}
+
+static void AddMs(struct timespec *ts, unsigned int ms)
+{
+    long long ns = ts->tv_nsec + (long long)ms * NS_PER_MS;
+    ts->tv_sec += (time_t)(ns / NS_PER_SEC);
+    ts->tv_nsec = (long)(ns % NS_PER_SEC);
+}
+
+static void *RefillLoop(void *arg)
+{
+    DmabufHeapPool *pool = (DmabufHeapPool *)arg;
+    /* never compete with the threads allocating for the frames */
+    (void)setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), REFILL_NICE);
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    AddMs(&deadline, pool->refillConfig.intervalMs);
+    pthread_mutex_lock(&pool->refillLock);
+    while (!atomic_load_explicit(&pool->refillStop, memory_order_relaxed)) {
+        bool periodEnd = false;
+        if (!pool->refillWake) {
+            periodEnd = pthread_cond_timedwait(&pool->refillCond, &pool->refillLock, &deadline) == ETIMEDOUT;
+        }
+        pool->refillWake = false;
+        if (atomic_load_explicit(&pool->refillStop, memory_order_relaxed)) {
+            break;
+        }
+        if (periodEnd) {
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            AddMs(&deadline, pool->refillConfig.intervalMs);
+        }
+        pthread_mutex_unlock(&pool->refillLock);
+        RefillClasses(pool, periodEnd);
+        pthread_mutex_lock(&pool->refillLock);
+    }
+    pthread_mutex_unlock(&pool->refillLock);
+    return NULL;
+}
+
+DmabufHeapPool *DmabufHeapPoolCreate(unsigned int heapFd, const DmabufHeapPoolConfig *config)
+{
+    unsigned int low = (config != NULL) ? config->lowWatermark : DEFAULT_LOW_WATERMARK;
+    unsigned int high = (config != NULL) ? config->highWatermark : DEFAULT_HIGH_WATERMARK;
+    if (high == 0 || low > high) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: watermark is wrong, low = %u, high = %u.", __func__, low, high);
+        return NULL;
+    }
+    DmabufHeapPool *pool = (DmabufHeapPool *)aligned_alloc(POOL_CACHE_LINE_SIZE, sizeof(DmabufHeapPool));
+    if (pool == NULL) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: alloc pool fail", __func__);
+        return NULL;
+    }
+    (void)memset_s(pool, sizeof(DmabufHeapPool), 0, sizeof(DmabufHeapPool));
+    pool->heapFd = heapFd;
+    pool->lowWatermark = low;
+    pool->highWatermark = high;
+    pool->persistentMap = (config != NULL) && config->persistentMap;
+    pool->pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    atomic_init(&pool->misses, 0);
+    atomic_init(&pool->classCount, 0);
+    pthread_mutex_init(&pool->classLock, NULL);
+    atomic_init(&pool->refilling, false);
+    atomic_init(&pool->refillStop, false);
+    atomic_init(&pool->refilled, 0);
+    pthread_mutex_init(&pool->refillLock, NULL);
+    pthread_cond_init(&pool->refillCond, NULL);
+    for (unsigned int i = 0; i < POOL_MAGAZINES; i++) {
+        atomic_init(&pool->magazines[i].busy, false);
+        atomic_init(&pool->magazines[i].hits, 0);
+    }
+    return pool;
+}
+
+void DmabufHeapPoolDestroy(DmabufHeapPool *pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+    DmabufHeapPoolStopRefill(pool);
+    for (unsigned int i = 0; i < POOL_MAGAZINES; i++) {
+        struct PoolMagazine *mag = &pool->magazines[i];
+        for (unsigned int j = 0; j < mag->count; j++) {
+            CloseCached(&pool->classes[mag->slots[j].classId], mag->slots[j].fd);
+        }
+    }
+    unsigned int count = atomic_load_explicit(&pool->classCount, memory_order_acquire);
+    for (unsigned int i = 0; i < count; i++) {
+        struct PoolClass *cls = &pool->classes[i];
+        for (unsigned int j = 0; j < cls->depotCount; j++) {
+            CloseCached(cls, cls->depot[j]);
+        }
+        free(cls->depot);
+        pthread_mutex_destroy(&cls->lock);
+    }
+    pthread_mutex_destroy(&pool->classLock);
+    pthread_mutex_destroy(&pool->refillLock);
+    pthread_cond_destroy(&pool->refillCond);
+    free(pool);
+}
+
+int DmabufHeapPoolAlloc(DmabufHeapPool *pool, DmabufHeapBuffer *buffer)
+{
+    if (pool == NULL || buffer == NULL) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: pool or buffer is NULL!", __func__);
+        return -EINVAL;
+    }
+    if (buffer->size == 0) {
+        HILOG_ERROR(LOG_CORE, "alloc buffer size is wrong.");
+        return -EINVAL;
+    }
+    int classId = FindClass(pool, buffer->size, buffer->heapFlags);
+    CountDemand(pool, classId);
+    unsigned int fd;
+    if (classId >= 0 && TakeCached(pool, classId, &fd)) {
+        buffer->fd = fd;
+        return 0;
+    }
+    WakeRefiller(pool);
+    /* allocate the whole class, so the buffer can serve any size of it later */
+    DmabufHeapBuffer newBuffer = *buffer;
+    if (classId >= 0) {
+        newBuffer.size = pool->classes[classId].size;
+    }
+    int ret = DmabufHeapBufferAlloc(pool->heapFd, &newBuffer);
+    if (ret < 0) {
+        return ret;
+    }
+    atomic_fetch_add_explicit(&pool->misses, 1, memory_order_relaxed);
+    if (pool->persistentMap) {
+        DmabufHeapBufferSetPersistentMap(&newBuffer, true);
+    }
+    buffer->fd = newBuffer.fd;
+    return ret;
+}
+
+int DmabufHeapPoolAllocBatch(DmabufHeapPool *pool, DmabufHeapBuffer *buffers, unsigned int count)
+{
+    if (pool == NULL || buffers == NULL || count == 0) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: pool or buffers is NULL, or count is 0!", __func__);
+        return -EINVAL;
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        if (buffers[i].size == 0) {
+            HILOG_ERROR(LOG_CORE, "alloc buffer size is wrong, index = %u.", i);
+            return -EINVAL;
+        }
+    }
+    DmabufHeapBuffer *misses = (DmabufHeapBuffer *)malloc(count * sizeof(DmabufHeapBuffer));
+    unsigned int *missIndexes = (unsigned int *)malloc(count * sizeof(unsigned int));
+    bool *hits = (bool *)calloc(count, sizeof(bool));
+    if (misses == NULL || missIndexes == NULL || hits == NULL) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: alloc fail", __func__);
+        free(misses);
+        free(missIndexes);
+        free(hits);
+        return -ENOMEM;
+    }
+    unsigned int missCount = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        int classId = FindClass(pool, buffers[i].size, buffers[i].heapFlags);
+        CountDemand(pool, classId);
+        unsigned int fd;
+        if (classId >= 0 && TakeCached(pool, classId, &fd)) {
+            buffers[i].fd = fd;
+            hits[i] = true;
+            continue;
+        }
+        misses[missCount] = buffers[i];
+        if (classId >= 0) {
+            misses[missCount].size = pool->classes[classId].size;
+        }
+        missIndexes[missCount++] = i;
+    }
+    if (missCount > 0) {
+        WakeRefiller(pool);
+    }
+    int ret = (missCount > 0) ? DmabufHeapBufferAllocBatch(pool->heapFd, misses, missCount) : 0;
+    if (ret < 0) {
+        for (unsigned int i = 0; i < count; i++) {
+            if (hits[i]) {
+                DmabufHeapPoolFree(pool, &buffers[i]);
+            }
+        }
+    } else {
+        for (unsigned int i = 0; i < missCount; i++) {
+            buffers[missIndexes[i]].fd = misses[i].fd;
+            if (pool->persistentMap) {
+                DmabufHeapBufferSetPersistentMap(&misses[i], true);
+            }
+        }
+        atomic_fetch_add_explicit(&pool->misses, missCount, memory_order_relaxed);
+    }
+    free(misses);
+    free(missIndexes);
+    free(hits);
+    return ret;
+}
+
+int DmabufHeapPoolFree(DmabufHeapPool *pool, DmabufHeapBuffer *buffer)
+{
+    if (pool == NULL || buffer == NULL) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: pool or buffer is NULL!", __func__);
+        return -EINVAL;
+    }
+    if (buffer->size == 0) {
+        HILOG_ERROR(LOG_CORE, "free buffer size is wrong.");
+        return -EINVAL;
+    }
+    int classId = FindClass(pool, buffer->size, buffer->heapFlags);
+    if (classId < 0) {
+        return DmabufHeapBufferFree(buffer);
+    }
+    /* the next owner starts without the CPU access this one may have left open */
+    DmabufSyncResetState(buffer->fd);
+    if (!PutCached(pool, classId, buffer->fd, true)) {
+        return DmabufHeapBufferFree(buffer);
+    }
+    return 0;
+}
+
+int DmabufHeapPoolReserve(DmabufHeapPool *pool, size_t size, __u64 heapFlags, unsigned int count)
+{
+    if (pool == NULL || size == 0) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: pool is NULL or size is 0!", __func__);
+        return -EINVAL;
+    }
+    int classId = FindClass(pool, size, heapFlags);
+    if (classId < 0) {
+        return -ENOMEM;
+    }
+    struct PoolClass *cls = &pool->classes[classId];
+    if (count > pool->highWatermark) {
+        count = pool->highWatermark;
+    }
+    while (atomic_load_explicit(&cls->cached, memory_order_relaxed) < count) {
+        int ret = ReserveOne(pool, classId);
+        if (ret == -ENOSPC) {
+            break;
+        }
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+int DmabufHeapPoolStartRefill(DmabufHeapPool *pool, const DmabufHeapPoolRefillConfig *config)
+{
+    unsigned int intervalMs = (config != NULL) ? config->intervalMs : DEFAULT_REFILL_INTERVAL_MS;
+    if (pool == NULL || intervalMs == 0) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: pool is NULL or interval is 0!", __func__);
+        return -EINVAL;
+    }
+    pthread_mutex_lock(&pool->refillLock);
+    if (atomic_load_explicit(&pool->refilling, memory_order_relaxed)) {
+        pthread_mutex_unlock(&pool->refillLock);
+        return -EBUSY;
+    }
+    pool->refillConfig.intervalMs = intervalMs;
+    pool->refillConfig.minAvailableKb = (config != NULL) ? config->minAvailableKb : DEFAULT_REFILL_MIN_AVAILABLE_KB;
+    pool->refillWake = false;
+    atomic_store_explicit(&pool->refillStop, false, memory_order_relaxed);
+    /* the refiller owns the prediction fields of the classes from now on */
+    unsigned int count = atomic_load_explicit(&pool->classCount, memory_order_acquire);
+    for (unsigned int i = 0; i < count; i++) {
+        atomic_store_explicit(&pool->classes[i].demand, 0, memory_order_relaxed);
+        pool->classes[i].periodDemand = 0;
+        pool->classes[i].predicted = 0;
+    }
+    int ret = pthread_create(&pool->refillThread, NULL, RefillLoop, pool);
+    atomic_store_explicit(&pool->refilling, ret == 0, memory_order_relaxed);
+    pthread_mutex_unlock(&pool->refillLock);
+    if (ret != 0) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: create thread fail, %{public}d", __func__, ret);
+        return -ret;
+    }
+    return 0;
+}
+
+void DmabufHeapPoolStopRefill(DmabufHeapPool *pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&pool->refillLock);
+    if (!atomic_load_explicit(&pool->refilling, memory_order_relaxed)) {
+        pthread_mutex_unlock(&pool->refillLock);
+        return;
+    }
+    atomic_store_explicit(&pool->refillStop, true, memory_order_relaxed);
+    pthread_cond_signal(&pool->refillCond);
+    pthread_mutex_unlock(&pool->refillLock);
+    pthread_join(pool->refillThread, NULL);
+
+    pthread_mutex_lock(&pool->refillLock);
+    atomic_store_explicit(&pool->refilling, false, memory_order_relaxed);
+    pthread_mutex_unlock(&pool->refillLock);
+}
+
+unsigned int DmabufHeapPoolTrim(DmabufHeapPool *pool)
+{
+    if (pool == NULL) {
+        return 0;
+    }
+    for (unsigned int i = 0; i < POOL_MAGAZINES; i++) {
+        struct PoolMagazine *mag = &pool->magazines[i];
+        LockMagazine(mag);
+        for (unsigned int j = 0; j < mag->count; j++) {
+            struct PoolClass *cls = &pool->classes[mag->slots[j].classId];
+            pthread_mutex_lock(&cls->lock);
+            cls->depot[cls->depotCount++] = mag->slots[j].fd;
+            pthread_mutex_unlock(&cls->lock);
+        }
+        mag->count = 0;
+        UnlockMagazine(mag);
+    }
+    unsigned int closed = 0;
+    unsigned int count = atomic_load_explicit(&pool->classCount, memory_order_acquire);
+    for (unsigned int i = 0; i < count; i++) {
+        struct PoolClass *cls = &pool->classes[i];
+        pthread_mutex_lock(&cls->lock);
+        while (cls->depotCount > pool->lowWatermark) {
+            CloseCached(cls, cls->depot[--cls->depotCount]);
+            atomic_fetch_sub_explicit(&cls->cached, 1, memory_order_relaxed);
+            closed++;
+        }
+        pthread_mutex_unlock(&cls->lock);
+    }
+    return closed;
+}
+
+int DmabufHeapPoolGetStats(DmabufHeapPool *pool, DmabufHeapPoolStats *stats)
+{
+    if (pool == NULL || stats == NULL) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: pool or stats is NULL!", __func__);
+        return -EINVAL;
+    }
+    (void)memset_s(stats, sizeof(DmabufHeapPoolStats), 0, sizeof(DmabufHeapPoolStats));
+    stats->misses = atomic_load_explicit(&pool->misses, memory_order_relaxed);
+    stats->refilled = atomic_load_explicit(&pool->refilled, memory_order_relaxed);
+    for (unsigned int i = 0; i < POOL_MAGAZINES; i++) {
+        stats->hits += atomic_load_explicit(&pool->magazines[i].hits, memory_order_relaxed);
+    }
+    unsigned int count = atomic_load_explicit(&pool->classCount, memory_order_acquire);
+    for (unsigned int i = 0; i < count; i++) {
+        struct PoolClass *cls = &pool->classes[i];
+        unsigned int cached = atomic_load_explicit(&cls->cached, memory_order_relaxed);
+        stats->hits += atomic_load_explicit(&cls->hits, memory_order_relaxed);
+        stats->cachedBuffers += cached;
+        stats->cachedBytes += (uint64_t)cached * cls->size;
+    }
+    return 0;
+}
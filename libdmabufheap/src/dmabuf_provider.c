@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* memfd_create */
+#endif
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/udmabuf.h>
+#include "hilog/log.h"
+#include "dmabuf_provider.h"
+#include "dmabuf_provider_inner.h"
+#include "dmabuf_stats_inner.h"
+
+#define UDMABUF_DEV "/dev/udmabuf"
+#define EMULATED_HEAP_SLOTS 32
+
+typedef struct {
+    bool used;
+    unsigned int fd;
+    const DmabufHeapProviderOps *ops;
+} EmulatedHeapSlot;
+
+static _Atomic int g_selected = DMA_HEAP_PROVIDER_KERNEL;
+static pthread_mutex_t g_slotsLock = PTHREAD_MUTEX_INITIALIZER;
+static EmulatedHeapSlot g_slots[EMULATED_HEAP_SLOTS];
+static _Atomic unsigned int g_usedSlots = 0; /* kernel heaps skip the lookup while it is 0 */
+static pthread_once_t g_importOnce = PTHREAD_ONCE_INIT;
+static int g_importFd = -ENOENT; /* /dev/udmabuf for the imports, never closed */
+
+/* Return:  a memfd of @size bytes sealed by @seals, or -errno */
+static int CreateMemfd(const char *name, size_t size, unsigned int seals)
+{
+    int fd = memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        int err = errno;
+        HILOG_ERROR(LOG_CORE, "%{public}s: memfd_create fail, errno = %d.", __func__, err);
+        return -err;
+    }
+    if (ftruncate(fd, (off_t)size) < 0 || fcntl(fd, F_ADD_SEALS, seals) < 0) {
+        int err = errno;
+        HILOG_ERROR(LOG_CORE, "%{public}s: resize or seal fail, size = %zu, errno = %d.", __func__, size, err);
+        close(fd);
+        return -err;
+    }
+    return fd;
+}
+
+static size_t PageAlign(size_t size)
+{
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    return (size + pageSize - 1) & ~(pageSize - 1);
+}
+
+/* the emulated providers serve a single heap, other names fail as open() of a missing heap does */
+static bool IsEmulatedHeap(const char *heapName)
+{
+    if (strcmp(heapName, DMA_HEAP_PROVIDER_EMULATED_HEAP) != 0) {
+        errno = ENOENT;
+        return false;
+    }
+    return true;
+}
+
+static int UdmabufOpenHeap(const char *heapName)
+{
+    if (!IsEmulatedHeap(heapName)) {
+        return -1;
+    }
+    int fd = open(UDMABUF_DEV, O_RDWR | O_CLOEXEC);
+    return (fd < 0) ? -errno : fd;
+}
+
+static int CreateUdmabuf(unsigned int devFd, int memfd, size_t offset, size_t size)
+{
+    struct udmabuf_create create = {
+        .memfd = (__u32)memfd,
+        .flags = UDMABUF_FLAGS_CLOEXEC,
+        .offset = offset,
+        .size = size,
+    };
+    int fd = ioctl((int)devFd, UDMABUF_CREATE, &create);
+    if (fd < 0) {
+        int err = errno;
+        HILOG_ERROR(LOG_CORE, "%{public}s: UDMABUF_CREATE fail, size = %zu, errno = %d.", __func__, size, err);
+        return -err;
+    }
+    return fd;
+}
+
+static int UdmabufAllocBuffer(unsigned int heapFd, DmabufHeapBuffer *buffer)
+{
+    size_t size = PageAlign(buffer->size);
+    int memfd = CreateMemfd("dmabufheap", size, F_SEAL_SHRINK);
+    if (memfd < 0) {
+        return memfd;
+    }
+    /* the dma-buf holds the pages, the memfd is not needed any more */
+    int fd = CreateUdmabuf(heapFd, memfd, 0, size);
+    close(memfd);
+    if (fd < 0) {
+        return fd;
+    }
+    buffer->fd = (unsigned int)fd;
+    return 0;
+}
+
+static void OpenImportDev(void)
+{
+    int fd = open(UDMABUF_DEV, O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        g_importFd = -errno;
+        HILOG_ERROR(LOG_CORE, "%{public}s: open %{public}s fail, errno = %d.", __func__, UDMABUF_DEV, -g_importFd);
+        return;
+    }
+    g_importFd = fd;
+    DmabufStatsOnHeapOpen(fd, "udmabuf");
+}
+
+int DmabufProviderGetImportDev(void)
+{
+    pthread_once(&g_importOnce, OpenImportDev);
+    return g_importFd;
+}
+
+int DmabufProviderImportMemfd(int memfd, size_t offset, size_t len)
+{
+    int seals = fcntl(memfd, F_GET_SEALS);
+    if (seals < 0) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: fd %d is not a memfd, errno = %d.", __func__, memfd, errno);
+        return -EINVAL;
+    }
+    /* udmabuf only takes memfds which cannot shrink under the dma-buf */
+    if (((unsigned int)seals & F_SEAL_SHRINK) == 0 && fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK) < 0) {
+        int err = errno;
+        HILOG_ERROR(LOG_CORE, "%{public}s: seal fail, errno = %d.", __func__, err);
+        return -err;
+    }
+    int devFd = DmabufProviderGetImportDev();
+    if (devFd < 0) {
+        return devFd;
+    }
+    return CreateUdmabuf((unsigned int)devFd, memfd, offset, len);
+}
+
+/* the heap fd is an empty memfd named after the heap, so it shows in /proc/<pid>/fd */
+static int MemfdOpenHeap(const char *heapName)
+{
+    if (!IsEmulatedHeap(heapName)) {
+        return -1;
+    }
+    return CreateMemfd("dmabufheap:" DMA_HEAP_PROVIDER_EMULATED_HEAP, 0, F_SEAL_GROW | F_SEAL_SEAL);
+}
+
+static int MemfdAllocBuffer(unsigned int heapFd, DmabufHeapBuffer *buffer)
+{
+    (void)heapFd;
+    int fd = CreateMemfd("dmabufheap", PageAlign(buffer->size), F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+    if (fd < 0) {
+        return fd;
+    }
+    buffer->fd = (unsigned int)fd;
+    return 0;
+}
+
+static const DmabufHeapProviderOps g_udmabufOps = {
+    .openHeap = UdmabufOpenHeap,
+    .allocBuffer = UdmabufAllocBuffer,
+};
+
+static const DmabufHeapProviderOps g_memfdOps = {
+    .openHeap = MemfdOpenHeap,
+    .allocBuffer = MemfdAllocBuffer,
+};
+
+int DmabufHeapSetProvider(DmabufHeapProviderType type)
+{
+    if (type == DMA_HEAP_PROVIDER_UDMABUF || type == DMA_HEAP_PROVIDER_EMULATED) {
+        int fd = open(UDMABUF_DEV, O_RDWR | O_CLOEXEC);
+        if (fd < 0 && type == DMA_HEAP_PROVIDER_UDMABUF) {
+            int err = errno;
+            HILOG_ERROR(LOG_CORE, "%{public}s: open %{public}s fail, errno = %d.", __func__, UDMABUF_DEV, err);
+            return -err;
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        type = (fd >= 0) ? DMA_HEAP_PROVIDER_UDMABUF : DMA_HEAP_PROVIDER_MEMFD;
+    } else if (type != DMA_HEAP_PROVIDER_KERNEL && type != DMA_HEAP_PROVIDER_MEMFD) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: type %d is wrong.", __func__, (int)type);
+        return -EINVAL;
+    }
+    atomic_store_explicit(&g_selected, (int)type, memory_order_relaxed);
+    return 0;
+}
+
+DmabufHeapProviderType DmabufHeapGetProvider(void)
+{
+    return (DmabufHeapProviderType)atomic_load_explicit(&g_selected, memory_order_relaxed);
+}
+
+const DmabufHeapProviderOps *DmabufProviderGetSelected(void)
+{
+    switch (DmabufHeapGetProvider()) {
+        case DMA_HEAP_PROVIDER_UDMABUF:
+            return &g_udmabufOps;
+        case DMA_HEAP_PROVIDER_MEMFD:
+            return &g_memfdOps;
+        default:
+            return NULL;
+    }
+}
+
+void DmabufProviderOnHeapOpen(unsigned int heapFd, const DmabufHeapProviderOps *ops)
+{
+    if (ops == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&g_slotsLock);
+    for (unsigned int i = 0; i < EMULATED_HEAP_SLOTS; i++) {
+        if (!g_slots[i].used) {
+            g_slots[i].used = true;
+            g_slots[i].fd = heapFd;
+            g_slots[i].ops = ops;
+            atomic_fetch_add_explicit(&g_usedSlots, 1, memory_order_relaxed);
+            pthread_mutex_unlock(&g_slotsLock);
+            return;
+        }
+    }
+    pthread_mutex_unlock(&g_slotsLock);
+    HILOG_ERROR(LOG_CORE, "%{public}s: too many emulated heaps, heapFd %u is a kernel heap.", __func__, heapFd);
+}
+
+void DmabufProviderOnHeapClose(unsigned int heapFd)
+{
+    if (atomic_load_explicit(&g_usedSlots, memory_order_relaxed) == 0) {
+        return;
+    }
+    pthread_mutex_lock(&g_slotsLock);
+    for (unsigned int i = 0; i < EMULATED_HEAP_SLOTS; i++) {
+        if (g_slots[i].used && g_slots[i].fd == heapFd) {
+            g_slots[i].used = false;
+            atomic_fetch_sub_explicit(&g_usedSlots, 1, memory_order_relaxed);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_slotsLock);
+}
+
+const DmabufHeapProviderOps *DmabufProviderFind(unsigned int heapFd)
+{
+    if (atomic_load_explicit(&g_usedSlots, memory_order_relaxed) == 0) {
+        return NULL;
+    }
+    const DmabufHeapProviderOps *ops = NULL;
+    pthread_mutex_lock(&g_slotsLock);
+    for (unsigned int i = 0; i < EMULATED_HEAP_SLOTS; i++) {
+        if (g_slots[i].used && g_slots[i].fd == heapFd) {
+            ops = g_slots[i].ops;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_slotsLock);
+    return ops;
+}
+
+bool DmabufProviderIsCpuOnlyBuffer(unsigned int fd)
+{
+    int seals = fcntl((int)fd, F_GET_SEALS);
+    return seals >= 0 && (seals & F_SEAL_SHRINK) != 0;
+}
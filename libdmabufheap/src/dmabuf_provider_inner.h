@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIB_DMA_BUF_HEAP_PROVIDER_INNER_H
+#define LIB_DMA_BUF_HEAP_PROVIDER_INNER_H
+
+#include <stdbool.h>
+#include "dmabuf_alloc.h"
+
+typedef struct {
+    int (*openHeap)(const char *heapName);                        /* Return:  as DmabufHeapOpen() */
+    int (*allocBuffer)(unsigned int heapFd, DmabufHeapBuffer *buffer); /* Return:  0, or -errno */
+} DmabufHeapProviderOps;
+
+/* Return:  ops of the provider selected for new heaps, NULL for the kernel heaps */
+const DmabufHeapProviderOps *DmabufProviderGetSelected(void);
+
+/* hooks of dmabuf_alloc.c, heaps not opened by an emulated provider are kernel heaps */
+void DmabufProviderOnHeapOpen(unsigned int heapFd, const DmabufHeapProviderOps *ops);
+void DmabufProviderOnHeapClose(unsigned int heapFd);
+
+/* Return:  ops of the provider which opened @heapFd, NULL for a kernel heap */
+const DmabufHeapProviderOps *DmabufProviderFind(unsigned int heapFd);
+
+/* Return:  fd of /dev/udmabuf opened once for DmabufHeapImportMemfd(), or -errno */
+int DmabufProviderGetImportDev(void);
+
+/* Return:  a dma-buf of the @len bytes of @memfd from @offset, or -errno */
+int DmabufProviderImportMemfd(int memfd, size_t offset, size_t len);
+
+/* Return:  true if @fd is a sealed memfd, which is coherent and needs no sync */
+bool DmabufProviderIsCpuOnlyBuffer(unsigned int fd);
+
+#endif /* LIB_DMA_BUF_HEAP_PROVIDER_INNER_H */
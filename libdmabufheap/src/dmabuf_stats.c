@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include "securec.h"
+#include "hilog/log.h"
+#include "memory_trace.h"
+#include "dmabuf_stats.h"
+#include "dmabuf_stats_inner.h"
+
+#define HEAP_FD_SLOTS 32
+#define BUFFER_TABLE_MIN_CAPACITY 64
+#define HISTOGRAM_MIN_SIZE 4096ULL
+#define NS_PER_SEC 1000000000ULL
+
+typedef struct {
+    _Atomic uint64_t liveBytes;
+    _Atomic uint64_t liveBuffers;
+    _Atomic uint64_t allocCount;
+    _Atomic uint64_t allocBytes;
+} AtomicCounters;
+
+typedef struct {
+    size_t size;                /* 0 if the fd is not a buffer allocated by this library */
+    unsigned char heap;
+    unsigned char owner;
+} BufferRecord;
+
+typedef struct {
+    bool used;
+    int fd;
+    unsigned char heap;
+} HeapFdSlot;
+
+static const char *g_ownerNames[COUNT_DMA_OWNER] = { "default", "gpu", "media_codec" };
+
+/* the tables are protected by g_statsLock, the counters are read without it */
+static pthread_mutex_t g_statsLock = PTHREAD_MUTEX_INITIALIZER;
+static char g_heapNames[DMA_HEAP_STATS_MAX_HEAPS][DMA_HEAP_STATS_NAME_LEN] = { "unknown" };
+static unsigned int g_heapCount = 1;
+static HeapFdSlot g_heapFds[HEAP_FD_SLOTS];
+static BufferRecord *g_buffers = NULL; /* indexed by buffer fd */
+static unsigned int g_bufferCapacity = 0;
+
+static AtomicCounters g_heapCounters[DMA_HEAP_STATS_MAX_HEAPS];
+static AtomicCounters g_ownerCounters[COUNT_DMA_OWNER];
+static _Atomic uint64_t g_sizeHistogram[DMA_HEAP_STATS_HISTOGRAM_BUCKETS];
+static _Atomic bool g_naming = false;
+
+static BufferRecord *GetBufferRecordLocked(unsigned int fd, bool create)
+{
+    if (fd < g_bufferCapacity) {
+        return &g_buffers[fd];
+    }
+    if (!create) {
+        return NULL;
+    }
+    unsigned int capacity = (g_bufferCapacity == 0) ? BUFFER_TABLE_MIN_CAPACITY : g_bufferCapacity;
+    while (capacity <= fd) {
+        capacity *= 2; /* 2: grow by doubling */
+    }
+    BufferRecord *buffers = (BufferRecord *)realloc(g_buffers, capacity * sizeof(BufferRecord));
+    if (buffers == NULL) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: realloc fail", __func__);
+        return NULL;
+    }
+    (void)memset_s(buffers + g_bufferCapacity, (capacity - g_bufferCapacity) * sizeof(BufferRecord), 0,
+        (capacity - g_bufferCapacity) * sizeof(BufferRecord));
+    g_buffers = buffers;
+    g_bufferCapacity = capacity;
+    return &g_buffers[fd];
+}
+
+static unsigned char FindHeapLocked(unsigned int heapFd)
+{
+    for (unsigned int i = 0; i < HEAP_FD_SLOTS; i++) {
+        if (g_heapFds[i].used && (unsigned int)g_heapFds[i].fd == heapFd) {
+            return g_heapFds[i].heap;
+        }
+    }
+    return 0;
+}
+
+static unsigned int GetHistogramBucket(size_t size)
+{
+    unsigned int bucket = 0;
+    while (bucket < DMA_HEAP_STATS_HISTOGRAM_BUCKETS - 1 && (HISTOGRAM_MIN_SIZE << bucket) < size) {
+        bucket++;
+    }
+    return bucket;
+}
+
+static void AddCounters(AtomicCounters *counters, size_t size)
+{
+    atomic_fetch_add_explicit(&counters->liveBytes, size, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counters->liveBuffers, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counters->allocCount, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counters->allocBytes, size, memory_order_relaxed);
+}
+
+static void SubCounters(AtomicCounters *counters, size_t size)
+{
+    atomic_fetch_sub_explicit(&counters->liveBytes, size, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&counters->liveBuffers, 1, memory_order_relaxed);
+}
+
+static void LoadCounters(AtomicCounters *counters, DmabufHeapCounters *out)
+{
+    out->liveBytes = atomic_load_explicit(&counters->liveBytes, memory_order_relaxed);
+    out->liveBuffers = atomic_load_explicit(&counters->liveBuffers, memory_order_relaxed);
+    out->allocCount = atomic_load_explicit(&counters->allocCount, memory_order_relaxed);
+    out->allocBytes = atomic_load_explicit(&counters->allocBytes, memory_order_relaxed);
+}
+
+void DmabufStatsOnHeapOpen(int heapFd, const char *heapName)
+{
+    pthread_mutex_lock(&g_statsLock);
+    unsigned char heap = 0;
+    for (unsigned int i = 1; i < g_heapCount; i++) {
+        if (strncmp(g_heapNames[i], heapName, DMA_HEAP_STATS_NAME_LEN - 1) == 0) {
+            heap = (unsigned char)i;
+            break;
+        }
+    }
+    if (heap == 0 && g_heapCount < DMA_HEAP_STATS_MAX_HEAPS) {
+        /* a longer name is truncated */
+        (void)strncpy_s(g_heapNames[g_heapCount], DMA_HEAP_STATS_NAME_LEN, heapName, DMA_HEAP_STATS_NAME_LEN - 1);
+        heap = (unsigned char)g_heapCount++;
+    }
+    for (unsigned int i = 0; i < HEAP_FD_SLOTS; i++) {
+        if (!g_heapFds[i].used) {
+            g_heapFds[i].used = true;
+            g_heapFds[i].fd = heapFd;
+            g_heapFds[i].heap = heap;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_statsLock);
+}
+
+void DmabufStatsOnHeapClose(unsigned int heapFd)
+{
+    pthread_mutex_lock(&g_statsLock);
+    for (unsigned int i = 0; i < HEAP_FD_SLOTS; i++) {
+        if (g_heapFds[i].used && (unsigned int)g_heapFds[i].fd == heapFd) {
+            g_heapFds[i].used = false;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_statsLock);
+}
+
+void DmabufStatsOnAlloc(unsigned int heapFd, const DmabufHeapBuffer *buffer)
+{
+    __u64 owner = get_owner_id_from_heap_flags(buffer->heapFlags);
+    if (owner >= COUNT_DMA_OWNER) {
+        owner = DMA_OWNER_DEFAULT;
+    }
+    char name[DMA_BUF_NAME_LEN] = {0};
+    bool naming = atomic_load_explicit(&g_naming, memory_order_relaxed);
+
+    pthread_mutex_lock(&g_statsLock);
+    unsigned char heap = FindHeapLocked(heapFd);
+    BufferRecord *record = GetBufferRecordLocked(buffer->fd, true);
+    if (record != NULL) {
+        record->size = buffer->size;
+        record->heap = heap;
+        record->owner = (unsigned char)owner;
+    }
+    if (naming) {
+        /* a name longer than DMA_BUF_NAME_LEN is truncated */
+        (void)snprintf_s(name, sizeof(name), sizeof(name) - 1, "%s:%s", g_heapNames[heap], g_ownerNames[owner]);
+    }
+    pthread_mutex_unlock(&g_statsLock);
+    if (record == NULL) {
+        return;
+    }
+
+    AddCounters(&g_heapCounters[heap], buffer->size);
+    AddCounters(&g_ownerCounters[owner], buffer->size);
+    atomic_fetch_add_explicit(&g_sizeHistogram[GetHistogramBucket(buffer->size)], 1, memory_order_relaxed);
+    if (naming) {
+        ioctl(buffer->fd, DMA_BUF_SET_NAME, name);
+    }
+}
+
+void DmabufStatsOnFree(unsigned int bufferFd)
+{
+    pthread_mutex_lock(&g_statsLock);
+    BufferRecord *record = GetBufferRecordLocked(bufferFd, false);
+    BufferRecord freed = { 0 };
+    if (record != NULL) {
+        freed = *record;
+        record->size = 0;
+    }
+    pthread_mutex_unlock(&g_statsLock);
+    if (freed.size == 0) {
+        return;
+    }
+    SubCounters(&g_heapCounters[freed.heap], freed.size);
+    SubCounters(&g_ownerCounters[freed.owner], freed.size);
+}
+
+int DmabufHeapGetStatsSnapshot(DmabufHeapStatsSnapshot *snapshot)
+{
+    if (snapshot == NULL) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: snapshot is NULL!", __func__);
+        return -EINVAL;
+    }
+    (void)memset_s(snapshot, sizeof(DmabufHeapStatsSnapshot), 0, sizeof(DmabufHeapStatsSnapshot));
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    snapshot->timeNs = (uint64_t)ts.tv_sec * NS_PER_SEC + (uint64_t)ts.tv_nsec;
+
+    pthread_mutex_lock(&g_statsLock);
+    snapshot->heapCount = g_heapCount;
+    (void)memcpy_s(snapshot->heapNames, sizeof(snapshot->heapNames), g_heapNames, sizeof(g_heapNames));
+    pthread_mutex_unlock(&g_statsLock);
+    for (unsigned int i = 0; i < COUNT_DMA_OWNER; i++) {
+        (void)strncpy_s(snapshot->ownerNames[i], DMA_HEAP_STATS_NAME_LEN, g_ownerNames[i], DMA_HEAP_STATS_NAME_LEN - 1);
+    }
+
+    for (unsigned int i = 0; i < snapshot->heapCount; i++) {
+        LoadCounters(&g_heapCounters[i], &snapshot->heaps[i]);
+    }
+    for (unsigned int i = 0; i < COUNT_DMA_OWNER; i++) {
+        LoadCounters(&g_ownerCounters[i], &snapshot->owners[i]);
+    }
+    for (unsigned int i = 0; i < DMA_HEAP_STATS_HISTOGRAM_BUCKETS; i++) {
+        snapshot->sizeHistogram[i] = atomic_load_explicit(&g_sizeHistogram[i], memory_order_relaxed);
+    }
+    return 0;
+}
+
+void DmabufHeapSetBufferNaming(bool enabled)
+{
+    atomic_store_explicit(&g_naming, enabled, memory_order_relaxed);
+}
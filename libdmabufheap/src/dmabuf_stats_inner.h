@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIB_DMA_BUF_HEAP_STATS_INNER_H
+#define LIB_DMA_BUF_HEAP_STATS_INNER_H
+
+#include "dmabuf_alloc.h"
+
+/* hooks of dmabuf_alloc.c, where heaps and buffers are opened and closed */
+void DmabufStatsOnHeapOpen(int heapFd, const char *heapName);
+void DmabufStatsOnHeapClose(unsigned int heapFd);
+void DmabufStatsOnAlloc(unsigned int heapFd, const DmabufHeapBuffer *buffer);
+void DmabufStatsOnFree(unsigned int bufferFd);
+
+#endif /* LIB_DMA_BUF_HEAP_STATS_INNER_H */
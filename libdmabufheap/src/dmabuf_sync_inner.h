@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIB_DMA_BUF_HEAP_SYNC_INNER_H
+#define LIB_DMA_BUF_HEAP_SYNC_INNER_H
+
+/* hook of dmabuf_pool.c, a buffer recycled by the pool starts without any tracked CPU access */
+void DmabufSyncResetState(unsigned int fd);
+
+#endif /* LIB_DMA_BUF_HEAP_SYNC_INNER_H */
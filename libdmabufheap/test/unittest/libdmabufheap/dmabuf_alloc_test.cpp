@@ -25,9 +25,16 @@
 #include <climits>
 #include <dirent.h>
 #include <string>
+#include <thread>
 #include "gtest/gtest.h"
 #include "securec.h"
 #include "dmabuf_alloc.h"
+#include "dmabuf_buffer.h"
+#include "dmabuf_heap_registry.h"
+#include "dmabuf_map.h"
+#include "dmabuf_pool.h"
+#include "dmabuf_provider.h"
+#include "dmabuf_stats.h"
 
 using namespace testing;
 using namespace testing::ext;
@@ -56,19 +63,22 @@ void DmabufAllocTest::SetUp()
 {
     std::string rootDir = "/dev/dma_heap/";
     DIR *dir = opendir(rootDir.c_str());
-    if (dir == nullptr) {
-        return;
-    }
-    struct dirent *ptr;
-    while ((ptr = readdir(dir)) != nullptr) {
-        std::string fileName = ptr->d_name;
-        std::string::size_type idx = fileName.find("system");
-        if (idx != std::string::npos) {
-            heapName = fileName;
-            break;
+    if (dir != nullptr) {
+        struct dirent *ptr;
+        while ((ptr = readdir(dir)) != nullptr) {
+            std::string fileName = ptr->d_name;
+            std::string::size_type idx = fileName.find("system");
+            if (idx != std::string::npos) {
+                heapName = fileName;
+                break;
+            }
         }
+        closedir(dir);
+    }
+    /* without a system heap, run on the emulated one */
+    if (heapName.empty() && DmabufHeapSetProvider(DMA_HEAP_PROVIDER_EMULATED) == 0) {
+        heapName = DMA_HEAP_PROVIDER_EMULATED_HEAP;
     }
-    closedir(dir);
 }
 
 void DmabufAllocTest::TearDown()
@@ -300,4 +310,518 @@ HWTEST_F(DmabufAllocTest, ExchangeBufferSyncOrder, Function|MediumTest|Level1)
 
     ASSERT_EQ(0, DmabufHeapClose(heapFd));
 }
-}
\ No newline at end of file
+HWTEST_F(DmabufAllocTest, PoolRecycleBuffer, Function|MediumTest|Level1)
+{
+    ASSERT_STRNE(heapName.c_str(), "");
+
+    int heapFd = DmabufHeapOpen(heapName.c_str());
+    ASSERT_GE(heapFd, 0);
+
+    DmabufHeapPool *pool = DmabufHeapPoolCreate(heapFd, nullptr);
+    ASSERT_TRUE(pool != nullptr);
+
+    DmabufHeapBuffer buffer = { .size = BUFFER_SIZE, .heapFlags = 0 };
+    ASSERT_EQ(0, DmabufHeapPoolAlloc(pool, &buffer));
+    unsigned int fd = buffer.fd;
+    ASSERT_EQ(0, DmabufHeapPoolFree(pool, &buffer));
+
+    /* the same size class gets the freed buffer back, another owner does not */
+    DmabufHeapBuffer sameClass = { .size = BUFFER_SIZE * 2, .heapFlags = 0 };
+    ASSERT_EQ(0, DmabufHeapPoolAlloc(pool, &sameClass));
+    ASSERT_EQ(fd, sameClass.fd);
+    ASSERT_EQ(0, DmabufHeapPoolFree(pool, &sameClass));
+
+    DmabufHeapBuffer otherOwner = { .size = BUFFER_SIZE, .heapFlags = 0 };
+    SetOwnerIdForHeapFlags(&otherOwner, DMA_OWNER_GPU);
+    ASSERT_EQ(0, DmabufHeapPoolAlloc(pool, &otherOwner));
+    ASSERT_NE(fd, otherOwner.fd);
+    ASSERT_EQ(0, DmabufHeapPoolFree(pool, &otherOwner));
+
+    DmabufHeapPoolStats stats;
+    ASSERT_EQ(0, DmabufHeapPoolGetStats(pool, &stats));
+    ASSERT_EQ(1, stats.hits);
+    ASSERT_EQ(2, stats.misses);
+    ASSERT_EQ(2, stats.cachedBuffers);
+
+    DmabufHeapPoolDestroy(pool);
+
+    ASSERT_EQ(0, DmabufHeapClose(heapFd));
+}
+
+HWTEST_F(DmabufAllocTest, PoolWatermark, Function|MediumTest|Level1)
+{
+    ASSERT_STRNE(heapName.c_str(), "");
+
+    int heapFd = DmabufHeapOpen(heapName.c_str());
+    ASSERT_GE(heapFd, 0);
+
+    DmabufHeapPoolConfig badConfig = { .lowWatermark = 2, .highWatermark = 1 };
+    ASSERT_TRUE(DmabufHeapPoolCreate(heapFd, &badConfig) == nullptr);
+
+    const unsigned int low = 1;
+    const unsigned int high = 3;
+    DmabufHeapPoolConfig config = { .lowWatermark = low, .highWatermark = high };
+    DmabufHeapPool *pool = DmabufHeapPoolCreate(heapFd, &config);
+    ASSERT_TRUE(pool != nullptr);
+
+    ASSERT_EQ(0, DmabufHeapPoolReserve(pool, BUFFER_SIZE, 0, high + 1));
+    DmabufHeapPoolStats stats;
+    ASSERT_EQ(0, DmabufHeapPoolGetStats(pool, &stats));
+    ASSERT_EQ(high, stats.cachedBuffers);
+
+    DmabufHeapBuffer buffers[high + 1];
+    for (auto &buffer : buffers) {
+        buffer = { .size = BUFFER_SIZE, .heapFlags = 0 };
+        ASSERT_EQ(0, DmabufHeapPoolAlloc(pool, &buffer));
+    }
+    ASSERT_EQ(0, DmabufHeapPoolGetStats(pool, &stats));
+    ASSERT_EQ(high, stats.hits);
+    ASSERT_EQ(0, stats.cachedBuffers);
+
+    /* frees above the high watermark close the buffer */
+    for (auto &buffer : buffers) {
+        ASSERT_EQ(0, DmabufHeapPoolFree(pool, &buffer));
+    }
+    ASSERT_EQ(0, DmabufHeapPoolGetStats(pool, &stats));
+    ASSERT_EQ(high, stats.cachedBuffers);
+
+    ASSERT_EQ(high - low, DmabufHeapPoolTrim(pool));
+    ASSERT_EQ(0, DmabufHeapPoolGetStats(pool, &stats));
+    ASSERT_EQ(low, stats.cachedBuffers);
+
+    DmabufHeapPoolDestroy(pool);
+
+    ASSERT_EQ(0, DmabufHeapClose(heapFd));
+}
+HWTEST_F(DmabufAllocTest, PoolCrossThreadRecycle, Function|MediumTest|Level1)
+{
+    ASSERT_STRNE(heapName.c_str(), "");
+
+    int heapFd = DmabufHeapOpen(heapName.c_str());
+    ASSERT_GE(heapFd, 0);
+
+    DmabufHeapPool *pool = DmabufHeapPoolCreate(heapFd, nullptr);
+    ASSERT_TRUE(pool != nullptr);
+
+    /* a decoder thread allocates each frame, this thread frees it, more than a magazine holds */
+    const unsigned int count = 6;
+    const unsigned int frames = 4;
+    DmabufHeapBuffer buffers[count];
+    DmabufHeapPoolStats stats;
+    for (unsigned int frame = 0; frame < frames; frame++) {
+        int ret = 0;
+        std::thread decoder([pool, &buffers, &ret] {
+            for (auto &buffer : buffers) {
+                buffer = { .size = BUFFER_SIZE, .heapFlags = 0 };
+                ret |= DmabufHeapPoolAlloc(pool, &buffer);
+            }
+        });
+        decoder.join();
+        ASSERT_EQ(0, ret);
+        for (auto &buffer : buffers) {
+            ASSERT_EQ(0, DmabufHeapPoolFree(pool, &buffer));
+        }
+    }
+    /* only the first frame misses */
+    ASSERT_EQ(0, DmabufHeapPoolGetStats(pool, &stats));
+    ASSERT_EQ(count, stats.misses);
+    ASSERT_EQ(count * (frames - 1), stats.hits);
+    ASSERT_EQ(count, stats.cachedBuffers);
+    DmabufHeapPoolDestroy(pool);
+
+    ASSERT_EQ(0, DmabufHeapClose(heapFd));
+}
+HWTEST_F(DmabufAllocTest, RegistryAcquireHeap, Function|MediumTest|Level1)
+{
+    ASSERT_STRNE(heapName.c_str(), "");
+
+    DmabufHeapInfo info;
+    unsigned int index = 0;
+    unsigned int count = DmabufHeapGetCount();
+    for (; index < count; index++) {
+        ASSERT_EQ(0, DmabufHeapGetInfo(index, &info));
+        if (heapName == info.name) {
+            break;
+        }
+    }
+    ASSERT_LT(index, count);
+    ASSERT_EQ(-EINVAL, DmabufHeapGetInfo(count, &info));
+    ASSERT_EQ(-ENOENT, DmabufHeapAcquire("invalid_heap"));
+
+    /* the heap is opened once and shared */
+    int heapFd = DmabufHeapAcquire(heapName.c_str());
+    ASSERT_GE(heapFd, 0);
+    ASSERT_EQ(heapFd, DmabufHeapAcquire(heapName.c_str()));
+    ASSERT_EQ(0, DmabufHeapGetInfo(index, &info));
+    ASSERT_EQ(2, info.refCount);
+
+    DmabufHeapBuffer buffer = { .size = BUFFER_SIZE, .heapFlags = 0 };
+    ASSERT_EQ(0, DmabufHeapBufferAlloc(heapFd, &buffer));
+    ASSERT_EQ(0, DmabufHeapBufferFree(&buffer));
+
+    ASSERT_EQ(0, DmabufHeapRelease(heapFd));
+    ASSERT_EQ(0, DmabufHeapRelease(heapFd));
+    ASSERT_EQ(-EINVAL, DmabufHeapRelease(heapFd));
+    ASSERT_EQ(0, DmabufHeapGetInfo(index, &info));
+    ASSERT_EQ(0, info.refCount);
+}
+HWTEST_F(DmabufAllocTest, AllocBatchBuffers, Function|MediumTest|Level1)
+{
+    ASSERT_STRNE(heapName.c_str(), "");
+
+    int heapFd = DmabufHeapOpen(heapName.c_str());
+    ASSERT_GE(heapFd, 0);
+
+    const unsigned int count = 4;
+    const size_t largeSize = 1024 * 1024;
+    DmabufHeapBuffer buffers[count];
+    for (auto &buffer : buffers) {
+        buffer = { .size = largeSize, .heapFlags = 0 };
+    }
+    buffers[count - 1].size = 0;
+    ASSERT_EQ(-EINVAL, DmabufHeapBufferAllocBatch(heapFd, buffers, count));
+
+    buffers[count - 1].size = largeSize;
+    ASSERT_EQ(0, DmabufHeapBufferAllocBatch(heapFd, buffers, count));
+    for (unsigned int i = 1; i < count; i++) {
+        ASSERT_NE(buffers[0].fd, buffers[i].fd);
+    }
+    /* each buffer of a batch is accounted on its own, so part of it is freed alone */
+    ASSERT_EQ(0, DmabufHeapBufferFree(&buffers[0]));
+    ASSERT_EQ(0, DmabufHeapBufferFreeBatch(buffers + 1, count - 1));
+
+    /* the pool serves what it caches, the rest is allocated by the kernel */
+    DmabufHeapPool *pool = DmabufHeapPoolCreate(heapFd, nullptr);
+    ASSERT_TRUE(pool != nullptr);
+    ASSERT_EQ(0, DmabufHeapPoolReserve(pool, BUFFER_SIZE, 0, count / 2));
+    for (auto &buffer : buffers) {
+        buffer = { .size = BUFFER_SIZE, .heapFlags = 0 };
+    }
+    ASSERT_EQ(0, DmabufHeapPoolAllocBatch(pool, buffers, count));
+    DmabufHeapPoolStats stats;
+    ASSERT_EQ(0, DmabufHeapPoolGetStats(pool, &stats));
+    ASSERT_EQ(count / 2, stats.hits);
+    ASSERT_EQ(count / 2, stats.misses);
+    for (auto &buffer : buffers) {
+        ASSERT_EQ(0, DmabufHeapPoolFree(pool, &buffer));
+    }
+    DmabufHeapPoolDestroy(pool);
+
+    ASSERT_EQ(0, DmabufHeapClose(heapFd));
+}
+HWTEST_F(DmabufAllocTest, MapBufferCache, Function|MediumTest|Level1)
+{
+    ASSERT_STRNE(heapName.c_str(), "");
+
+    int heapFd = DmabufHeapOpen(heapName.c_str());
+    ASSERT_GE(heapFd, 0);
+
+    DmabufHeapBuffer buffer = { .size = BUFFER_SIZE, .heapFlags = 0 };
+    ASSERT_EQ(0, DmabufHeapBufferAlloc(heapFd, &buffer));
+
+    void *ptr = DmabufHeapBufferBeginCpuAccess(&buffer, DMA_BUF_HEAP_BUF_SYNC_RW);
+    ASSERT_TRUE(ptr != nullptr);
+    ASSERT_EQ(ptr, DmabufHeapBufferMap(&buffer));
+    ASSERT_GE(sprintf_s((char *)ptr, BUFFER_SIZE, "libdmabufheap"), 0);
+    ASSERT_EQ(0, DmabufHeapBufferUnmap(&buffer));
+    ASSERT_EQ(0, DmabufHeapBufferEndCpuAccess(&buffer, DMA_BUF_HEAP_BUF_SYNC_RW));
+    ASSERT_EQ(-EINVAL, DmabufHeapBufferUnmap(&buffer));
+
+    /* a persistent mapping survives its last unmap */
+    ASSERT_EQ(0, DmabufHeapBufferSetPersistentMap(&buffer, true));
+    ptr = DmabufHeapBufferMap(&buffer);
+    ASSERT_TRUE(ptr != nullptr);
+    ASSERT_EQ(0, DmabufHeapBufferUnmap(&buffer));
+    ASSERT_EQ(ptr, DmabufHeapBufferBeginCpuAccess(&buffer, DMA_BUF_HEAP_BUF_SYNC_READ));
+    ASSERT_STREQ("libdmabufheap", (char *)ptr);
+    ASSERT_EQ(0, DmabufHeapBufferEndCpuAccess(&buffer, DMA_BUF_HEAP_BUF_SYNC_READ));
+
+    ASSERT_EQ(0, DmabufHeapBufferFree(&buffer));
+
+    ASSERT_EQ(0, DmabufHeapClose(heapFd));
+}
+
+HWTEST_F(DmabufAllocTest, PoolPersistentMap, Function|MediumTest|Level1)
+{
+    ASSERT_STRNE(heapName.c_str(), "");
+
+    int heapFd = DmabufHeapOpen(heapName.c_str());
+    ASSERT_GE(heapFd, 0);
+
+    DmabufHeapPoolConfig config = { .lowWatermark = 0, .highWatermark = 1, .persistentMap = true };
+    DmabufHeapPool *pool = DmabufHeapPoolCreate(heapFd, &config);
+    ASSERT_TRUE(pool != nullptr);
+
+    DmabufHeapBuffer buffer = { .size = BUFFER_SIZE, .heapFlags = 0 };
+    ASSERT_EQ(0, DmabufHeapPoolAlloc(pool, &buffer));
+    void *ptr = DmabufHeapBufferMap(&buffer);
+    ASSERT_TRUE(ptr != nullptr);
+    ASSERT_EQ(0, DmabufHeapBufferUnmap(&buffer));
+    ASSERT_EQ(0, DmabufHeapPoolFree(pool, &buffer));
+
+    /* the recycled buffer comes back mapped */
+    ASSERT_EQ(0, DmabufHeapPoolAlloc(pool, &buffer));
+    ASSERT_EQ(ptr, DmabufHeapBufferMap(&buffer));
+    ASSERT_EQ(0, DmabufHeapBufferUnmap(&buffer));
+    ASSERT_EQ(0, DmabufHeapPoolFree(pool, &buffer));
+
+    DmabufHeapPoolDestroy(pool);
+
+    ASSERT_EQ(0, DmabufHeapClose(heapFd));
+}
+
+HWTEST_F(DmabufAllocTest, PoolBackgroundRefill, Function|MediumTest|Level1)
+{
+    ASSERT_STRNE(heapName.c_str(), "");
+
+    int heapFd = DmabufHeapOpen(heapName.c_str());
+    ASSERT_GE(heapFd, 0);
+
+    DmabufHeapPool *pool = DmabufHeapPoolCreate(heapFd, nullptr);
+    ASSERT_TRUE(pool != nullptr);
+    DmabufHeapPoolRefillConfig badConfig = { .intervalMs = 0, .minAvailableKb = 0 };
+    ASSERT_EQ(-EINVAL, DmabufHeapPoolStartRefill(pool, &badConfig));
+    /* no period ends during the test, the refiller only runs when the batch below wakes it */
+    DmabufHeapPoolRefillConfig config = { .intervalMs = 10000, .minAvailableKb = 0 };
+    ASSERT_EQ(0, DmabufHeapPoolStartRefill(pool, &config));
+    ASSERT_EQ(-EBUSY, DmabufHeapPoolStartRefill(pool, &config));
+
+    /*
+     * the batch counts the whole demand before waking the refiller, so all of it misses.
+     * The buffers are not given back to the pool, only the refiller can cache some.
+     */
+    const unsigned int count = 4;
+    DmabufHeapBuffer buffers[count];
+    for (auto &buffer : buffers) {
+        buffer = { .size = BUFFER_SIZE, .heapFlags = 0 };
+    }
+    ASSERT_EQ(0, DmabufHeapPoolAllocBatch(pool, buffers, count));
+    ASSERT_EQ(0, DmabufHeapBufferFreeBatch(buffers, count));
+
+    const unsigned int waitMs = 1000;
+    const unsigned int stepUs = 1000;
+    DmabufHeapPoolStats stats;
+    for (unsigned int i = 0; i < waitMs; i++) {
+        ASSERT_EQ(0, DmabufHeapPoolGetStats(pool, &stats));
+        if (stats.cachedBuffers >= count) {
+            break;
+        }
+        usleep(stepUs);
+    }
+    ASSERT_EQ(count, stats.cachedBuffers);
+    ASSERT_EQ(count, stats.refilled);
+
+    /* the same demand is then served without any allocation on this thread */
+    DmabufHeapPoolStopRefill(pool);
+    for (auto &buffer : buffers) {
+        ASSERT_EQ(0, DmabufHeapPoolAlloc(pool, &buffer));
+    }
+    ASSERT_EQ(0, DmabufHeapPoolGetStats(pool, &stats));
+    ASSERT_EQ(count, stats.hits);
+    ASSERT_EQ(count, stats.misses);
+    for (auto &buffer : buffers) {
+        ASSERT_EQ(0, DmabufHeapPoolFree(pool, &buffer));
+    }
+    DmabufHeapPoolDestroy(pool);
+
+    ASSERT_EQ(0, DmabufHeapClose(heapFd));
+}
+HWTEST_F(DmabufAllocTest, BufferRaiiRecycle, Function|MediumTest|Level1)
+{
+    ASSERT_STRNE(heapName.c_str(), "");
+
+    OHOS::Dmabuf::DmabufHeap heap(heapName.c_str());
+    ASSERT_TRUE(heap.IsValid());
+    ASSERT_TRUE(heap.EnablePool());
+    ASSERT_FALSE(heap.EnablePool());
+
+    OHOS::Dmabuf::DmabufBuffer moved;
+    {
+        OHOS::Dmabuf::DmabufBuffer buffer = heap.Alloc(BUFFER_SIZE, DMA_OWNER_MEDIA_CODEC);
+        ASSERT_TRUE(buffer.IsValid());
+        {
+            OHOS::Dmabuf::ScopedCpuAccess access(buffer, DMA_BUF_HEAP_BUF_SYNC_RW);
+            ASSERT_TRUE(access.IsValid());
+            ASSERT_GE(sprintf_s((char *)access.GetAddr(), BUFFER_SIZE, "libdmabufheap"), 0);
+        }
+        moved = std::move(buffer);
+        ASSERT_FALSE(buffer.IsValid());
+    }
+    ASSERT_TRUE(moved.IsValid());
+    {
+        OHOS::Dmabuf::ScopedCpuAccess access(moved, DMA_BUF_HEAP_BUF_SYNC_READ);
+        ASSERT_STREQ("libdmabufheap", (char *)access.GetAddr());
+    }
+
+    /* destruction gives the buffer back to the pool */
+    moved.Reset();
+    DmabufHeapPoolStats stats;
+    ASSERT_EQ(0, DmabufHeapPoolGetStats(heap.GetPool(), &stats));
+    ASSERT_EQ(1, stats.cachedBuffers);
+    OHOS::Dmabuf::DmabufBuffer recycled = heap.Alloc(BUFFER_SIZE, DMA_OWNER_MEDIA_CODEC);
+    ASSERT_TRUE(recycled.IsValid());
+    ASSERT_EQ(0, DmabufHeapPoolGetStats(heap.GetPool(), &stats));
+    ASSERT_EQ(1, stats.hits);
+}
+HWTEST_F(DmabufAllocTest, SyncTrackingElision, Function|MediumTest|Level1)
+{
+    ASSERT_STRNE(heapName.c_str(), "");
+
+    int heapFd = DmabufHeapOpen(heapName.c_str());
+    ASSERT_GE(heapFd, 0);
+
+    DmabufHeapBuffer buffer = { .size = BUFFER_SIZE, .heapFlags = 0 };
+    ASSERT_EQ(0, DmabufHeapBufferAlloc(heapFd, &buffer));
+
+    DmabufHeapSetSyncTracking(true);
+    DmabufHeapSyncStats before;
+    ASSERT_EQ(0, DmabufHeapGetSyncStats(&before));
+
+    /* READ nested in RW is elided */
+    ASSERT_EQ(0, DmabufHeapBufferSyncStart(buffer.fd, DMA_BUF_HEAP_BUF_SYNC_RW));
+    ASSERT_EQ(0, DmabufHeapBufferSyncStart(buffer.fd, DMA_BUF_HEAP_BUF_SYNC_READ));
+    ASSERT_EQ(0, DmabufHeapBufferSyncEnd(buffer.fd, DMA_BUF_HEAP_BUF_SYNC_READ));
+    ASSERT_EQ(0, DmabufHeapBufferSyncEnd(buffer.fd, DMA_BUF_HEAP_BUF_SYNC_RW));
+
+    /* WRITE nested in READ widens the access */
+    ASSERT_EQ(0, DmabufHeapBufferSyncStart(buffer.fd, DMA_BUF_HEAP_BUF_SYNC_READ));
+    ASSERT_EQ(0, DmabufHeapBufferSyncStart(buffer.fd, DMA_BUF_HEAP_BUF_SYNC_WRITE));
+    ASSERT_EQ(0, DmabufHeapBufferSyncEnd(buffer.fd, DMA_BUF_HEAP_BUF_SYNC_WRITE));
+    ASSERT_EQ(0, DmabufHeapBufferSyncEnd(buffer.fd, DMA_BUF_HEAP_BUF_SYNC_READ));
+
+    DmabufHeapSyncStats after;
+    ASSERT_EQ(0, DmabufHeapGetSyncStats(&after));
+    DmabufHeapSetSyncTracking(false);
+    ASSERT_EQ(5, after.issued - before.issued);
+    ASSERT_EQ(3, after.elided - before.elided);
+
+    /* a buffer given back to a pool with an access left open is recycled without it */
+    DmabufHeapPool *pool = DmabufHeapPoolCreate(heapFd, nullptr);
+    ASSERT_TRUE(pool != nullptr);
+    DmabufHeapBuffer pooled = { .size = BUFFER_SIZE, .heapFlags = 0 };
+    ASSERT_EQ(0, DmabufHeapPoolAlloc(pool, &pooled));
+    DmabufHeapSetSyncTracking(true);
+    ASSERT_EQ(0, DmabufHeapBufferSyncStart(pooled.fd, DMA_BUF_HEAP_BUF_SYNC_RW));
+    ASSERT_EQ(0, DmabufHeapPoolFree(pool, &pooled));
+    ASSERT_EQ(0, DmabufHeapPoolAlloc(pool, &pooled));
+    ASSERT_EQ(0, DmabufHeapGetSyncStats(&before));
+    ASSERT_EQ(0, DmabufHeapBufferSyncStart(pooled.fd, DMA_BUF_HEAP_BUF_SYNC_READ));
+    ASSERT_EQ(0, DmabufHeapBufferSyncEnd(pooled.fd, DMA_BUF_HEAP_BUF_SYNC_READ));
+    ASSERT_EQ(0, DmabufHeapGetSyncStats(&after));
+    DmabufHeapSetSyncTracking(false);
+    ASSERT_EQ(2, after.issued - before.issued);
+    ASSERT_EQ(0, after.elided - before.elided);
+    ASSERT_EQ(0, DmabufHeapPoolFree(pool, &pooled));
+    DmabufHeapPoolDestroy(pool);
+
+    ASSERT_EQ(0, DmabufHeapBufferFree(&buffer));
+
+    ASSERT_EQ(0, DmabufHeapClose(heapFd));
+}
+HWTEST_F(DmabufAllocTest, StatsPerHeapAndOwner, Function|MediumTest|Level1)
+{
+    ASSERT_STRNE(heapName.c_str(), "");
+
+    int heapFd = DmabufHeapOpen(heapName.c_str());
+    ASSERT_GE(heapFd, 0);
+
+    DmabufHeapStatsSnapshot before;
+    ASSERT_EQ(0, DmabufHeapGetStatsSnapshot(&before));
+
+    const unsigned int count = 2;
+    DmabufHeapBuffer buffers[count];
+    for (auto &buffer : buffers) {
+        buffer = { .size = BUFFER_SIZE, .heapFlags = 0 };
+        SetOwnerIdForHeapFlags(&buffer, DMA_OWNER_GPU);
+    }
+    DmabufHeapSetBufferNaming(true);
+    ASSERT_EQ(0, DmabufHeapBufferAllocBatch(heapFd, buffers, count));
+    DmabufHeapSetBufferNaming(false);
+
+    DmabufHeapStatsSnapshot after;
+    ASSERT_EQ(0, DmabufHeapGetStatsSnapshot(&after));
+    ASSERT_GE(after.timeNs, before.timeNs);
+    ASSERT_STREQ("gpu", after.ownerNames[DMA_OWNER_GPU]);
+    ASSERT_EQ(count, after.owners[DMA_OWNER_GPU].liveBuffers - before.owners[DMA_OWNER_GPU].liveBuffers);
+    ASSERT_EQ(count * BUFFER_SIZE, after.owners[DMA_OWNER_GPU].liveBytes - before.owners[DMA_OWNER_GPU].liveBytes);
+    ASSERT_EQ(count, after.sizeHistogram[0] - before.sizeHistogram[0]);
+    unsigned int heap = 1;
+    for (; heap < after.heapCount; heap++) {
+        if (heapName == after.heapNames[heap]) {
+            break;
+        }
+    }
+    ASSERT_LT(heap, after.heapCount);
+    ASSERT_EQ(count, after.heaps[heap].allocCount - before.heaps[heap].allocCount);
+
+    ASSERT_EQ(0, DmabufHeapBufferFreeBatch(buffers, count));
+    ASSERT_EQ(0, DmabufHeapGetStatsSnapshot(&after));
+    ASSERT_EQ(before.owners[DMA_OWNER_GPU].liveBuffers, after.owners[DMA_OWNER_GPU].liveBuffers);
+    ASSERT_EQ(before.owners[DMA_OWNER_GPU].liveBytes, after.owners[DMA_OWNER_GPU].liveBytes);
+
+    ASSERT_EQ(0, DmabufHeapClose(heapFd));
+}
+HWTEST_F(DmabufAllocTest, ProviderMemfdHeap, Function|MediumTest|Level1)
+{
+    DmabufHeapProviderType provider = DmabufHeapGetProvider();
+    ASSERT_EQ(-EINVAL, DmabufHeapSetProvider(static_cast<DmabufHeapProviderType>(-1)));
+    ASSERT_EQ(0, DmabufHeapSetProvider(DMA_HEAP_PROVIDER_MEMFD));
+    ASSERT_EQ(DMA_HEAP_PROVIDER_MEMFD, DmabufHeapGetProvider());
+
+    ASSERT_EQ(-1, DmabufHeapOpen("invalid"));
+    int heapFd = DmabufHeapOpen(DMA_HEAP_PROVIDER_EMULATED_HEAP);
+    ASSERT_GE(heapFd, 0);
+    ASSERT_EQ(0, DmabufHeapSetProvider(provider));
+
+    /* the heap keeps its provider, its buffers are mapped and synced as dma-bufs are */
+    DmabufHeapBuffer buffer = { .size = BUFFER_SIZE, .heapFlags = 0 };
+    ASSERT_EQ(0, DmabufHeapBufferAlloc(heapFd, &buffer));
+    void *ptr = DmabufHeapBufferBeginCpuAccess(&buffer, DMA_BUF_HEAP_BUF_SYNC_RW);
+    ASSERT_TRUE(ptr != nullptr);
+    ASSERT_GE(sprintf_s((char *)ptr, BUFFER_SIZE, "libdmabufheap"), 0);
+    ASSERT_EQ(0, DmabufHeapBufferEndCpuAccess(&buffer, DMA_BUF_HEAP_BUF_SYNC_RW));
+
+    int sharedFd = dup(buffer.fd);
+    ASSERT_GE(sharedFd, 0);
+    void *sharedPtr = mmap(NULL, BUFFER_SIZE, PROT_READ, MAP_SHARED, sharedFd, 0);
+    ASSERT_TRUE(sharedPtr != MAP_FAILED);
+    ASSERT_STREQ("libdmabufheap", (char *)sharedPtr);
+    ASSERT_EQ(0, munmap(sharedPtr, BUFFER_SIZE));
+    ASSERT_EQ(0, close(sharedFd));
+
+    ASSERT_EQ(0, DmabufHeapBufferFree(&buffer));
+    ASSERT_EQ(0, DmabufHeapClose(heapFd));
+}
+HWTEST_F(DmabufAllocTest, ImportMemfdBuffer, Function|MediumTest|Level1)
+{
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    int memfd = memfd_create("dmabuf_import_test", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    ASSERT_GE(memfd, 0);
+    ASSERT_EQ(0, ftruncate(memfd, pageSize * 2)); /* 2: import the second page */
+
+    DmabufHeapBuffer buffer = { .size = 0, .heapFlags = 0 };
+    ASSERT_EQ(-EINVAL, DmabufHeapImportMemfd(memfd, 1, pageSize, &buffer));
+    ASSERT_EQ(-EINVAL, DmabufHeapImportMemfd(memfd, 0, 0, &buffer));
+    int ret = DmabufHeapImportMemfd(memfd, pageSize, pageSize, &buffer);
+    ASSERT_NE(0, fcntl(memfd, F_GET_SEALS) & F_SEAL_SHRINK);
+    if (ret == -ENOENT) {
+        /* no /dev/udmabuf */
+        ASSERT_EQ(0, close(memfd));
+        return;
+    }
+    ASSERT_EQ(0, ret);
+    ASSERT_EQ(pageSize, buffer.size);
+
+    /* the dma-buf and the memfd share the page */
+    void *ptr = DmabufHeapBufferBeginCpuAccess(&buffer, DMA_BUF_HEAP_BUF_SYNC_WRITE);
+    ASSERT_TRUE(ptr != nullptr);
+    ASSERT_GE(sprintf_s((char *)ptr, pageSize, "libdmabufheap"), 0);
+    ASSERT_EQ(0, DmabufHeapBufferEndCpuAccess(&buffer, DMA_BUF_HEAP_BUF_SYNC_WRITE));
+    char text[sizeof("libdmabufheap")] = { 0 };
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(text)), pread(memfd, text, sizeof(text), pageSize));
+    ASSERT_STREQ("libdmabufheap", text);
+
+    ASSERT_EQ(0, close(memfd));
+    ASSERT_EQ(0, DmabufHeapBufferFree(&buffer));
+}
+}
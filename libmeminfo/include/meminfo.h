@@ -84,6 +84,13 @@ struct DmaNodeInfoWrapper {
     }
 };
 
+struct DmabufHeapUsage {
+    std::string name;
+    uint64_t liveBytes;
+    uint64_t liveBuffers;
+    uint64_t allocCount;
+};
+
 // get deduplicated DMA information
 std::vector<DmaNodeInfoWrapper> GetDmaInfo(int pid);
 
@@ -108,6 +115,10 @@ bool GetGraphicsMemory(const int pid, uint64_t &gl, uint64_t &graph);
 // get the total memory usage of app, include DMA, GL, Pss and SwapPss
 int64_t GetAppsTotalMemory(const std::vector<int> &pidList);
 
+// get the dma-buf usage counted by libdmabufheap in this process, per heap and per owner,
+// owners are indexed by DmaHeapFlagOwnerId. Return false if libdmabufheap is not loaded
+bool GetDmabufHeapUsage(std::vector<DmabufHeapUsage> &heaps, std::vector<DmabufHeapUsage> &owners);
+
 } /* namespace MemInfo */
 } /* namespace OHOS */
 #endif /* LIB_MEM_INFO_H */
\ No newline at end of file
@@ -15,10 +15,12 @@
 
 #include "meminfo.h"
 
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <v1_0/imemory_tracker_interface.h>
 
+#include "dmabuf_stats.h"
 #include "file_ex.h" // LoadStringFromFile
 #include "hilog/log.h"
 #include <dlfcn.h>
@@ -271,5 +273,42 @@ int64_t GetAppsTotalMemory(const std::vector<int> &pidList)
     return dmaMem + pssAndSwapPssMem + gpuMem;
 }
 
+// get the dma-buf usage counted by libdmabufheap in this process, per heap and per owner
+bool GetDmabufHeapUsage(std::vector<DmabufHeapUsage> &heaps, std::vector<DmabufHeapUsage> &owners)
+{
+    // the counters live in this process, there are none if libdmabufheap is not loaded
+    auto libDmabufHeapHandle = dlopen("libdmabufheap.z.so", RTLD_NOW | RTLD_NOLOAD);
+    if (!libDmabufHeapHandle) {
+        return false;
+    }
+    using GetSnapshotFunc = int (*)(DmabufHeapStatsSnapshot*);
+    auto func = reinterpret_cast<GetSnapshotFunc>(dlsym(libDmabufHeapHandle, "DmabufHeapGetStatsSnapshot"));
+    if (!func) {
+        HILOG_ERROR(LOG_CORE, "%{public}s, dlsym DmabufHeapGetStatsSnapshot failed.", __func__);
+        dlclose(libDmabufHeapHandle);
+        return false;
+    }
+    auto snapshot = std::make_unique<DmabufHeapStatsSnapshot>();
+    if (func(snapshot.get()) != 0) {
+        dlclose(libDmabufHeapHandle);
+        return false;
+    }
+    dlclose(libDmabufHeapHandle);
+
+    heaps.clear();
+    for (unsigned int i = 0; i < snapshot->heapCount; ++i) {
+        const DmabufHeapCounters &counters = snapshot->heaps[i];
+        std::string name(snapshot->heapNames[i], strnlen(snapshot->heapNames[i], DMA_HEAP_STATS_NAME_LEN));
+        heaps.push_back({ name, counters.liveBytes, counters.liveBuffers, counters.allocCount });
+    }
+    owners.clear();
+    for (unsigned int i = 0; i < COUNT_DMA_OWNER; ++i) {
+        const DmabufHeapCounters &counters = snapshot->owners[i];
+        std::string name(snapshot->ownerNames[i], strnlen(snapshot->ownerNames[i], DMA_HEAP_STATS_NAME_LEN));
+        owners.push_back({ name, counters.liveBytes, counters.liveBuffers, counters.allocCount });
+    }
+    return true;
+}
+
 } /* namespace MemInfo */
 } /* namespace OHOS */
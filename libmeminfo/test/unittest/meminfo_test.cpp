@@ -17,6 +17,8 @@
 #include <dlfcn.h>
 
 #include "gtest/gtest.h"
+#include "dmabuf_alloc.h"
+#include "dmabuf_provider.h"
 #include "meminfo.h"
 
 namespace OHOS {
@@ -186,5 +188,42 @@ HWTEST_F(MemInfoTest, GetAppsTotalMemory_Test, TestSize.Level1)
     ASSERT_EQ(totalMem >= 0, true);
 }
 
+HWTEST_F(MemInfoTest, GetDmabufHeapUsage_Test, TestSize.Level1)
+{
+    // libdmabufheap is linked, so its counters of this process are found; without a system heap use the emulated one
+    int heapFd = DmabufHeapOpen(DMA_HEAP_PROVIDER_EMULATED_HEAP);
+    if (heapFd < 0) {
+        ASSERT_EQ(DmabufHeapSetProvider(DMA_HEAP_PROVIDER_EMULATED), 0);
+        heapFd = DmabufHeapOpen(DMA_HEAP_PROVIDER_EMULATED_HEAP);
+    }
+    ASSERT_GE(heapFd, 0);
+    std::vector<DmabufHeapUsage> heaps;
+    std::vector<DmabufHeapUsage> owners;
+    ASSERT_EQ(GetDmabufHeapUsage(heaps, owners), true);
+    ASSERT_EQ(owners.size(), static_cast<size_t>(COUNT_DMA_OWNER));
+    ASSERT_EQ(owners[DMA_OWNER_GPU].name, "gpu");
+    uint64_t liveBytes = owners[DMA_OWNER_GPU].liveBytes;
+    uint64_t liveBuffers = owners[DMA_OWNER_GPU].liveBuffers;
+
+    const size_t size = 4096;
+    DmabufHeapBuffer buffer = { .size = size, .heapFlags = 0 };
+    SetOwnerIdForHeapFlags(&buffer, DMA_OWNER_GPU);
+    ASSERT_EQ(DmabufHeapBufferAlloc(heapFd, &buffer), 0);
+    ASSERT_EQ(GetDmabufHeapUsage(heaps, owners), true);
+    ASSERT_EQ(owners[DMA_OWNER_GPU].liveBytes, liveBytes + size);
+    ASSERT_EQ(owners[DMA_OWNER_GPU].liveBuffers, liveBuffers + 1);
+    bool heapFound = false;
+    for (const auto &heap : heaps) {
+        heapFound = heapFound || (heap.name == DMA_HEAP_PROVIDER_EMULATED_HEAP && heap.liveBytes >= size);
+    }
+    ASSERT_EQ(heapFound, true);
+
+    ASSERT_EQ(DmabufHeapBufferFree(&buffer), 0);
+    ASSERT_EQ(GetDmabufHeapUsage(heaps, owners), true);
+    ASSERT_EQ(owners[DMA_OWNER_GPU].liveBytes, liveBytes);
+    ASSERT_EQ(owners[DMA_OWNER_GPU].liveBuffers, liveBuffers);
+    ASSERT_EQ(DmabufHeapClose(heapFd), 0);
+}
+
 }
 }
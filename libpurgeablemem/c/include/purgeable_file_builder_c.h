@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_C_INCLUDE_PURGEABLE_FILE_BUILDER_C_H
+#define OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_C_INCLUDE_PURGEABLE_FILE_BUILDER_C_H
+
+#include <stdbool.h> /* bool */
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif /* End of #if __cplusplus */
+#endif /* End of #ifdef __cplusplus */
+
+/*
+ * Builder param which rebuilds the content of a PurgMem obj from a range of a local file.
+ * The file is read straight into the content with readahead hints.
+ * The range starts at @fileOffset of the file and is as long as the content,
+ * a file too short to fill the content fails the build.
+ */
+struct PurgMemFileRange;
+
+/*
+ * PurgMemFileRangeCreate: create a file range param.
+ * Input:   @fd: the file, it is duplicated and may be closed after the call.
+ * Input:   @fileOffset: offset of the content in the file.
+ * Return:  a file range param, NULL if @fd cannot be duplicated.
+ */
+struct PurgMemFileRange *PurgMemFileRangeCreate(int fd, uint64_t fileOffset);
+
+/* destroy @range, no PurgMem obj may use it any longer */
+void PurgMemFileRangeDestroy(struct PurgMemFileRange *range);
+
+/*
+ * PurgMemFileRangeBuild: a PurgMemModifyFunc, pass it with a PurgMemFileRange as @funcPara
+ * to PurgMemCreate() or PurgMemAppendModify().
+ */
+bool PurgMemFileRangeBuild(void *data, size_t size, void *param);
+
+/*
+ * PurgMemFileRangeBuildRange: read only [@offset, @offset + @len) of the content from the file,
+ * e.g. to rebuild the part of the content that is needed. Disjoint ranges may be read concurrently.
+ * Input:   @data, @size: start address and size of the whole content.
+ * Return:  false if the range exceeds the content or the file.
+ */
+bool PurgMemFileRangeBuildRange(struct PurgMemFileRange *range, void *data, size_t size, size_t offset,
+                                size_t len);
+
+/* total bytes read from the file by all builds of @range so far */
+uint64_t PurgMemFileRangeGetBytesRead(struct PurgMemFileRange *range);
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* End of #if __cplusplus */
+#endif /* End of #ifdef __cplusplus */
+
+#endif /* OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_C_INCLUDE_PURGEABLE_FILE_BUILDER_C_H */
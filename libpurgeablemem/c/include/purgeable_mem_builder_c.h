@@ -40,9 +40,12 @@ bool PurgMemBuilderAppendFunc(struct PurgMemBuilder *builder, PurgMemBuilderFunc
 
 bool PurgMemBuilderAppendBuilder(struct PurgMemBuilder *builder, struct PurgMemBuilder *newcomer);
 
-/* build @data content from @builder */
+/* build @data content from @builder, each builder in the chain is timed */
 bool PurgMemBuilderBuildAll(struct PurgMemBuilder *builder, void *data, size_t size);
 
+/* rolling average build cost of @builder and all builders appended to it, in ns per byte */
+double PurgMemBuilderGetCost(struct PurgMemBuilder *builder);
+
 #ifdef __cplusplus
 #if __cplusplus
 }
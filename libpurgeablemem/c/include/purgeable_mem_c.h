@@ -18,6 +18,7 @@
 
 #include <stdbool.h> /* bool */
 #include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
 
 #ifdef __cplusplus
 #if __cplusplus
@@ -37,6 +38,14 @@ struct PurgMem;
  */
 typedef bool (*PurgMemModifyFunc)(void *, size_t, void *);
 
+/*
+ * Function pointer, it points to a function called after content of a PurgMem obj is rebuilt.
+ * Input:   struct PurgMem *: the PurgMem obj, no lock of it is held during the call.
+ * Input:   uint64_t: generation of the rebuilt content.
+ * Input:   void *: other private parameters.
+ */
+typedef void (*PurgMemRebuildListener)(struct PurgMem *, uint64_t, void *);
+
 /*
  * PurgMemCreate: create a PurgMem obj.
  * Input:   @size: data size of a PurgMem obj's content.
@@ -119,9 +128,46 @@ size_t PurgMemGetContentSize(struct PurgMem *purgObj);
  * Input:   @func: function pointer, it will modify content of @PurgMem.
  * Input:   @funcPara: parameters used by @func.
  * Return:  append result, true is success, while false is fail.
+ * If @purgObj's content is purged or never built, @func is not called now,
+ * it will be called when the content is rebuilt.
  */
 bool PurgMemAppendModify(struct PurgMem *purgObj, PurgMemModifyFunc func, void *funcPara);
 
+/*
+ * PurgMemGetGeneration: get generation of a PurgMem obj's content, without taking any lock.
+ * Input:   @purgObj: a PurgMem obj.
+ * Return:  a number that changes whenever the content is rebuilt, 0 if it has never been built
+ *          or @purgObj is NULL. Data derived from the content stays valid as long as
+ *          the generation is the same as when it was derived.
+ */
+uint64_t PurgMemGetGeneration(struct PurgMem *purgObj);
+
+/*
+ * PurgMemGetRebuildCost: get rolling average cost to rebuild a PurgMem obj's content.
+ * Input:   @purgObj: a PurgMem obj.
+ * Return:  sum of the build cost of its builder and modifies, in ns per byte of content.
+ *          0 if it has never been built or @purgObj is NULL.
+ * Objs with the lowest cost are the cheapest to purge.
+ */
+double PurgMemGetRebuildCost(struct PurgMem *purgObj);
+
+/*
+ * PurgMemAddRebuildListener: subscribe to rebuilds of a PurgMem obj's content.
+ * Input:   @purgObj: a PurgMem obj.
+ * Input:   @func: called once per rebuild, after PurgMemBeginRead() or PurgMemEndWrite().
+ *          It must not add or remove listeners of @purgObj.
+ * Input:   @funcPara: parameters used by @func.
+ * Return:  true is success, while false is fail.
+ */
+bool PurgMemAddRebuildListener(struct PurgMem *purgObj, PurgMemRebuildListener func, void *funcPara);
+
+/*
+ * PurgMemRemoveRebuildListener: remove a listener added with the same @func and @funcPara.
+ * Input:   @purgObj: a PurgMem obj.
+ * Return:  true if the listener is found and removed, it is not called after this function returns.
+ */
+bool PurgMemRemoveRebuildListener(struct PurgMem *purgObj, PurgMemRebuildListener func, void *funcPara);
+
 #ifdef __cplusplus
 #if __cplusplus
 }
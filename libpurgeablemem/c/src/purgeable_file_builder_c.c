@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h> /* posix_fadvise */
+#include <stdatomic.h>
+#include <stdlib.h> /* malloc */
+#include <unistd.h> /* pread */
+
+#include "hilog/log_c.h"
+#include "pm_ptr_util.h"
+#include "pm_log_c.h"
+#include "purgeable_file_builder_c.h"
+
+#undef LOG_TAG
+#define LOG_TAG "PurgeableMemC: FileBuilder"
+
+struct PurgMemFileRange {
+    int fd;
+    uint64_t fileOffset;
+    _Atomic uint64_t bytesRead;
+};
+
+struct PurgMemFileRange *PurgMemFileRangeCreate(int fd, uint64_t fileOffset)
+{
+    int dupFd = (fd >= 0) ? fcntl(fd, F_DUPFD_CLOEXEC, 0) : -1;
+    if (dupFd < 0) {
+        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: dup fd %{public}d fail, errno %{public}d", __func__, fd, errno);
+        return NULL;
+    }
+    struct PurgMemFileRange *range = (struct PurgMemFileRange *)malloc(sizeof(struct PurgMemFileRange));
+    if (!range) {
+        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: malloc struct PurgMemFileRange fail", __func__);
+        close(dupFd);
+        return NULL;
+    }
+    range->fd = dupFd;
+    range->fileOffset = fileOffset;
+    atomic_init(&range->bytesRead, 0);
+    return range;
+}
+
+void PurgMemFileRangeDestroy(struct PurgMemFileRange *range)
+{
+    IF_NULL_LOG_ACTION(range, "range is NULL", return);
+    close(range->fd);
+    free(range);
+}
+
+bool PurgMemFileRangeBuild(void *data, size_t size, void *param)
+{
+    return PurgMemFileRangeBuildRange((struct PurgMemFileRange *)param, data, size, 0, size);
+}
+
+bool PurgMemFileRangeBuildRange(struct PurgMemFileRange *range, void *data, size_t size, size_t offset,
+                                size_t len)
+{
+    IF_NULL_LOG_ACTION(range, "range is NULL", return false);
+    IF_NULL_LOG_ACTION(data, "data is NULL", return false);
+    if (offset > size || len > size - offset) {
+        return false;
+    }
+    uint64_t fileOffset = range->fileOffset + offset;
+    /* only a hint, the read below still works if the kernel ignores it */
+    posix_fadvise(range->fd, (off_t)fileOffset, (off_t)len, POSIX_FADV_WILLNEED);
+    char *dst = (char *)data + offset;
+    while (len > 0) {
+        ssize_t n = pread(range->fd, dst, len, (off_t)fileOffset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: read at %{public}llu fail, errno %{public}d",
+                __func__, (unsigned long long)fileOffset, errno);
+            return false;
+        }
+        atomic_fetch_add_explicit(&range->bytesRead, (uint64_t)n, memory_order_relaxed);
+        dst += n;
+        len -= (size_t)n;
+        fileOffset += (uint64_t)n;
+    }
+    return true;
+}
+
+uint64_t PurgMemFileRangeGetBytesRead(struct PurgMemFileRange *range)
+{
+    IF_NULL_LOG_ACTION(range, "range is NULL", return 0);
+    return atomic_load_explicit(&range->bytesRead, memory_order_relaxed);
+}
@@ -16,6 +16,7 @@
 #include <stdbool.h> /* bool */
 #include <stddef.h> /* NULL */
 #include <stdlib.h> /* malloc */
+#include <time.h> /* clock_gettime */
 
 #include "hilog/log_c.h"
 #include "pm_ptr_util.h"
@@ -25,17 +26,29 @@
 #undef LOG_TAG
 #define LOG_TAG "PurgeableMemC: Builder"
 
+/* rolling build cost: each new sample moves the average by 1 / REBUILD_COST_WEIGHT of the difference */
+#define REBUILD_COST_WEIGHT 4
+#define NS_PER_SEC 1000000000LL
+
 /* purgeable mem builder */
 struct PurgMemBuilder {
     struct PurgMemBuilder *nextBuilder;
     PurgMemBuilderFunc Build;
     void *param;
     const char *name;
+    double costNsPerByte; /* rolling average of this builder alone */
 };
 
 /* append a guest builder @newcomer to @head */
 static void AppendBuilder(struct PurgMemBuilder *head, struct PurgMemBuilder *newcomer);
 
+static inline long long NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
 struct PurgMemBuilder *PurgMemBuilderCreate(PurgMemBuilderFunc func, void *param, const char *name)
 {
     IF_NULL_LOG_ACTION(func, "func is NULL", return NULL);
@@ -50,6 +63,7 @@ struct PurgMemBuilder *PurgMemBuilderCreate(PurgMemBuilderFunc func, void *param
     builder->nextBuilder = NULL;
     builder->param = param;
     builder->name = name;
+    builder->costNsPerByte = 0;
     return builder;
 }
 
@@ -93,16 +107,31 @@ bool PurgMemBuilderBuildAll(struct PurgMemBuilder *builder, void *data, size_t s
         PM_HILOG_ERROR_C(LOG_CORE, "builder has no Build(), %{public}s", builder->name);
         return true;
     }
+    long long start = NowNs();
     if (!(builder->Build(data, size, builder->param))) {
         PM_HILOG_ERROR_C(LOG_CORE, "build data failed, name %{public}s", builder->name ?: "NULL");
         return false;
     }
+    if (size > 0) {
+        double sample = (double)(NowNs() - start) / size;
+        double avg = builder->costNsPerByte;
+        builder->costNsPerByte = (avg == 0) ? sample : avg + (sample - avg) / REBUILD_COST_WEIGHT;
+    }
     if (!(builder->nextBuilder)) {
         return true;
     }
     return PurgMemBuilderBuildAll(builder->nextBuilder, data, size);
 }
 
+double PurgMemBuilderGetCost(struct PurgMemBuilder *builder)
+{
+    double cost = 0;
+    for (struct PurgMemBuilder *curr = builder; curr; curr = curr->nextBuilder) {
+        cost += curr->costNsPerByte;
+    }
+    return cost;
+}
+
 bool PurgMemBuilderAppendBuilder(struct PurgMemBuilder *builder, struct PurgMemBuilder *newcomer)
 {
     IF_NULL_LOG_ACTION(builder, "input builder is NULL", return false);
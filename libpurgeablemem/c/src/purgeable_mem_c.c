@@ -16,12 +16,14 @@
 #include <stdlib.h> /* malloc */
 #include <sys/mman.h> /* mmap */
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h> /* FILE */
 
 #include "securec.h"
 #include "pm_ptr_util.h"
 #include "pm_util.h"
 #include "pm_state_c.h"
+#include "pm_trace_c.h"
 #include "ux_page_table_c.h"
 #include "purgeable_mem_builder_c.h"
 #include "pm_log_c.h"
@@ -30,15 +32,47 @@
 #undef LOG_TAG
 #define LOG_TAG "PurgeableMemC"
 
+#define PM_CACHE_LINE_SIZE 64
+/* readers spread over this many counters, so concurrent readers rarely write the same line */
+#define PM_READER_STRIPES 8
+
+struct PurgMemReaderStripe {
+    _Alignas(PM_CACHE_LINE_SIZE) _Atomic uint32_t count;
+};
+
+struct PurgMemListenerNode {
+    PurgMemRebuildListener func;
+    void *funcPara;
+    struct PurgMemListenerNode *next;
+};
+
 struct PurgMem {
     void *dataPtr;
     size_t dataSizeInput;
     struct PurgMemBuilder *builder;
     UxPageTableStruct *uxPageTable;
-    pthread_rwlock_t rwlock;
-    unsigned int buildDataCount;
+    /*
+     * Readers take no lock: they count themselves in the @readers stripe of their thread, then go
+     * on if @seq is even and the content is present. Writers and rebuilders hold @writeLock, make
+     * @seq odd so that new readers back off, and wait on @drainCond until the sum of @readers is 0.
+     * A read may end on another thread than it began, the sum wraps back to the right count.
+     */
+    _Atomic uint32_t seq;
+    pthread_mutex_t writeLock;
+    pthread_mutex_t drainLock;
+    pthread_cond_t drainCond;
+    unsigned int buildDataCount; /* written only with @seq odd */
+    _Atomic uint64_t generation;
+    bool rebuiltInWrite; /* protected by writeLock, listeners are notified in PurgMemEndWrite() */
+    pthread_mutex_t listenerLock;
+    struct PurgMemListenerNode *listeners;
+    /* the only lines written by readers, kept apart from the fields they read */
+    struct PurgMemReaderStripe readers[PM_READER_STRIPES];
 };
 
+static _Atomic uint32_t g_nextReaderStripe = 0;
+static _Thread_local uint32_t g_readerStripe = PM_READER_STRIPES; /* not assigned yet */
+
 static inline void LogPurgMemInfo(struct PurgMem *obj)
 {
     if (obj == NULL) {
@@ -67,11 +101,102 @@ static bool IsPurgMemPtrValid(struct PurgMem *purgObj);
 static bool IsPurged(struct PurgMem *purgObj);
 static int TypeCast(void);
 
+static bool InitLocks(struct PurgMem *purgObj)
+{
+    int ret = pthread_mutex_init(&(purgObj->writeLock), NULL);
+    if (ret != 0) {
+        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: init writeLock fail, %{public}d", __func__, ret);
+        return false;
+    }
+    ret = pthread_mutex_init(&(purgObj->drainLock), NULL);
+    if (ret != 0) {
+        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: init drainLock fail, %{public}d", __func__, ret);
+        goto destroy_write_lock;
+    }
+    ret = pthread_cond_init(&(purgObj->drainCond), NULL);
+    if (ret != 0) {
+        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: init drainCond fail, %{public}d", __func__, ret);
+        goto destroy_drain_lock;
+    }
+    ret = pthread_mutex_init(&(purgObj->listenerLock), NULL);
+    if (ret != 0) {
+        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: init listenerLock fail, %{public}d", __func__, ret);
+        goto destroy_drain_cond;
+    }
+    return true;
+
+destroy_drain_cond:
+    pthread_cond_destroy(&(purgObj->drainCond));
+destroy_drain_lock:
+    pthread_mutex_destroy(&(purgObj->drainLock));
+destroy_write_lock:
+    pthread_mutex_destroy(&(purgObj->writeLock));
+    return false;
+}
+
+static void DestroyLocks(struct PurgMem *purgObj)
+{
+    pthread_mutex_destroy(&(purgObj->listenerLock));
+    pthread_cond_destroy(&(purgObj->drainCond));
+    pthread_mutex_destroy(&(purgObj->drainLock));
+    pthread_mutex_destroy(&(purgObj->writeLock));
+}
+
+static inline _Atomic uint32_t *GetReaderCounter(struct PurgMem *purgObj)
+{
+    if (g_readerStripe >= PM_READER_STRIPES) {
+        g_readerStripe = atomic_fetch_add_explicit(&g_nextReaderStripe, 1, memory_order_relaxed) % PM_READER_STRIPES;
+    }
+    return &(purgObj->readers[g_readerStripe].count);
+}
+
+static uint32_t SumReaders(struct PurgMem *purgObj)
+{
+    uint32_t sum = 0;
+    for (int i = 0; i < PM_READER_STRIPES; i++) {
+        sum += atomic_load(&(purgObj->readers[i].count));
+    }
+    return sum;
+}
+
+/*
+ * BeginExclusive: called with writeLock held, return when no reader is in the content.
+ * Readers coming later see @seq odd and wait for writeLock.
+ */
+static void BeginExclusive(struct PurgMem *purgObj)
+{
+    atomic_fetch_add(&(purgObj->seq), 1);
+    pthread_mutex_lock(&(purgObj->drainLock));
+    while (SumReaders(purgObj) != 0) {
+        pthread_cond_wait(&(purgObj->drainCond), &(purgObj->drainLock));
+    }
+    pthread_mutex_unlock(&(purgObj->drainLock));
+}
+
+static void EndExclusive(struct PurgMem *purgObj)
+{
+    atomic_fetch_add(&(purgObj->seq), 1);
+}
+
+static inline void ReaderLeave(struct PurgMem *purgObj)
+{
+    /*
+     * A reader cannot tell whether it is the last one, so each one leaving while a writer waits in
+     * BeginExclusive() wakes it up to sum the stripes again. Readers hardly ever hit this path.
+     */
+    atomic_fetch_sub(GetReaderCounter(purgObj), 1);
+    if ((atomic_load(&(purgObj->seq)) & 1) != 0) {
+        pthread_mutex_lock(&(purgObj->drainLock));
+        pthread_cond_broadcast(&(purgObj->drainCond));
+        pthread_mutex_unlock(&(purgObj->drainLock));
+    }
+}
+
 static struct PurgMem *PurgMemCreate_(size_t len, struct PurgMemBuilder *builder)
 {
     /* PurgMemObj allow no builder temporaily */
     struct PurgMem *pugObj = NULL;
-    pugObj = (struct PurgMem *)malloc(sizeof(struct PurgMem));
+    pugObj = (struct PurgMem *)aligned_alloc(PM_CACHE_LINE_SIZE, RoundUp(sizeof(struct PurgMem), PM_CACHE_LINE_SIZE));
     if (!pugObj) {
         PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: malloc struct PurgMem fail", __func__);
         return NULL;
@@ -96,14 +221,19 @@ static struct PurgMem *PurgMemCreate_(size_t len, struct PurgMemBuilder *builder
             "%{public}s: InitUxPageTable fail, %{public}s", __func__, GetPMStateName(err));
         goto free_uxpt;
     }
-    int lockInitRet = pthread_rwlock_init(&(pugObj->rwlock), NULL);
-    if (lockInitRet != 0) {
-        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: pthread_rwlock_init fail, %{public}d", __func__, lockInitRet);
+    if (!InitLocks(pugObj)) {
         goto deinit_upt;
     }
     pugObj->builder = builder;
     pugObj->dataSizeInput = len;
     pugObj->buildDataCount = 0;
+    atomic_init(&(pugObj->seq), 0);
+    for (int i = 0; i < PM_READER_STRIPES; i++) {
+        atomic_init(&(pugObj->readers[i].count), 0);
+    }
+    atomic_init(&(pugObj->generation), 0);
+    pugObj->rebuiltInWrite = false;
+    pugObj->listeners = NULL;
 
     PM_HILOG_INFO_C(LOG_CORE, "%{public}s: LogPurgMemInfo:", __func__);
     LogPurgMemInfo(pugObj);
@@ -153,11 +283,12 @@ struct PurgMem *PurgMemCreate(size_t len, PurgMemModifyFunc func, void *funcPara
 bool PurgMemDestroy(struct PurgMem *purgObj)
 {
     IF_NULL_LOG_ACTION(purgObj, "input is NULL", return true);
-    int rwlockRet = pthread_rwlock_wrlock(&(purgObj->rwlock));
-    if (rwlockRet) {
-        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: wrlock fail. %{public}d", __func__, rwlockRet);
+    int lockRet = pthread_mutex_lock(&(purgObj->writeLock));
+    if (lockRet != 0) {
+        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: lock fail. %{public}d", __func__, lockRet);
         return false;
     }
+    BeginExclusive(purgObj);
     PM_HILOG_INFO_C(LOG_CORE, "%{public}s: LogPurgMemInfo:", __func__);
     LogPurgMemInfo(purgObj);
 
@@ -197,14 +328,17 @@ bool PurgMemDestroy(struct PurgMem *purgObj)
             purgObj->uxPageTable = NULL;
         }
     }
-    pthread_rwlock_unlock(&(purgObj->rwlock));
+    EndExclusive(purgObj);
+    pthread_mutex_unlock(&(purgObj->writeLock));
 
     if (err == PM_OK) {
-        /* destroy rwlock */
-        rwlockRet = pthread_rwlock_destroy(&(purgObj->rwlock));
-        if (rwlockRet != 0) {
-            PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: pthread_rwlock_destroy fail, %{public}d", __func__, rwlockRet);
+        /* destroy listeners */
+        while (purgObj->listeners) {
+            struct PurgMemListenerNode *node = purgObj->listeners;
+            purgObj->listeners = node->next;
+            free(node);
         }
+        DestroyLocks(purgObj);
         free(purgObj);
         purgObj = NULL; /* set input para NULL to avoid UAF */
         PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: succ", __func__);
@@ -227,68 +361,71 @@ static bool IsPurgMemPtrValid(struct PurgMem *purgObj)
 static inline bool PurgMemBuildData(struct PurgMem *purgObj)
 {
     bool succ = false;
+    uint32_t pageCount = (uint32_t)(RoundUp(purgObj->dataSizeInput, PAGE_SIZE) / PAGE_SIZE);
+    PmTraceRecord(PM_TRACE_REBUILD_BEGIN, (uint64_t)(purgObj->dataPtr), pageCount);
     /* clear content before rebuild */
     if (memset_s(purgObj->dataPtr, RoundUp(purgObj->dataSizeInput, PAGE_SIZE), 0, purgObj->dataSizeInput) != EOK) {
         PM_HILOG_ERROR_C(LOG_CORE, "%{public}s, clear content fail", __func__);
+        PmTraceRecord(PM_TRACE_REBUILD_END, (uint64_t)(purgObj->dataPtr), 0);
         return succ;
     }
     /* @purgObj->builder is not NULL since it is checked by IsPurgMemPtrValid() before */
     succ = PurgMemBuilderBuildAll(purgObj->builder, purgObj->dataPtr, purgObj->dataSizeInput);
+    PmTraceRecord(PM_TRACE_REBUILD_END, (uint64_t)(purgObj->dataPtr), succ ? pageCount : 0);
     if (succ) {
         purgObj->buildDataCount++;
+        atomic_fetch_add_explicit(&(purgObj->generation), 1, memory_order_release);
     }
     return succ;
 }
 
-static PMState TryBeginRead(struct PurgMem *purgObj)
+static void NotifyRebuildListeners(struct PurgMem *purgObj)
 {
-    int rwlockRet = pthread_rwlock_rdlock(&(purgObj->rwlock));
-    if (rwlockRet != 0) {
-        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: rdlock fail. %{public}d", __func__, rwlockRet);
-        return PM_LOCK_READ_FAIL;
+    uint64_t generation = PurgMemGetGeneration(purgObj);
+    pthread_mutex_lock(&(purgObj->listenerLock));
+    for (struct PurgMemListenerNode *node = purgObj->listeners; node; node = node->next) {
+        node->func(purgObj, generation, node->funcPara);
     }
+    pthread_mutex_unlock(&(purgObj->listenerLock));
+}
 
-    if (!IsPurged(purgObj)) {
-        PM_HILOG_INFO_C(LOG_CORE,
-            "%{public}s: not purged, return true. MAP_PUG=0x%{public}x", __func__, MAP_PURGEABLE);
+static PMState TryBeginRead(struct PurgMem *purgObj)
+{
+    atomic_fetch_add(GetReaderCounter(purgObj), 1);
+    if ((atomic_load(&(purgObj->seq)) & 1) == 0 && !IsPurged(purgObj)) {
         return PM_DATA_NO_PURGED;
     }
-
-    rwlockRet = pthread_rwlock_unlock(&(purgObj->rwlock));
-    if (rwlockRet != 0) {
-        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: rd unlock fail. %{public}d", __func__, rwlockRet);
-        return PM_UNLOCK_READ_FAIL;
-    }
-
+    /* a writer is in, or the content needs rebuild */
+    ReaderLeave(purgObj);
     return PM_DATA_PURGED;
 }
 
-static PMState BeginReadBuildData(struct PurgMem *purgObj)
+static PMState BeginReadBuildData(struct PurgMem *purgObj, bool *rebuilt)
 {
-    bool rebuildRet = false;
-    int rwlockRet = pthread_rwlock_wrlock(&(purgObj->rwlock));
-    if (rwlockRet) {
-        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: wrlock fail. %{public}d", __func__, rwlockRet);
+    int lockRet = pthread_mutex_lock(&(purgObj->writeLock));
+    if (lockRet != 0) {
+        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: lock fail. %{public}d", __func__, lockRet);
         return PM_LOCK_WRITE_FAIL;
     }
 
+    /* single flight: the first reader rebuilds, the readers queued behind it find the content present */
+    PMState err = PMB_BUILD_ALL_SUCC;
     if (IsPurged(purgObj)) {
-        rebuildRet = PurgMemBuildData(purgObj);
-        PM_HILOG_ERROR_C(LOG_CORE,
-            "%{public}s: purged, after built %{public}s", __func__, rebuildRet ? "succ" : "fail");
+        BeginExclusive(purgObj);
+        *rebuilt = PurgMemBuildData(purgObj);
+        EndExclusive(purgObj);
+        if (!*rebuilt) {
+            PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: purged, build fail", __func__);
+            err = PMB_BUILD_ALL_FAIL;
+        }
     }
 
-    rwlockRet = pthread_rwlock_unlock(&(purgObj->rwlock));
-    if (rwlockRet != 0) {
-        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: wr unlock fail. %{public}d", __func__, rwlockRet);
+    lockRet = pthread_mutex_unlock(&(purgObj->writeLock));
+    if (lockRet != 0) {
+        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: unlock fail. %{public}d", __func__, lockRet);
         return PM_UNLOCK_WRITE_FAIL;
     }
-
-    if (!rebuildRet) {
-        return PMB_BUILD_ALL_FAIL;
-    }
-
-    return PMB_BUILD_ALL_SUCC;
+    return err;
 }
 
 bool PurgMemBeginRead(struct PurgMem *purgObj)
@@ -297,8 +434,6 @@ bool PurgMemBeginRead(struct PurgMem *purgObj)
         PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: para is invalid", __func__);
         return false;
     }
-    PM_HILOG_INFO_C(LOG_CORE, "%{public}s: LogPurgMemInfo:", __func__);
-    LogPurgMemInfo(purgObj);
     bool ret = false;
     PMState err = PM_OK;
     UxpteGet(purgObj->uxPageTable, (uint64_t)(purgObj->dataPtr), purgObj->dataSizeInput);
@@ -307,15 +442,18 @@ bool PurgMemBeginRead(struct PurgMem *purgObj)
         if (err == PM_DATA_NO_PURGED) {
             ret = true;
             break;
-        } else if (err != PM_DATA_PURGED) {
-            break;
         }
 
-        err = BeginReadBuildData(purgObj);
+        bool rebuilt = false;
+        err = BeginReadBuildData(purgObj, &rebuilt);
         if (err != PMB_BUILD_ALL_SUCC) {
             ret = false;
             break;
         }
+        /* no lock is held here, the content is rebuilt once per loop */
+        if (rebuilt) {
+            NotifyRebuildListeners(purgObj);
+        }
     }
 
     if (!ret) {
@@ -331,22 +469,21 @@ bool PurgMemBeginWrite(struct PurgMem *purgObj)
         PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: para is invalid", __func__);
         return false;
     }
-    PM_HILOG_INFO_C(LOG_CORE, "%{public}s: LogPurgMemInfo:", __func__);
-    LogPurgMemInfo(purgObj);
-    int rwlockRet = 0;
+    int lockRet = 0;
     bool rebuildRet = false;
     PMState err = PM_OK;
 
     UxpteGet(purgObj->uxPageTable, (uint64_t)(purgObj->dataPtr), purgObj->dataSizeInput);
 
-    rwlockRet = pthread_rwlock_wrlock(&(purgObj->rwlock));
-    if (rwlockRet != 0) {
-        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: wrlock fail. %{public}d", __func__, rwlockRet);
+    lockRet = pthread_mutex_lock(&(purgObj->writeLock));
+    if (lockRet != 0) {
+        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: lock fail. %{public}d", __func__, lockRet);
         err = PM_LOCK_WRITE_FAIL;
         PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: %{public}s, return false, UxptePut.", __func__, GetPMStateName(err));
         UxptePut(purgObj->uxPageTable, (uint64_t)(purgObj->dataPtr), purgObj->dataSizeInput);
         return false;
     }
+    BeginExclusive(purgObj);
 
     if (!IsPurged(purgObj)) {
         return true;
@@ -354,15 +491,16 @@ bool PurgMemBeginWrite(struct PurgMem *purgObj)
 
     /* data is purged */
     rebuildRet = PurgMemBuildData(purgObj);
-    PM_HILOG_INFO_C(LOG_CORE, "%{public}s: purged, built %{public}s", __func__, rebuildRet ? "succ" : "fail");
     if (rebuildRet) {
+        purgObj->rebuiltInWrite = true;
         return true;
     }
     /* data is purged and rebuild failed. return false */
     err = PMB_BUILD_ALL_FAIL;
-    rwlockRet = pthread_rwlock_unlock(&(purgObj->rwlock));
-    if (rwlockRet != 0) {
-        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: wr unlock fail. %{public}d", __func__, rwlockRet);
+    EndExclusive(purgObj);
+    lockRet = pthread_mutex_unlock(&(purgObj->writeLock));
+    if (lockRet != 0) {
+        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: unlock fail. %{public}d", __func__, lockRet);
     }
 
     PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: %{public}s, return false, UxptePut.", __func__, GetPMStateName(err));
@@ -370,28 +508,34 @@ bool PurgMemBeginWrite(struct PurgMem *purgObj)
     return false;
 }
 
-static inline void EndAccessPurgMem(struct PurgMem *purgObj)
+void PurgMemEndRead(struct PurgMem *purgObj)
 {
     if (!IsPurgMemPtrValid(purgObj)) {
         PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: para is invalid", __func__);
         return;
     }
-    int rwlockRet = 0;
-    rwlockRet = pthread_rwlock_unlock(&(purgObj->rwlock));
-    if (rwlockRet != 0) {
-        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: unlock fail. %{public}d", __func__, rwlockRet);
-    }
+    ReaderLeave(purgObj);
     UxptePut(purgObj->uxPageTable, (uint64_t)(purgObj->dataPtr), purgObj->dataSizeInput);
 }
 
-void PurgMemEndRead(struct PurgMem *purgObj)
-{
-    EndAccessPurgMem(purgObj);
-}
-
 void PurgMemEndWrite(struct PurgMem *purgObj)
 {
-    EndAccessPurgMem(purgObj);
+    if (!IsPurgMemPtrValid(purgObj)) {
+        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: para is invalid", __func__);
+        return;
+    }
+    /* writeLock is still held, so the flag is not accessed concurrently */
+    bool rebuilt = purgObj->rebuiltInWrite;
+    purgObj->rebuiltInWrite = false;
+    EndExclusive(purgObj);
+    int lockRet = pthread_mutex_unlock(&(purgObj->writeLock));
+    if (lockRet != 0) {
+        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: unlock fail. %{public}d", __func__, lockRet);
+    }
+    UxptePut(purgObj->uxPageTable, (uint64_t)(purgObj->dataPtr), purgObj->dataSizeInput);
+    if (rebuilt) {
+        NotifyRebuildListeners(purgObj);
+    }
 }
 
 void *PurgMemGetContent(struct PurgMem *purgObj)
@@ -416,9 +560,9 @@ bool PurgMemAppendModify(struct PurgMem *purgObj, PurgMemModifyFunc func, void *
 {
     IF_NULL_LOG_ACTION(func, "input func is NULL", return true);
     IF_NULL_LOG_ACTION(purgObj, "input purgObj is NULL", return false);
-    /* apply modify */
-    bool succ = func(purgObj->dataPtr, purgObj->dataSizeInput, funcPara);
-    if (!succ) {
+    /* apply modify only if content is present, otherwise it will be replayed by next rebuild */
+    if (purgObj->dataPtr != NULL && !IsPurged(purgObj) &&
+        !func(purgObj->dataPtr, purgObj->dataSizeInput, funcPara)) {
         return false;
     }
     struct PurgMemBuilder *builder = PurgMemBuilderCreate(func, funcPara, NULL);
@@ -431,11 +575,67 @@ bool PurgMemAppendModify(struct PurgMem *purgObj, PurgMemModifyFunc func, void *
     return PurgMemBuilderAppendBuilder(purgObj->builder, builder);
 }
 
+uint64_t PurgMemGetGeneration(struct PurgMem *purgObj)
+{
+    if (purgObj == NULL) {
+        return 0;
+    }
+    return atomic_load_explicit(&(purgObj->generation), memory_order_acquire);
+}
+
+double PurgMemGetRebuildCost(struct PurgMem *purgObj)
+{
+    if (purgObj == NULL) {
+        return 0;
+    }
+    /* builders are timed under writeLock */
+    int lockRet = pthread_mutex_lock(&(purgObj->writeLock));
+    if (lockRet != 0) {
+        PM_HILOG_ERROR_C(LOG_CORE, "%{public}s: lock fail. %{public}d", __func__, lockRet);
+        return 0;
+    }
+    double cost = PurgMemBuilderGetCost(purgObj->builder);
+    pthread_mutex_unlock(&(purgObj->writeLock));
+    return cost;
+}
+
+bool PurgMemAddRebuildListener(struct PurgMem *purgObj, PurgMemRebuildListener func, void *funcPara)
+{
+    IF_NULL_LOG_ACTION(purgObj, "input purgObj is NULL", return false);
+    IF_NULL_LOG_ACTION(func, "input func is NULL", return false);
+    struct PurgMemListenerNode *node = (struct PurgMemListenerNode *)malloc(sizeof(struct PurgMemListenerNode));
+    IF_NULL_LOG_ACTION(node, "malloc listener fail", return false);
+    node->func = func;
+    node->funcPara = funcPara;
+    pthread_mutex_lock(&(purgObj->listenerLock));
+    node->next = purgObj->listeners;
+    purgObj->listeners = node;
+    pthread_mutex_unlock(&(purgObj->listenerLock));
+    return true;
+}
+
+bool PurgMemRemoveRebuildListener(struct PurgMem *purgObj, PurgMemRebuildListener func, void *funcPara)
+{
+    IF_NULL_LOG_ACTION(purgObj, "input purgObj is NULL", return false);
+    bool found = false;
+    pthread_mutex_lock(&(purgObj->listenerLock));
+    for (struct PurgMemListenerNode **pnode = &(purgObj->listeners); *pnode; pnode = &((*pnode)->next)) {
+        struct PurgMemListenerNode *node = *pnode;
+        if (node->func == func && node->funcPara == funcPara) {
+            *pnode = node->next;
+            free(node);
+            found = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&(purgObj->listenerLock));
+    return found;
+}
+
 static bool IsPurged(struct PurgMem *purgObj)
 {
     /* first access, return true means purged */
     if (purgObj->buildDataCount == 0) {
-        PM_HILOG_INFO_C(LOG_CORE, "%{public}s, has never built, return true", __func__);
         return true;
     }
     return !UxpteIsPresent(purgObj->uxPageTable, (uint64_t)(purgObj->dataPtr), purgObj->dataSizeInput);
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_COMMON_INCLUDE_PM_TRACE_C_H
+#define OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_COMMON_INCLUDE_PM_TRACE_C_H
+
+#include <stdbool.h> /* bool */
+#include <stdint.h> /* uint64_t */
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif /* End of #if __cplusplus */
+#endif /* End of #ifdef __cplusplus */
+
+/*
+ * Binary trace of purgeable events, cheap enough to leave enabled in production.
+ * Each thread records into its own ring of PM_TRACE_RING_SIZE records without any lock,
+ * the oldest records are overwritten when a ring is full. PmTraceDump() collects the records
+ * of all threads, on demand or periodically from the drain thread of PmTraceStartDrain().
+ * At most PM_TRACE_MAX_RINGS rings are allocated, then a new thread takes over the ring of
+ * the thread that exited first, its records not dumped yet are counted as lost.
+ * A thread that finds all rings owned by live threads when it first records never records.
+ */
+#define PM_TRACE_RING_SIZE 4096 /* records per thread, power of 2 */
+#define PM_TRACE_MAX_RINGS 64
+#define PM_TRACE_MAGIC 0x52544d50 /* "PMTR" */
+
+enum PmTraceEvent {
+    PM_TRACE_PIN = 1,
+    PM_TRACE_UNPIN,
+    PM_TRACE_PURGED,        /* content found purged on access */
+    PM_TRACE_REBUILD_BEGIN,
+    PM_TRACE_REBUILD_END,   /* @pageCount is 0 if the rebuild failed */
+};
+
+/* dump layout: for each thread with new records, a chunk header followed by @count records */
+struct PmTraceChunkHeader {
+    uint32_t magic;
+    uint32_t tid;
+    uint32_t count;
+    uint32_t lost;          /* records overwritten or taken over before they were dumped */
+};
+
+struct PmTraceRecord {
+    uint64_t timeNs;        /* CLOCK_MONOTONIC */
+    uint64_t objId;         /* start address of the content */
+    uint32_t pageCount;
+    uint16_t event;         /* enum PmTraceEvent */
+    uint16_t reserved;
+};
+
+void PmTraceSetEnabled(bool enabled);
+bool PmTraceIsEnabled(void);
+
+/* record an event in the ring of the calling thread, nothing is done if trace is disabled */
+void PmTraceRecord(enum PmTraceEvent event, uint64_t objId, uint32_t pageCount);
+
+/*
+ * PmTraceDump: write the records not dumped before to @fd, in the layout above.
+ * Return:  number of records written, -1 if @fd cannot be written.
+ */
+int PmTraceDump(int fd);
+
+/*
+ * PmTraceStartDrain: dump to @fd every @intervalMs in a background thread, until
+ * PmTraceStopDrain() which dumps once more. @fd is not owned.
+ * Return:  false if a drain thread is already running or cannot be created.
+ */
+bool PmTraceStartDrain(int fd, unsigned int intervalMs);
+void PmTraceStopDrain(void);
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* End of #if __cplusplus */
+#endif /* End of #ifdef __cplusplus */
+#endif /* OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_COMMON_INCLUDE_PM_TRACE_C_H */
@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h> /* calloc */
+#include <sys/syscall.h> /* SYS_gettid */
+#include <time.h> /* clock_gettime */
+#include <unistd.h> /* write */
+
+#include "hilog/log_c.h"
+#include "pm_trace_c.h"
+
+#undef LOG_TAG
+#define LOG_TAG "PurgeableMemC: Trace"
+
+#define NS_PER_SEC 1000000000LL
+#define NS_PER_MS 1000000LL
+#define PM_TRACE_RING_MASK (PM_TRACE_RING_SIZE - 1)
+
+struct PmTraceRing {
+    struct PmTraceRing *next;
+    _Atomic uint32_t tid;   /* kept after the thread exits, until its records are dumped */
+    _Atomic bool released;  /* the thread exited, the ring is reused once all its records are dumped */
+    _Atomic uint64_t releaseSeq; /* order of release, the ring released first is taken over first */
+    _Atomic uint64_t head;  /* records ever written, only stored by the owner thread */
+    uint64_t dumped;        /* records ever dumped, protected by g_dumpLock */
+    uint32_t lostTid;       /* a previous owner whose records were taken over, protected by g_dumpLock */
+    uint32_t lostCount;     /* records of @lostTid not dumped, reported by the next dump */
+    struct PmTraceRecord records[PM_TRACE_RING_SIZE];
+};
+
+static _Atomic bool g_enabled = false;
+static pthread_mutex_t g_ringsLock = PTHREAD_MUTEX_INITIALIZER;
+static struct PmTraceRing *g_rings = NULL; /* never freed, rings of exited threads are reused */
+static unsigned int g_ringCount = 0; /* protected by g_ringsLock */
+static _Atomic uint64_t g_releaseSeq = 0;
+static pthread_mutex_t g_dumpLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t g_keyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t g_ringKey;
+static _Thread_local struct PmTraceRing *g_threadRing = NULL;
+static _Thread_local bool g_threadNoRing = false; /* all rings were owned when the thread first recorded */
+
+static pthread_mutex_t g_drainLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_drainCond = PTHREAD_COND_INITIALIZER;
+static pthread_t g_drainThread;
+static bool g_draining = false;
+static bool g_drainStop = false;
+static int g_drainFd = -1;
+static unsigned int g_drainIntervalMs = 0;
+
+static void ReleaseRing(void *ring)
+{
+    struct PmTraceRing *traceRing = (struct PmTraceRing *)ring;
+    atomic_store_explicit(&(traceRing->releaseSeq), atomic_fetch_add(&g_releaseSeq, 1), memory_order_relaxed);
+    atomic_store_explicit(&(traceRing->released), true, memory_order_release);
+}
+
+static void CreateRingKey(void)
+{
+    pthread_key_create(&g_ringKey, ReleaseRing);
+}
+
+/* a released ring whose records are all dumped, with g_dumpLock and g_ringsLock held */
+static struct PmTraceRing *ReuseRing(uint32_t tid)
+{
+    for (struct PmTraceRing *curr = g_rings; curr; curr = curr->next) {
+        bool released = true;
+        if (curr->dumped == atomic_load_explicit(&(curr->head), memory_order_acquire) &&
+            atomic_compare_exchange_strong(&(curr->released), &released, false)) {
+            atomic_store(&(curr->tid), tid);
+            return curr;
+        }
+    }
+    return NULL;
+}
+
+/* the ring released first, its records not dumped are lost, with g_dumpLock and g_ringsLock held */
+static struct PmTraceRing *TakeOverRing(uint32_t tid)
+{
+    struct PmTraceRing *oldest = NULL;
+    for (struct PmTraceRing *curr = g_rings; curr; curr = curr->next) {
+        if (atomic_load_explicit(&(curr->released), memory_order_acquire) && (oldest == NULL ||
+            atomic_load(&(curr->releaseSeq)) < atomic_load(&(oldest->releaseSeq)))) {
+            oldest = curr;
+        }
+    }
+    if (oldest == NULL) {
+        return NULL;
+    }
+    uint64_t head = atomic_load_explicit(&(oldest->head), memory_order_acquire);
+    if (head != oldest->dumped) {
+        /* the lost records of owners taken over again before a dump are counted under the first one */
+        if (oldest->lostCount == 0) {
+            oldest->lostTid = atomic_load(&(oldest->tid));
+        }
+        oldest->lostCount += (uint32_t)(head - oldest->dumped);
+        oldest->dumped = head;
+    }
+    atomic_store(&(oldest->released), false);
+    atomic_store(&(oldest->tid), tid);
+    return oldest;
+}
+
+static struct PmTraceRing *NewRing(uint32_t tid)
+{
+    if (g_ringCount >= PM_TRACE_MAX_RINGS) {
+        return NULL;
+    }
+    struct PmTraceRing *ring = (struct PmTraceRing *)calloc(1, sizeof(struct PmTraceRing));
+    if (ring != NULL) {
+        atomic_init(&(ring->tid), tid);
+        atomic_init(&(ring->released), false);
+        atomic_init(&(ring->releaseSeq), 0);
+        atomic_init(&(ring->head), 0);
+        ring->next = g_rings;
+        g_rings = ring;
+        g_ringCount++;
+    }
+    return ring;
+}
+
+static struct PmTraceRing *AcquireRing(void)
+{
+    pthread_once(&g_keyOnce, CreateRingKey);
+    uint32_t tid = (uint32_t)syscall(SYS_gettid);
+    struct PmTraceRing *ring = NULL;
+    /*
+     * A released ring with undumped records keeps them under the tid of the exited thread.
+     * @dumped is checked with g_dumpLock, a new thread does not wait for a dump, it allocates instead.
+     * Only when no more ring can be allocated, it waits for the dump and takes over a ring.
+     */
+    bool dumpLocked = (pthread_mutex_trylock(&g_dumpLock) == 0);
+    pthread_mutex_lock(&g_ringsLock);
+    if (dumpLocked) {
+        ring = ReuseRing(tid);
+    }
+    if (ring == NULL) {
+        ring = NewRing(tid);
+    }
+    if (ring == NULL && !dumpLocked) {
+        /* g_dumpLock is taken before g_ringsLock, as PmTraceDump() does */
+        pthread_mutex_unlock(&g_ringsLock);
+        pthread_mutex_lock(&g_dumpLock);
+        dumpLocked = true;
+        pthread_mutex_lock(&g_ringsLock);
+    }
+    if (ring == NULL) {
+        ring = TakeOverRing(tid);
+    }
+    pthread_mutex_unlock(&g_ringsLock);
+    if (dumpLocked) {
+        pthread_mutex_unlock(&g_dumpLock);
+    }
+    if (ring != NULL) {
+        pthread_setspecific(g_ringKey, ring);
+    }
+    return ring;
+}
+
+void PmTraceSetEnabled(bool enabled)
+{
+    atomic_store_explicit(&g_enabled, enabled, memory_order_relaxed);
+}
+
+bool PmTraceIsEnabled(void)
+{
+    return atomic_load_explicit(&g_enabled, memory_order_relaxed);
+}
+
+void PmTraceRecord(enum PmTraceEvent event, uint64_t objId, uint32_t pageCount)
+{
+    if (!atomic_load_explicit(&g_enabled, memory_order_relaxed)) {
+        return;
+    }
+    if (g_threadRing == NULL) {
+        if (g_threadNoRing) {
+            return;
+        }
+        g_threadRing = AcquireRing();
+        if (g_threadRing == NULL) {
+            g_threadNoRing = true;
+            return;
+        }
+    }
+    struct PmTraceRing *ring = g_threadRing;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t head = atomic_load_explicit(&(ring->head), memory_order_relaxed);
+    struct PmTraceRecord *record = &(ring->records[head & PM_TRACE_RING_MASK]);
+    record->timeNs = (uint64_t)ts.tv_sec * NS_PER_SEC + (uint64_t)ts.tv_nsec;
+    record->objId = objId;
+    record->pageCount = pageCount;
+    record->event = (uint16_t)event;
+    record->reserved = 0;
+    atomic_store_explicit(&(ring->head), head + 1, memory_order_release);
+}
+
+static bool WriteAll(int fd, const void *buf, size_t len)
+{
+    const char *p = (const char *)buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/* copy new records of @ring to @buf, return the count, records overwritten meanwhile are dropped */
+static uint32_t CollectRing(struct PmTraceRing *ring, struct PmTraceRecord *buf, uint32_t *lost)
+{
+    uint64_t head = atomic_load_explicit(&(ring->head), memory_order_acquire);
+    uint64_t start = (head > PM_TRACE_RING_SIZE) ? head - PM_TRACE_RING_SIZE : 0;
+    if (start < ring->dumped) {
+        start = ring->dumped;
+    }
+    for (uint64_t i = start; i < head; i++) {
+        buf[i - start] = ring->records[i & PM_TRACE_RING_MASK];
+    }
+    /* the owner may have overwritten the oldest records during the copy, including the one in progress */
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t newHead = atomic_load_explicit(&(ring->head), memory_order_relaxed);
+    uint64_t valid = (newHead + 1 > PM_TRACE_RING_SIZE) ? newHead + 1 - PM_TRACE_RING_SIZE : 0;
+    uint64_t skip = (valid > start) ? ((valid < head) ? valid : head) - start : 0;
+    for (uint64_t i = skip; i < head - start; i++) {
+        buf[i - skip] = buf[i];
+    }
+    *lost = (uint32_t)(start + skip - ring->dumped);
+    ring->dumped = head;
+    return (uint32_t)(head - start - skip);
+}
+
+int PmTraceDump(int fd)
+{
+    struct PmTraceRecord *buf = (struct PmTraceRecord *)malloc(sizeof(struct PmTraceRecord) * PM_TRACE_RING_SIZE);
+    if (buf == NULL) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: malloc fail", __func__);
+        return -1;
+    }
+    int total = 0;
+    pthread_mutex_lock(&g_dumpLock);
+    pthread_mutex_lock(&g_ringsLock);
+    struct PmTraceRing *rings = g_rings; /* rings are only prepended, the rest of the list is stable */
+    pthread_mutex_unlock(&g_ringsLock);
+    for (struct PmTraceRing *ring = rings; ring; ring = ring->next) {
+        if (ring->lostCount != 0) {
+            struct PmTraceChunkHeader lostHeader = { PM_TRACE_MAGIC, ring->lostTid, 0, ring->lostCount };
+            if (!WriteAll(fd, &lostHeader, sizeof(lostHeader))) {
+                HILOG_ERROR(LOG_CORE, "%{public}s: write fail, errno %{public}d", __func__, errno);
+                total = -1;
+                break;
+            }
+            ring->lostCount = 0;
+        }
+        struct PmTraceChunkHeader header = { PM_TRACE_MAGIC, atomic_load(&(ring->tid)), 0, 0 };
+        header.count = CollectRing(ring, buf, &(header.lost));
+        if (header.count == 0 && header.lost == 0) {
+            continue;
+        }
+        if (!WriteAll(fd, &header, sizeof(header)) ||
+            !WriteAll(fd, buf, sizeof(struct PmTraceRecord) * header.count)) {
+            HILOG_ERROR(LOG_CORE, "%{public}s: write fail, errno %{public}d", __func__, errno);
+            total = -1;
+            break;
+        }
+        total += (int)header.count;
+    }
+    pthread_mutex_unlock(&g_dumpLock);
+    free(buf);
+    return total;
+}
+
+static void *DrainLoop(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&g_drainLock);
+    while (!g_drainStop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        long long ns = deadline.tv_nsec + (long long)g_drainIntervalMs * NS_PER_MS;
+        deadline.tv_sec += (time_t)(ns / NS_PER_SEC);
+        deadline.tv_nsec = (long)(ns % NS_PER_SEC);
+        pthread_cond_timedwait(&g_drainCond, &g_drainLock, &deadline);
+        int fd = g_drainFd;
+        pthread_mutex_unlock(&g_drainLock);
+        PmTraceDump(fd);
+        pthread_mutex_lock(&g_drainLock);
+    }
+    pthread_mutex_unlock(&g_drainLock);
+    return NULL;
+}
+
+bool PmTraceStartDrain(int fd, unsigned int intervalMs)
+{
+    if (fd < 0 || intervalMs == 0) {
+        return false;
+    }
+    pthread_mutex_lock(&g_drainLock);
+    if (g_draining) {
+        pthread_mutex_unlock(&g_drainLock);
+        return false;
+    }
+    g_drainFd = fd;
+    g_drainIntervalMs = intervalMs;
+    g_drainStop = false;
+    int ret = pthread_create(&g_drainThread, NULL, DrainLoop, NULL);
+    g_draining = (ret == 0);
+    pthread_mutex_unlock(&g_drainLock);
+    if (ret != 0) {
+        HILOG_ERROR(LOG_CORE, "%{public}s: create thread fail, %{public}d", __func__, ret);
+    }
+    return ret == 0;
+}
+
+void PmTraceStopDrain(void)
+{
+    pthread_mutex_lock(&g_drainLock);
+    if (!g_draining) {
+        pthread_mutex_unlock(&g_drainLock);
+        return;
+    }
+    g_drainStop = true;
+    pthread_cond_signal(&g_drainCond);
+    pthread_mutex_unlock(&g_drainLock);
+    pthread_join(g_drainThread, NULL);
+
+    pthread_mutex_lock(&g_drainLock);
+    g_draining = false;
+    int fd = g_drainFd;
+    g_drainFd = -1;
+    pthread_mutex_unlock(&g_drainLock);
+    PmTraceDump(fd);
+}
@@ -19,6 +19,7 @@
 #include <limits.h>
 
 #include "hilog/log_c.h"
+#include "pm_trace_c.h"
 #include "pm_util.h"
 #include "ux_page_table_c.h"
 
@@ -332,9 +333,6 @@ static void GetUxpteAt(UxPageTableStruct *upt, uint64_t addr)
     }
     size_t index = GetIndexInUxpte(upt->dataAddr, addr);
     UxpteAdd(&(upt->uxpte[index]), UXPTE_REFCNT_ONE);
-
-    HILOG_DEBUG(LOG_CORE, "%{public}s: addr(0x%{private}llx) upte=0x%{private}llx",
-        __func__, (unsigned long long)addr, (unsigned long long)(upt->uxpte[index]));
 }
 
 static void PutUxpteAt(UxPageTableStruct *upt, uint64_t addr)
@@ -345,9 +343,6 @@ static void PutUxpteAt(UxPageTableStruct *upt, uint64_t addr)
     }
     size_t index = GetIndexInUxpte(upt->dataAddr, addr);
     UxpteSub(&(upt->uxpte[index]), UXPTE_REFCNT_ONE);
-
-    HILOG_DEBUG(LOG_CORE, "%{public}s: addr(0x%{private}llx) upte=0x%{private}llx",
-        __func__, (unsigned long long)addr, (unsigned long long)(upt->uxpte[index]));
 }
 
 static void ClearUxpteAt(UxPageTableStruct *upt, uint64_t addr)
@@ -363,10 +358,6 @@ static void ClearUxpteAt(UxPageTableStruct *upt, uint64_t addr)
 static bool IsPresentAt(UxPageTableStruct *upt, uint64_t addr)
 {
     size_t index = GetIndexInUxpte(upt->dataAddr, addr);
-
-    HILOG_DEBUG(LOG_CORE, "%{public}s: addr(0x%{private}llx) upte=0x%{private}llx PRESENT_MASK=0x%{public}zx",
-        __func__, (unsigned long long)addr, (unsigned long long)(upt->uxpte[index]), UXPTE_PRESENT_MASK);
-
     return IsUxptePresent(upt->uxpte[index]);
 }
 
@@ -402,8 +393,7 @@ static PMState UxpteOps(UxPageTableStruct *upt, uint64_t addr, size_t len, enum
             }
             case UPT_IS_PRESENT: {
                 if (!IsPresentAt(upt, off)) {
-                    HILOG_ERROR(LOG_CORE, "%{public}s: addr(0x%{private}llx) not present", __func__,
-                        (unsigned long long)addr);
+                    PmTraceRecord(PM_TRACE_PURGED, upt->dataAddr, (uint32_t)((end - start) / PAGE_SIZE));
                     return PM_UXPT_NO_PRESENT;
                 }
                 break;
@@ -413,6 +403,11 @@ static PMState UxpteOps(UxPageTableStruct *upt, uint64_t addr, size_t len, enum
         }
     }
 
+    /* one event per call, not per page */
+    if (op == UPT_GET || op == UPT_PUT) {
+        PmTraceRecord((op == UPT_GET) ? PM_TRACE_PIN : PM_TRACE_UNPIN, upt->dataAddr,
+            (uint32_t)((end - start) / PAGE_SIZE));
+    }
     return PM_OK;
 }
 
@@ -36,6 +36,10 @@
 #undef PM_HILOG_DEBUG
 #endif
 
+#ifdef PM_HILOG_DEBUG_ENABLED
+#undef PM_HILOG_DEBUG_ENABLED
+#endif
+
 #define PM_FILENAME "purgeable"
 
 #define PM_HILOG_ERROR(logCore, fmt, ...)            \
@@ -46,7 +50,15 @@
     HILOG_INFO(              \
         LOG_CORE, "[%{public}s(%{public}s:%{public}d)]" fmt, PM_FILENAME, __FUNCTION__, __LINE__, ##__VA_ARGS__)
 
+#define PM_HILOG_DEBUG_ENABLED() HiLogIsLoggable(LOG_DOMAIN, LOG_TAG, LOG_DEBUG)
+
+/* arguments are evaluated only if debug log is enabled, keep the access path free of formatting */
 #define PM_HILOG_DEBUG(logCore, fmt, ...)            \
-    HILOG_DEBUG(             \
-        LOG_CORE, "[%{public}s(%{public}s:%{public}d)]" fmt, PM_FILENAME, __FUNCTION__, __LINE__, ##__VA_ARGS__)
+    do {                                             \
+        if (PM_HILOG_DEBUG_ENABLED()) {              \
+            HILOG_DEBUG(                             \
+                LOG_CORE, "[%{public}s(%{public}s:%{public}d)]" fmt, PM_FILENAME, __FUNCTION__, __LINE__, \
+                ##__VA_ARGS__);                      \
+        }                                            \
+    } while (0)
 #endif
\ No newline at end of file
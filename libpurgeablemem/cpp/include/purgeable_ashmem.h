@@ -19,52 +19,59 @@
 #include <memory>
 #include <shared_mutex>
 #include <string>
-#include <sys/ioctl.h>
-#include <unistd.h>
 
-#include <linux/ashmem.h>
-
-#include "ashmem.h"
 #include "purgeable_mem_builder.h"
 #include "purgeable_mem_base.h"
-#include "ux_page_table.h"
-
-#ifndef ASHMEM_SET_PURGEABLE
-#define ASHMEM_SET_PURGEABLE                   _IO(__ASHMEMIOC, 11)
-#endif
-#ifndef ASHMEM_GET_PURGEABLE
-#define ASHMEM_GET_PURGEABLE                   _IO(__ASHMEMIOC, 12)
-#endif
-#ifndef PURGEABLE_ASHMEM_IS_PURGED
-#define PURGEABLE_ASHMEM_IS_PURGED             _IO(__ASHMEMIOC, 13)
-#endif
-#ifndef PURGEABLE_ASHMEM_REBUILD_SUCCESS
-#define PURGEABLE_ASHMEM_REBUILD_SUCCESS       _IO(__ASHMEMIOC, 14)
-#endif
+#include "purgeable_mem_policy.h"
+#include "purgeable_shared_ctrl.h"
 
 namespace OHOS {
 namespace PurgeableMem {
+/*
+ * Polymorphic adapter of the ashmem backend, see BasicPurgeableMem<AshmemPolicy> for static dispatch.
+ * Where purgeable ashmem is not supported and the region is a memfd, as on standard Linux,
+ * it falls back to MemfdPolicy: purged content is punched out and detected on the shared fd.
+ * Pins of a memfd are local to the process, so it must not be shared without a control block.
+ * With @sharedRebuild, a control block is placed in the page after the content, so processes
+ * sharing the fd rebuild the purged content once and see the pins of each other on a memfd,
+ * see PurgeableSharedCtrl.
+ */
 class PurgeableAshMem : public PurgeableMemBase {
 public:
     PurgeableAshMem(size_t dataSize, std::unique_ptr<PurgeableMemBuilder> builder);
+    PurgeableAshMem(size_t dataSize, std::unique_ptr<PurgeableMemBuilder> builder, bool sharedRebuild);
     PurgeableAshMem(std::unique_ptr<PurgeableMemBuilder> builder);
     ~PurgeableAshMem() override;
     int GetAshmemFd();
     void ResizeData(size_t newSize) override;
     bool ChangeAshmemData(size_t size, int fd, void *data);
+    /* with @sharedRebuild, join the rebuild coordination if the creator of @fd reserved a control block */
+    bool ChangeAshmemData(size_t size, int fd, void *data, bool sharedRebuild);
+
+    /* Return:  times the shared content has been rebuilt, 0 if rebuild is not coordinated */
+    uint32_t GetSharedGeneration() const;
 
 protected:
     int ashmemFd_;
     int isSupport_;
     bool isChange_;
+    bool isMemfd_ = false;
+    bool sharedRebuild_ = false;
+    PurgeableSharedCtrl sharedCtrl_;
+    uint32_t sharedPins_ = 0; /* pins of this obj counted in sharedCtrl_ */
     ashmem_pin pin_ = { static_cast<uint32_t>(0), static_cast<uint32_t>(0) };
     bool Pin() override;
     bool Unpin() override;
     bool IsPurged() override;
+    bool IsContentPurged();
     int GetPinStatus() const override;
     bool CreatePurgeableData();
     void AfterRebuildSucc() override;
+    bool RebuildContent() override;
+    void AttachSharedCtrl(size_t size, bool create);
+    void DetachSharedCtrl();
     std::string ToString() const override;
+    bool DropContent() override;
 };
 } /* namespace PurgeableMem */
 } /* namespace OHOS */
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_DEDUP_MEM_H
+#define OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_DEDUP_MEM_H
+
+#include <map>
+#include <memory> /* shared_ptr */
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "purgeable_mem_base.h"
+#include "purgeable_mem_policy.h"
+
+namespace OHOS {
+namespace PurgeableMem {
+class PurgeableDedupRegion;
+
+/*
+ * Class PurgeableDedupRegistry maps content keys to the regions shared by PurgeableDedupMem objs.
+ * A region lives as long as some obj shares it.
+ */
+class PurgeableDedupRegistry {
+public:
+    static PurgeableDedupRegistry &GetInstance();
+
+    /* Return:  number of regions shared by at least one obj */
+    size_t GetRegionCount();
+
+private:
+    PurgeableDedupRegistry() = default;
+    ~PurgeableDedupRegistry() = default;
+    PurgeableDedupRegistry(const PurgeableDedupRegistry&) = delete;
+    PurgeableDedupRegistry& operator = (const PurgeableDedupRegistry&) = delete;
+
+    /* Return:  the region of @key and @size, created if none, nullptr if it cannot be mapped */
+    std::shared_ptr<PurgeableDedupRegion> Acquire(const std::string &key, size_t size);
+    void Release(const std::string &key, size_t size);
+
+    std::mutex lock_;
+    std::map<std::pair<std::string, size_t>, std::weak_ptr<PurgeableDedupRegion>> regions_;
+    friend class PurgeableDedupMem;
+};
+
+/*
+ * Class PurgeableDedupMem is a purgeable obj whose content is shared with the other objs
+ * holding the same content, e.g. the same icon decoded by different components.
+ * Objs whose builders return the same non-empty GetContentKey() and have the same size
+ * share one region: its pages are pinned by all readers and rebuilt once after a purge,
+ * by the builder of whichever obj accesses it first.
+ * The first BeginWrite() or ModifyContentByBuilder() copies the content to pages of its own
+ * obj, which never shares again. BeginWrite() fails while the shared content is being read
+ * by the same obj.
+ */
+class PurgeableDedupMem : public PurgeableMemBase {
+public:
+    PurgeableDedupMem(size_t dataSize, std::unique_ptr<PurgeableMemBuilder> builder);
+    ~PurgeableDedupMem() override;
+    void ResizeData(size_t newSize) override;
+
+    /* Return:  true if the content is shared with the other objs of the same key */
+    bool IsShared();
+
+protected:
+    bool Pin() override;
+    bool Unpin() override;
+    bool IsPurged() override;
+    bool RebuildContent() override;
+    bool BeforeWrite() override;
+    bool DropContent() override;
+    std::string ToString() const override;
+
+private:
+    bool CreatePrivateData();
+    bool Unshare();
+
+    UxptPolicy backend_; /* of the private content, after the obj is unshared */
+    std::shared_ptr<PurgeableDedupRegion> region_ = nullptr;
+};
+} /* namespace PurgeableMem */
+} /* namespace OHOS */
+#endif /* OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_DEDUP_MEM_H */
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_FILE_BUILDER_H
+#define OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_FILE_BUILDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "purgeable_mem_builder.h"
+
+namespace OHOS {
+namespace PurgeableMem {
+/*
+ * Class FileRangeBuilder rebuilds the content from a range of a local file, e.g. a decoded
+ * image or a font cache on disk. It reads the file straight into the content with readahead
+ * hints, without an intermediate buffer. It is splittable, so large content is read by
+ * several threads in parallel, one page aligned range each.
+ * The range starts at @fileOffset of the file and is as long as the content,
+ * a file too short to fill the content fails the build.
+ */
+class FileRangeBuilder : public PurgeableMemBuilder {
+public:
+    /* @fd is duplicated, the caller may close it after the builder is created */
+    FileRangeBuilder(int fd, uint64_t fileOffset);
+    FileRangeBuilder(const std::string &path, uint64_t fileOffset);
+    ~FileRangeBuilder() override;
+    FileRangeBuilder(const FileRangeBuilder&) = delete;
+    FileRangeBuilder& operator = (const FileRangeBuilder&) = delete;
+
+    /* Return:  false if the file cannot be opened, then every build fails */
+    bool IsValid() const;
+
+    /*
+     * SetTargetFd: set the fd holding the content, e.g. PurgeableAshMem::GetAshmemFd(), and
+     * @target, its shared mapping from offset 0, e.g. PurgeableAshMem::GetContent().
+     * A build into @target is then copied in kernel from the file to @fd by copy_file_range()
+     * instead of read through the mapping, if the kernel supports it for both fds. A build into
+     * any other buffer is still read into it. @fd is not owned, it must outlive the builder,
+     * and it is not changed while building. -1 restores the read path.
+     */
+    void SetTargetFd(int fd, const void *target);
+
+    bool Build(void *data, size_t size) override;
+
+    bool IsSplittable() const override
+    {
+        return true;
+    }
+
+    bool BuildRange(void *data, size_t size, size_t offset, size_t len) override;
+
+    /* Return:  total bytes read from the file by all builds so far */
+    uint64_t GetBytesRead() const
+    {
+        return bytesRead_.load(std::memory_order_relaxed);
+    }
+
+private:
+    bool ReadRange(char *dst, size_t offset, size_t len);
+    size_t CopyRange(const void *data, size_t offset, size_t len);
+
+    int fd_ = -1;
+    uint64_t fileOffset_;
+    std::atomic<int> targetFd_ {-1};
+    std::atomic<const void *> target_ {nullptr};
+    std::atomic<bool> copySupported_ {true}; /* cleared when copy_file_range() fails for the fds */
+    std::atomic<uint64_t> bytesRead_ {0};
+};
+} /* namespace PurgeableMem */
+} /* namespace OHOS */
+#endif /* OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_FILE_BUILDER_H */
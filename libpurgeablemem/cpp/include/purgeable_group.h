@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_GROUP_H
+#define OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_GROUP_H
+
+#include <mutex>
+#include <vector>
+
+#include "purgeable_mem_base.h"
+
+namespace OHOS {
+namespace PurgeableMem {
+/*
+ * Class PurgeableGroup pins a set of related purgeable objs as one unit, e.g. all glyph pages
+ * and tiles used by a frame. BeginRead() and BeginWrite() lock the members once in a fixed
+ * order, pin all of them before rebuilding any, so no member is purged while the others are
+ * rebuilt, then rebuild only the purged ones. Either all members are pinned or none is.
+ * The group does not own its members, a member must be removed before it is destroyed.
+ */
+class PurgeableGroup {
+public:
+    PurgeableGroup() = default;
+    ~PurgeableGroup();
+    PurgeableGroup(const PurgeableGroup&) = delete;
+    PurgeableGroup& operator = (const PurgeableGroup&) = delete;
+
+    /*
+     * Add: add @obj to the group.
+     * Return:  false if @obj is nullptr or already a member, or the group is being accessed.
+     */
+    bool Add(PurgeableMemBase *obj);
+
+    /*
+     * Remove: remove @obj from the group.
+     * Return:  false if @obj is not a member, or the group is being accessed.
+     */
+    bool Remove(PurgeableMemBase *obj);
+    size_t GetSize();
+
+    /*
+     * BeginRead: begin read all members.
+     * Return:  true if the content of every member is present. If a member cannot be pinned
+     *          or rebuilt, the members pinned so far are unpinned and false is returned.
+     * OS cannot reclaim the content of any member when this function return true,
+     * until EndAccess() is called.
+     */
+    bool BeginRead();
+
+    /*
+     * BeginWrite: begin write all members, as BeginRead(). Members sharing their content
+     * with other objs, e.g. PurgeableDedupMem, get their own copy before they are pinned.
+     * Return:  false if a member cannot get its own copy, pinned or rebuilt.
+     */
+    bool BeginWrite();
+
+    /*
+     * EndAccess: end access all members, OS may reclaim their content
+     * at a later time when this function returns.
+     */
+    void EndAccess();
+
+private:
+    bool BeginAccess(bool isWrite);
+    static bool PinMember(PurgeableMemBase *obj, bool isWrite);
+    static void UnpinMember(PurgeableMemBase *obj);
+    static bool RebuildMember(PurgeableMemBase *obj, bool &rebuilt);
+
+    std::mutex groupLock_;
+    std::vector<PurgeableMemBase *> members_; /* sorted by address, the order to lock them */
+    bool isAccessing_ = false;
+};
+} /* namespace PurgeableMem */
+} /* namespace OHOS */
+#endif /* OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_GROUP_H */
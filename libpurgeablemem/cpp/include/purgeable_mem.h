@@ -22,10 +22,11 @@
 
 #include "purgeable_mem_builder.h"
 #include "purgeable_mem_base.h"
-#include "ux_page_table.h"
+#include "purgeable_mem_policy.h"
 
 namespace OHOS {
 namespace PurgeableMem {
+/* Polymorphic adapter of the uxpt backend, see BasicPurgeableMem<UxptPolicy> for static dispatch. */
 class PurgeableMem : public PurgeableMemBase {
 public:
     PurgeableMem(size_t dataSize, std::unique_ptr<PurgeableMemBuilder> builder);
@@ -33,7 +34,7 @@ public:
     void ResizeData(size_t newSize) override;
 
 protected:
-    std::unique_ptr<UxPageTable> pageTable_ = nullptr;
+    UxptPolicy backend_;
     bool Pin() override;
     bool Unpin() override;
     bool IsPurged() override;
@@ -20,15 +20,25 @@
 #define OHOS_MAXIMUM_PURGEABLE_MEMORY ((1024) * (1024) * (1024)) /* 1G */
 #endif /* OHOS_MAXIMUM_PURGEABLE_MEMORY */
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <memory> /* unique_ptr */
 #include <shared_mutex> /* shared_mutex */
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "purgeable_mem_builder.h"
 #include "ux_page_table.h"
 
 namespace OHOS {
 namespace PurgeableMem {
+class PurgeableSnapshotEntry;
+
+/* called with the generation of the content after it is rebuilt */
+using RebuildListener = std::function<void(uint64_t generation)>;
+
 class PurgeableMemBase {
 public:
     /*
@@ -91,6 +101,8 @@ public:
      * Input:   @modifier: unique_ptr of PurgeableMemBuilder, it will modify content of this obj.
      * Return:  modify result, true is success, while false is fail.
      * This function should be protected by BeginWrite()/EndWrite().
+     * If the content is purged or never built, @modifier is only logged,
+     * and it will be applied when the content is rebuilt.
      */
     bool ModifyContentByBuilder(std::unique_ptr<PurgeableMemBuilder> modifier);
 
@@ -113,6 +125,36 @@ public:
      */
     virtual void ResizeData(size_t newSize);
     void SetRebuildSuccessCallback(std::function<void()> &callback);
+
+    /*
+     * GetGeneration: get generation of the content, without taking any lock.
+     * Return:  a number that changes whenever the content is rebuilt or resized,
+     *          0 if it has never been built. Data derived from the content stays valid
+     *          as long as the generation is the same as when it was derived.
+     */
+    uint64_t GetGeneration() const;
+
+    /*
+     * GetRebuildCostNsPerByte: get rolling average cost to rebuild the content, without taking any lock.
+     * Return:  time of a rebuild per byte of content in ns, including all the appended modifiers,
+     *          0 if no build by its builders has been timed, e.g. the content was restored from
+     *          a snapshot or adopted from another obj. Objs with the lowest cost are the cheapest to purge.
+     */
+    double GetRebuildCostNsPerByte() const;
+
+    /*
+     * AddRebuildListener: subscribe to rebuilds of the content.
+     * Input:   @listener: called after BeginRead()/BeginWrite() rebuilt the content, once per generation,
+     *          with no lock of this obj held. It must not add or remove listeners of this obj.
+     * Return:  id of the listener, or -1 if @listener is empty.
+     */
+    int AddRebuildListener(RebuildListener listener);
+
+    /*
+     * RemoveRebuildListener: the listener is not called anymore when this function returns.
+     * Return:  false if no listener has the @id.
+     */
+    bool RemoveRebuildListener(int id);
     bool IsDataValid();
     void SetDataValid(bool target);
 
@@ -132,12 +174,52 @@ protected:
     size_t dataSizeInput_ = 0;
     std::unique_ptr<PurgeableMemBuilder> builder_ = nullptr;
     unsigned int buildDataCount_ = 0;
+    unsigned int pinCount_ = 0;
+    int64_t lastAccessMs_ = 0;
+    bool isMonitored_ = false;
+    std::atomic<uint64_t> generation_ {0};
+    std::atomic<double> rebuildCostNsPerByte_ {0};
+    std::mutex listenerLock_;
+    int nextListenerId_ = 0;
+    std::vector<std::pair<int, RebuildListener>> listeners_;
+    /* content saved before restart, used by the first build instead of the builders */
+    std::shared_ptr<PurgeableSnapshotEntry> snapshotEntry_ = nullptr;
     bool BuildContent();
+    void BumpGeneration();
+    void NotifyRebuildListeners();
     bool IfNeedRebuild();
+    void AfterBeginAccess();
+    void AfterEndAccess();
+    void StopMonitor();
+    bool IsIdleSince(int64_t deadlineMs, int64_t &lastAccessMs, double &costNsPerByte);
+    size_t PurgeIfIdle(int64_t deadlineMs);
+    static int64_t NowMs();
     virtual bool Unpin();
     virtual bool IsPurged();
     virtual void AfterRebuildSucc();
+
+    /*
+     * BeforeWrite: called with dataLock_ held before the content is written
+     * by BeginWrite() or ModifyContentByBuilder().
+     * Return:  false if the content cannot be made writable, then the write fails.
+     */
+    virtual bool BeforeWrite();
+
+    /*
+     * RebuildContent: rebuild purged content with dataLock_ held and the content pinned.
+     * Return:  true if the content is present afterwards.
+     */
+    virtual bool RebuildContent();
     virtual std::string ToString() const;
+
+    /*
+     * DropContent: give the pages of content back to the system, called with dataLock_ held
+     * by PurgeableMemMonitor when the obj is not pinned. Content is rebuilt on next access.
+     */
+    virtual bool DropContent();
+    friend class PurgeableMemMonitor;
+    friend class PurgeableGroup;
+    friend class PurgeableSnapshot;
 };
 } /* namespace PurgeableMem */
 } /* namespace OHOS */
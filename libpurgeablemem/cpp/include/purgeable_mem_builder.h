@@ -16,11 +16,25 @@
 #ifndef OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_MEM_BUILDER_H
 #define OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_MEM_BUILDER_H
 
+#include <atomic>
 #include <memory> /* unique_ptr */
 #include <functional>
+#include <string>
 
 namespace OHOS {
 namespace PurgeableMem {
+/* content smaller than this is always built by one thread */
+constexpr size_t PARALLEL_BUILD_MIN_SIZE = 8 * 1024 * 1024;
+constexpr size_t PARALLEL_BUILD_MIN_CHUNK = 2 * 1024 * 1024;
+
+/* rolling rebuild cost: each new sample moves the average by 1 / REBUILD_COST_WEIGHT of the difference */
+constexpr int REBUILD_COST_WEIGHT = 4;
+
+inline double RollRebuildCost(double avg, double sample)
+{
+    return (avg == 0) ? sample : avg + (sample - avg) / REBUILD_COST_WEIGHT;
+}
+
 /*
  * Class PurgeableMemBuilder is a base class of user's builder.
  * PurgeableMem users can define their builders by inheriting this class.
@@ -38,6 +52,39 @@ public:
      */
     virtual bool Build(void *data, size_t size) = 0;
 
+    /*
+     * A splittable builder can build any page aligned range of the content independently,
+     * then content larger than PARALLEL_BUILD_MIN_SIZE is rebuilt in parallel by BuildRange().
+     */
+    virtual bool IsSplittable() const
+    {
+        return false;
+    }
+
+    /*
+     * User should define how to build the range [@offset, @offset + @len) of the content
+     * in this func if IsSplittable() returns true. It may be called concurrently on disjoint ranges.
+     * Input:   data: data ptr, ponits to start address of a PurgeableMem obj's content.
+     * Input:   size: data size of the whole content.
+     * Input:   offset: page aligned start offset of the range.
+     * Input:   len: length of the range.
+     * Return:  build range result, true means success, while false is fail.
+     */
+    virtual bool BuildRange(void *data, size_t size, size_t offset, size_t len)
+    {
+        return false;
+    }
+
+    /*
+     * A builder whose content depends only on a key, e.g. the path of a decoded icon,
+     * may return the key here, then PurgeableDedupMem objs whose builders return the same key
+     * and have the same size share one copy of the content. Empty means the content is not shared.
+     */
+    virtual std::string GetContentKey() const
+    {
+        return "";
+    }
+
     void SetRebuildSuccessCallback(std::function<void()> &callback)
     {
         rebuildSuccessCallback_ = callback;
@@ -50,14 +97,26 @@ public:
         }
     }
 
+    /*
+     * GetCostNsPerByte: get rolling average cost of this builder, not including the appended ones.
+     * Return:  time spent in Build() or BuildRange() per byte of content, in ns, 0 if never built.
+     */
+    double GetCostNsPerByte() const
+    {
+        return costNsPerByte_.load(std::memory_order_relaxed);
+    }
+
 private:
     std::function<void()> rebuildSuccessCallback_ = nullptr;
+    std::atomic<double> costNsPerByte_ {0};
     std::unique_ptr<PurgeableMemBuilder> nextBuilder_ = nullptr;
 
     /* Only called by its friend */
     void AppendBuilder(std::unique_ptr<PurgeableMemBuilder> builder);
     bool BuildAll(void *data, size_t size);
+    bool BuildSplit(void *data, size_t size);
     friend class PurgeableMemBase;
+    friend class PurgeableBuildHelper;
 };
 } /* namespace PurgeableMem */
 } /* namespace OHOS */
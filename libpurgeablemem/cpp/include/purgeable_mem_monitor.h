@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_MEM_MONITOR_H
+#define OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_MEM_MONITOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace OHOS {
+namespace PurgeableMem {
+class PurgeableMemBase;
+
+enum class PurgeablePressureLevel {
+    NONE = 0, /* no pressure, or the pressure has been relieved */
+    SOME,     /* some tasks are stalled on memory */
+    FULL,     /* all non-idle tasks are stalled on memory */
+};
+
+enum class PurgeableShedOrder {
+    CHEAPEST_FIRST = 0, /* lowest rebuild cost per byte first, then coldest first, unmeasured cost last */
+    COLDEST_FIRST,      /* least recently accessed first */
+};
+
+struct PurgeableMemMonitorConfig {
+    /* psi trigger: stall time in @windowUs that raises the level, 0 means not registered */
+    uint32_t someStallUs = 70000;
+    uint32_t fullStallUs = 100000;
+    uint32_t windowUs = 1000000;
+    /* an unpinned obj idle for at least the grace period of current level can be purged */
+    uint32_t graceMs = 30000;
+    uint32_t someGraceMs = 5000;
+    uint32_t fullGraceMs = 0;
+    /* max bytes purged for one pressure event, 0 means no limit */
+    size_t maxShedBytes = 0;
+    PurgeableShedOrder shedOrder = PurgeableShedOrder::CHEAPEST_FIRST;
+};
+
+using PurgeablePressureCallback = std::function<void(PurgeablePressureLevel)>;
+
+/*
+ * Class PurgeableMemMonitor watches /proc/pressure/memory in a background thread.
+ * When a stall threshold is exceeded, it shortens the unpin grace period and purges the
+ * coldest unpinned objs, so that rebuildable data is dropped before the kernel starts
+ * reclaiming other pages. Objs register themselves on access while the monitor is running.
+ */
+class PurgeableMemMonitor {
+public:
+    static PurgeableMemMonitor &GetInstance();
+
+    /*
+     * Start: register psi triggers and start the monitor thread.
+     * Return:  false if psi is not supported or the thread fails to start.
+     */
+    bool Start(const PurgeableMemMonitorConfig &config);
+    void Stop();
+    bool IsRunning() const;
+
+    /*
+     * RegisterPressureCallback: @callback is called in the monitor thread after shedding.
+     * Return:  id for UnregisterPressureCallback(), -1 if @callback is empty.
+     */
+    int RegisterPressureCallback(const PurgeablePressureCallback &callback);
+    void UnregisterPressureCallback(int id);
+
+    /*
+     * Shed: purge unpinned objs idle for at least the grace period of @level, in config.shedOrder.
+     * Return:  purged bytes.
+     */
+    size_t Shed(PurgeablePressureLevel level);
+    uint32_t GetGracePeriodMs() const;
+
+    PurgeableMemMonitor(const PurgeableMemMonitor&) = delete;
+    PurgeableMemMonitor& operator = (const PurgeableMemMonitor&) = delete;
+
+private:
+    PurgeableMemMonitor() = default;
+    ~PurgeableMemMonitor();
+    bool Register(PurgeableMemBase *obj);
+    void Unregister(PurgeableMemBase *obj);
+    int OpenTrigger(const char *type, uint32_t stallUs);
+    void CloseTriggers();
+    void JoinLoopLocked();
+    void MonitorLoop();
+    void NotifyCallbacks(PurgeablePressureLevel level);
+    uint32_t GetGraceOfLevel(PurgeablePressureLevel level) const;
+
+    PurgeableMemMonitorConfig config_;
+    std::atomic<bool> isRunning_ {false};
+    std::atomic<uint32_t> graceMs_ {0};
+    int someFd_ = -1;
+    int fullFd_ = -1;
+    int stopFd_ = -1;
+    std::thread thread_;
+    std::mutex stateLock_;
+    std::mutex objsLock_;
+    std::set<PurgeableMemBase *> objs_;
+    std::mutex callbackLock_;
+    std::map<int, PurgeablePressureCallback> callbacks_;
+    int nextCallbackId_ = 0;
+    friend class PurgeableMemBase;
+};
+} /* namespace PurgeableMem */
+} /* namespace OHOS */
+#endif /* OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_MEM_MONITOR_H */
@@ -0,0 +1,427 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_MEM_POLICY_H
+#define OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_MEM_POLICY_H
+
+#include <memory> /* unique_ptr */
+#include <new> /* nothrow */
+#include <string>
+#include <fcntl.h> /* fallocate, F_GET_SEALS */
+#include <sys/ioctl.h>
+#include <sys/mman.h> /* mmap, memfd_create */
+#include <unistd.h>
+
+#include <linux/ashmem.h>
+
+#include "ashmem.h"
+#include "pm_util.h"
+#include "ux_page_table.h"
+
+#ifndef ASHMEM_SET_PURGEABLE
+#define ASHMEM_SET_PURGEABLE                   _IO(__ASHMEMIOC, 11)
+#endif
+#ifndef ASHMEM_GET_PURGEABLE
+#define ASHMEM_GET_PURGEABLE                   _IO(__ASHMEMIOC, 12)
+#endif
+#ifndef PURGEABLE_ASHMEM_IS_PURGED
+#define PURGEABLE_ASHMEM_IS_PURGED             _IO(__ASHMEMIOC, 13)
+#endif
+#ifndef PURGEABLE_ASHMEM_REBUILD_SUCCESS
+#define PURGEABLE_ASHMEM_REBUILD_SUCCESS       _IO(__ASHMEMIOC, 14)
+#endif
+#ifndef FALLOC_FL_KEEP_SIZE
+#define FALLOC_FL_KEEP_SIZE                    0x01
+#endif
+#ifndef FALLOC_FL_PUNCH_HOLE
+#define FALLOC_FL_PUNCH_HOLE                   0x02
+#endif
+#ifndef F_GET_SEALS
+#define F_GET_SEALS                            1034
+#endif
+
+namespace OHOS {
+namespace PurgeableMem {
+/*
+ * Backend policies of BasicPurgeableMem. A policy owns the backend state of one obj and provides:
+ *   void *Map(size_t size);                  map page aligned @size bytes, nullptr if fail
+ *   bool Unmap(void *data, size_t size);
+ *   bool Pin(void *data, size_t size);       system cannot reclaim the content until Unpin()
+ *   bool Unpin(void *data, size_t size);
+ *   bool IsPurged(void *data, size_t size);  content is reclaimed by system and must be rebuilt
+ *   void AfterRebuildSucc();
+ *   bool Drop(void *data, size_t size);      give the pages of unpinned content back to system
+ * All of them are inline and never log, so that the access path compiles down to the backend calls.
+ */
+
+/* Content in MAP_PURGEABLE memory, pinned by refcount of user extend page table entries. */
+class UxptPolicy {
+public:
+    void *Map(size_t size)
+    {
+        pageTable_ = nullptr;
+        unsigned int utype = MAP_ANONYMOUS;
+        utype |= (UxpteIsEnabled() ? MAP_PURGEABLE : MAP_PRIVATE);
+        void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, static_cast<int>(utype), -1, 0);
+        if (data == MAP_FAILED) {
+            return nullptr;
+        }
+        pageTable_.reset(new (std::nothrow) UxPageTable(reinterpret_cast<uint64_t>(data), size));
+        if (pageTable_ == nullptr) {
+            munmap(data, size);
+            return nullptr;
+        }
+        return data;
+    }
+
+    bool Unmap(void *data, size_t size)
+    {
+        return munmap(data, size) == 0;
+    }
+
+    bool Pin(void *data, size_t size)
+    {
+        if (pageTable_ == nullptr) {
+            return false;
+        }
+        pageTable_->GetUxpte(reinterpret_cast<uint64_t>(data), size);
+        return true;
+    }
+
+    bool Unpin(void *data, size_t size)
+    {
+        if (pageTable_ == nullptr) {
+            return false;
+        }
+        pageTable_->PutUxpte(reinterpret_cast<uint64_t>(data), size);
+        return true;
+    }
+
+    bool IsPurged(void *data, size_t size)
+    {
+        if (pageTable_ == nullptr) {
+            return false;
+        }
+        return !pageTable_->CheckPresent(reinterpret_cast<uint64_t>(data), size);
+    }
+
+    void AfterRebuildSucc()
+    {
+    }
+
+    bool Drop(void *data, size_t size)
+    {
+        return madvise(data, size, MADV_DONTNEED) == 0;
+    }
+
+    std::string ToString() const
+    {
+        return pageTable_ ? pageTable_->ToString() : "0";
+    }
+
+private:
+    std::unique_ptr<UxPageTable> pageTable_ = nullptr;
+};
+
+/*
+ * Content in a purgeable ashmem region, pinned by ASHMEM_PIN of the whole region.
+ * The static primitives work on a bare fd, they are shared with PurgeableAshMem.
+ */
+class AshmemPolicy {
+public:
+    AshmemPolicy() = default;
+    AshmemPolicy(const AshmemPolicy&) = delete;
+    AshmemPolicy& operator = (const AshmemPolicy&) = delete;
+
+    ~AshmemPolicy()
+    {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    /* Return:  true if the region of @fd supports purging */
+    static bool SetFdPurgeable(int fd)
+    {
+        TEMP_FAILURE_RETRY(ioctl(fd, ASHMEM_SET_PURGEABLE));
+        return TEMP_FAILURE_RETRY(ioctl(fd, ASHMEM_GET_PURGEABLE)) == 1;
+    }
+
+    static bool PinFd(int fd, bool isSupport, ashmem_pin &pin)
+    {
+        if (!isSupport) {
+            return true;
+        }
+        if (fd <= 0) {
+            return false;
+        }
+        TEMP_FAILURE_RETRY(ioctl(fd, ASHMEM_PIN, &pin));
+        return true;
+    }
+
+    static bool UnpinFd(int fd, bool isSupport, ashmem_pin &pin)
+    {
+        if (!isSupport) {
+            return true;
+        }
+        if (fd <= 0) {
+            return false;
+        }
+        TEMP_FAILURE_RETRY(ioctl(fd, ASHMEM_UNPIN, &pin));
+        return true;
+    }
+
+    static bool IsFdPurged(int fd, bool isSupport)
+    {
+        if (!isSupport) {
+            return false;
+        }
+        return ioctl(fd, PURGEABLE_ASHMEM_IS_PURGED) > 0;
+    }
+
+    static void FdRebuildSucc(int fd)
+    {
+        TEMP_FAILURE_RETRY(ioctl(fd, PURGEABLE_ASHMEM_REBUILD_SUCCESS));
+    }
+
+    void *Map(size_t size)
+    {
+        int fd = AshmemCreate("PurgeableAshmem", size);
+        if (fd < 0) {
+            return nullptr;
+        }
+        if (AshmemSetProt(fd, PROT_READ | PROT_WRITE) < 0) {
+            close(fd);
+            return nullptr;
+        }
+        void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return nullptr;
+        }
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+        fd_ = fd;
+        pin_ = { static_cast<uint32_t>(0), static_cast<uint32_t>(0) };
+        isSupport_ = SetFdPurgeable(fd_);
+        /* a new region is pinned, content is unpinned until access begins */
+        UnpinFd(fd_, isSupport_, pin_);
+        return data;
+    }
+
+    bool Unmap(void *data, size_t size)
+    {
+        return munmap(data, size) == 0;
+    }
+
+    bool Pin(void *data, size_t size)
+    {
+        return PinFd(fd_, isSupport_, pin_);
+    }
+
+    bool Unpin(void *data, size_t size)
+    {
+        return UnpinFd(fd_, isSupport_, pin_);
+    }
+
+    bool IsPurged(void *data, size_t size)
+    {
+        return IsFdPurged(fd_, isSupport_);
+    }
+
+    void AfterRebuildSucc()
+    {
+        FdRebuildSucc(fd_);
+    }
+
+    bool Drop(void *data, size_t size)
+    {
+        /* content is shared, MADV_DONTNEED only drops this mapping, so remove the backing pages */
+        return madvise(data, size, MADV_REMOVE) == 0;
+    }
+
+    int GetFd() const
+    {
+        return fd_;
+    }
+
+private:
+    int fd_ = -1;
+    bool isSupport_ = false;
+    ashmem_pin pin_ = { static_cast<uint32_t>(0), static_cast<uint32_t>(0) };
+};
+
+/*
+ * Content in a memfd, for standard Linux where purgeable ashmem is not available.
+ * Purged pages are holes punched by fallocate(), so every process mapping the fd sees the purge,
+ * and a range is purged if it contains a hole. Nothing is punched while the content is pinned
+ * in this process, but pins are not seen by other processes: the content must not be shared.
+ * PurgeableAshMem with a PurgeableSharedCtrl shares the pins of a memfd between processes.
+ * The static primitives work on a bare fd, they are shared with PurgeableAshMem.
+ */
+class MemfdPolicy {
+public:
+    MemfdPolicy() = default;
+    MemfdPolicy(const MemfdPolicy&) = delete;
+    MemfdPolicy& operator = (const MemfdPolicy&) = delete;
+
+    ~MemfdPolicy()
+    {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    /* Return:  fd of a new memfd of @size bytes, -1 if fail */
+    static int CreateFd(const char *name, size_t size)
+    {
+        int fd = memfd_create(name, MFD_CLOEXEC);
+        if (fd < 0) {
+            return -1;
+        }
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    /*
+     * Return:  true if @fd is a memfd, whose pages can be punched out. Only shmem files support seals,
+     *          unlike e.g. an ashmem fd, even though /dev/ashmem itself is on a tmpfs.
+     */
+    static bool IsFdPunchable(int fd)
+    {
+        return fd >= 0 && fcntl(fd, F_GET_SEALS) >= 0;
+    }
+
+    /* Return:  true if any page in [@offset, @offset + @len) of @fd has been punched out */
+    static bool IsFdRangePurged(int fd, size_t offset, size_t len)
+    {
+        off_t hole = lseek(fd, static_cast<off_t>(offset), SEEK_HOLE);
+        if (hole < 0) {
+            return false;
+        }
+        return static_cast<size_t>(hole) < offset + len;
+    }
+
+    /* give pages in [@offset, @offset + @len) of @fd back to the system, they read as zero later */
+    static bool PunchFdRange(int fd, size_t offset, size_t len)
+    {
+        return fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+            static_cast<off_t>(offset), static_cast<off_t>(len)) == 0;
+    }
+
+    void *Map(size_t size)
+    {
+        int fd = CreateFd("PurgeableMemfd", size);
+        if (fd < 0) {
+            return nullptr;
+        }
+        void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return nullptr;
+        }
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+        fd_ = fd;
+        return data;
+    }
+
+    bool Unmap(void *data, size_t size)
+    {
+        return munmap(data, size) == 0;
+    }
+
+    bool Pin(void *data, size_t size)
+    {
+        return true;
+    }
+
+    bool Unpin(void *data, size_t size)
+    {
+        return true;
+    }
+
+    bool IsPurged(void *data, size_t size)
+    {
+        return IsFdRangePurged(fd_, 0, size);
+    }
+
+    void AfterRebuildSucc()
+    {
+    }
+
+    bool Drop(void *data, size_t size)
+    {
+        return PunchFdRange(fd_, 0, size);
+    }
+
+    int GetFd() const
+    {
+        return fd_;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+/*
+ * Content in ordinary private memory, never reclaimed by system behind the user's back.
+ * It is only dropped by Drop(), for hosts without uxpt or ashmem support and for tests.
+ */
+class EmulatedPolicy {
+public:
+    void *Map(size_t size)
+    {
+        void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+        return data == MAP_FAILED ? nullptr : data;
+    }
+
+    bool Unmap(void *data, size_t size)
+    {
+        return munmap(data, size) == 0;
+    }
+
+    bool Pin(void *data, size_t size)
+    {
+        return true;
+    }
+
+    bool Unpin(void *data, size_t size)
+    {
+        return true;
+    }
+
+    bool IsPurged(void *data, size_t size)
+    {
+        return false;
+    }
+
+    void AfterRebuildSucc()
+    {
+    }
+
+    bool Drop(void *data, size_t size)
+    {
+        return madvise(data, size, MADV_DONTNEED) == 0;
+    }
+};
+} /* namespace PurgeableMem */
+} /* namespace OHOS */
+#endif /* OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_MEM_POLICY_H */
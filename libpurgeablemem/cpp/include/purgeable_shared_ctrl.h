@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_SHARED_CTRL_H
+#define OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_SHARED_CTRL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace OHOS {
+namespace PurgeableMem {
+/*
+ * Layout of the control block, in the page right after the content in the shared fd.
+ * All processes mapping the fd see the same block, its fields are only accessed atomically.
+ */
+struct PurgeableSharedCtrlBlock {
+    std::atomic<uint32_t> magic;
+    std::atomic<uint32_t> state;        /* futex word, 0 or pid of the rebuilder, see REBUILD_WAITED */
+    std::atomic<uint32_t> generation;   /* bumped after each successful rebuild */
+    std::atomic<uint32_t> pins;         /* futex word, pin count or dropper pid, see PIN_DROPPING */
+};
+
+/*
+ * Class PurgeableSharedCtrl coordinates the rebuild of a purgeable fd shared by several processes.
+ * When the content is purged, one process becomes the rebuilder, the others sleep on the futex
+ * and use the rebuilt content when it finishes, so the content is rebuilt once per purge.
+ */
+class PurgeableSharedCtrl {
+public:
+    PurgeableSharedCtrl() = default;
+    ~PurgeableSharedCtrl();
+    PurgeableSharedCtrl(const PurgeableSharedCtrl&) = delete;
+    PurgeableSharedCtrl& operator = (const PurgeableSharedCtrl&) = delete;
+
+    /* size reserved for the control block after the page aligned content */
+    static size_t GetCtrlSize();
+
+    /*
+     * Attach: map the control block at @offset of @fd.
+     * Only the creator of the fd, with @create, initializes the block. Others attach only if it is
+     * initialized, so that nothing is written into the content of an fd without a control block.
+     * Return:  false if the block cannot be mapped or is not initialized, then rebuild is not coordinated.
+     */
+    bool Attach(int fd, size_t offset, bool create);
+    void Detach();
+    bool IsAttached() const;
+
+    /*
+     * BeginRebuild: try to become the rebuilder of the content.
+     * Return:  true if the caller is the rebuilder, it must call EndRebuild() after rebuilding.
+     *          false after waiting for the rebuild of another process, the caller should check
+     *          whether the content is still purged, since that rebuild may have failed.
+     */
+    bool BeginRebuild();
+    void EndRebuild(bool succ);
+
+    /* Return:  true if some process is rebuilding the content, which is not ready to read */
+    bool IsRebuilding() const;
+
+    /* Return:  generation of the shared content, 0 if not attached */
+    uint32_t GetGeneration() const;
+
+    /*
+     * Pin: count a pin of the content seen by all processes, waits while some process drops it.
+     * A process dying with the content pinned leaks its pins, the content is never dropped then.
+     */
+    void Pin();
+    void Unpin();
+
+    /*
+     * TryBeginDrop: block Pin() of all processes while the content is dropped.
+     * Return:  false if the content is pinned or being dropped, else EndDrop() must be called.
+     */
+    bool TryBeginDrop();
+    void EndDrop();
+
+private:
+    /*
+     * state is the pid of the rebuilder, so a waiter can take over from a dead one, and this bit
+     * is set when some process is sleeping on the futex. Both are published by one CAS.
+     */
+    static constexpr uint32_t REBUILD_IDLE = 0;
+    static constexpr uint32_t REBUILD_WAITED = 1U << 31;
+    /* while set, the low bits of pins are the pid of the dropper instead of the pin count */
+    static constexpr uint32_t PIN_DROPPING = 1U << 31;
+    void WaitRebuild(uint32_t state);
+    void TakeOverIfRebuilderDied(uint32_t state);
+    void WaitDrop(uint32_t pins);
+
+    PurgeableSharedCtrlBlock *block_ = nullptr;
+};
+} /* namespace PurgeableMem */
+} /* namespace OHOS */
+#endif /* OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_SHARED_CTRL_H */
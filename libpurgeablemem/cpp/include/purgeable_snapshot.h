@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_SNAPSHOT_H
+#define OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_SNAPSHOT_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "purgeable_mem_base.h"
+
+namespace OHOS {
+namespace PurgeableMem {
+/*
+ * Content of one obj in a loaded snapshot file. It is consumed by the first build of the obj,
+ * which reads the content from the file instead of running the builders.
+ */
+class PurgeableSnapshotEntry {
+public:
+    PurgeableSnapshotEntry(std::shared_ptr<int> fd, uint64_t offset, uint64_t size, uint32_t crc);
+
+    /*
+     * Restore: read the content into @data.
+     * Return:  false if @size does not match or the content fails the checksum,
+     *          then the caller builds the content by its builders.
+     */
+    bool Restore(void *data, size_t size) const;
+
+private:
+    std::shared_ptr<int> fd_; /* shared by all entries of the file, closed with the last one */
+    uint64_t offset_;
+    uint64_t size_;
+    uint32_t crc_;
+};
+
+/*
+ * Class PurgeableSnapshot saves the content of selected objs to a local file, e.g. at shutdown
+ * or when idle, so that after a restart they are restored from the file instead of rebuilt.
+ * The file holds a header, a table of {key, offset, size, crc32} and page aligned contents.
+ * It is versioned by the format and by @version of the caller, which should change whenever
+ * the builders produce different content. Objs are identified by keys stable across restarts.
+ * The snapshot does not own the objs, an obj must be removed before it is destroyed.
+ */
+class PurgeableSnapshot {
+public:
+    PurgeableSnapshot(const std::string &path, uint32_t version);
+    ~PurgeableSnapshot() = default;
+    PurgeableSnapshot(const PurgeableSnapshot&) = delete;
+    PurgeableSnapshot& operator = (const PurgeableSnapshot&) = delete;
+
+    /*
+     * Add: select @obj for Save() and Load() under @key.
+     * Return:  false if @obj is nullptr or @key is empty or already added.
+     */
+    bool Add(const std::string &key, PurgeableMemBase *obj);
+    bool Remove(const std::string &key);
+
+    /*
+     * Save: write content of the added objs to the file, replacing it atomically.
+     * Objs whose content is purged or never built are skipped, they are not rebuilt for this.
+     * Content written between BeginWrite() and EndWrite() meanwhile may be saved half written,
+     * so call it when writers are idle.
+     * Return:  number of objs saved, -1 if the file cannot be written.
+     */
+    int Save();
+
+    /*
+     * Load: read the file and attach its content to the added objs never built,
+     * their first BeginRead()/BeginWrite() then reads it instead of running the builders.
+     * Return:  number of objs attached, -1 if the file is missing, corrupted or of another version.
+     */
+    int Load();
+
+private:
+    bool WriteFile(const std::string &tmpPath, int &saved);
+
+    std::string path_;
+    uint32_t version_;
+    std::mutex lock_;
+    std::map<std::string, PurgeableMemBase *> objs_;
+};
+} /* namespace PurgeableMem */
+} /* namespace OHOS */
+#endif /* OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_SNAPSHOT_H */
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_STATIC_MEM_H
+#define OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_STATIC_MEM_H
+
+#include <memory> /* unique_ptr */
+#include <mutex>
+
+#include "purgeable_mem_base.h"
+#include "purgeable_mem_builder.h"
+#include "purgeable_mem_policy.h"
+
+namespace OHOS {
+namespace PurgeableMem {
+/* Slow paths shared by all backends, kept out of line. */
+class PurgeableBuildHelper {
+public:
+    /* clear the content and build it by @builder and its appended modifiers */
+    static bool Rebuild(void *data, size_t size, PurgeableMemBuilder &builder);
+    static void Append(PurgeableMemBuilder &builder, std::unique_ptr<PurgeableMemBuilder> modifier);
+    static bool Clear(void *data, size_t size);
+    static size_t RoundUpPage(size_t size);
+};
+
+/*
+ * Class BasicPurgeableMem is a purgeable obj whose backend is bound at compile time by @Policy,
+ * see purgeable_mem_policy.h. It has the same access semantics as PurgeableMem and PurgeableAshMem,
+ * but no virtual call is made on the access path, so pin, present check and unpin are inlined.
+ * Use it for small objs accessed in tight loops, where the access overhead dominates.
+ */
+template <typename Policy>
+class BasicPurgeableMem {
+public:
+    BasicPurgeableMem(size_t dataSize, std::unique_ptr<PurgeableMemBuilder> builder)
+    {
+        if (dataSize == 0 || dataSize >= OHOS_MAXIMUM_PURGEABLE_MEMORY || builder == nullptr) {
+            return;
+        }
+        dataPtr_ = backend_.Map(PurgeableBuildHelper::RoundUpPage(dataSize));
+        if (dataPtr_ == nullptr) {
+            return;
+        }
+        dataSizeInput_ = dataSize;
+        builder_ = std::move(builder);
+    }
+
+    ~BasicPurgeableMem()
+    {
+        if (dataPtr_ != nullptr) {
+            backend_.Unmap(dataPtr_, PurgeableBuildHelper::RoundUpPage(dataSizeInput_));
+            dataPtr_ = nullptr;
+        }
+    }
+
+    BasicPurgeableMem(const BasicPurgeableMem&) = delete;
+    BasicPurgeableMem& operator = (const BasicPurgeableMem&) = delete;
+
+    /* see PurgeableMemBase::BeginRead() */
+    bool BeginRead()
+    {
+        return BeginAccess();
+    }
+
+    void EndRead()
+    {
+        EndAccess();
+    }
+
+    /* see PurgeableMemBase::BeginWrite() */
+    bool BeginWrite()
+    {
+        return BeginAccess();
+    }
+
+    void EndWrite()
+    {
+        EndAccess();
+    }
+
+    /* see PurgeableMemBase::ModifyContentByBuilder() */
+    bool ModifyContentByBuilder(std::unique_ptr<PurgeableMemBuilder> modifier)
+    {
+        if (modifier == nullptr) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(dataLock_);
+        if (dataPtr_ != nullptr && !IfNeedRebuild() && !modifier->Build(dataPtr_, dataSizeInput_)) {
+            return false;
+        }
+        if (builder_) {
+            PurgeableBuildHelper::Append(*builder_, std::move(modifier));
+        } else {
+            builder_ = std::move(modifier);
+        }
+        return true;
+    }
+
+    /*
+     * Purge: give the content back to the system if it is not pinned,
+     * it is rebuilt on next access.
+     * Return:  true if the content is dropped.
+     */
+    bool Purge()
+    {
+        std::lock_guard<std::mutex> lock(dataLock_);
+        if (dataPtr_ == nullptr || pinCount_ != 0 || buildDataCount_ == 0) {
+            return false;
+        }
+        if (!backend_.Drop(dataPtr_, PurgeableBuildHelper::RoundUpPage(dataSizeInput_))) {
+            return false;
+        }
+        buildDataCount_ = 0;
+        return true;
+    }
+
+    void *GetContent()
+    {
+        std::lock_guard<std::mutex> lock(dataLock_);
+        return dataPtr_;
+    }
+
+    size_t GetContentSize()
+    {
+        std::lock_guard<std::mutex> lock(dataLock_);
+        return dataSizeInput_;
+    }
+
+    const Policy &GetBackend() const
+    {
+        return backend_;
+    }
+
+private:
+    static constexpr int MAX_BUILD_TRYTIMES = 3;
+
+    bool IfNeedRebuild()
+    {
+        return buildDataCount_ == 0 || backend_.IsPurged(dataPtr_, dataSizeInput_);
+    }
+
+    bool BeginAccess()
+    {
+        std::lock_guard<std::mutex> lock(dataLock_);
+        if (dataPtr_ == nullptr || builder_ == nullptr) {
+            return false;
+        }
+        if (!backend_.Pin(dataPtr_, dataSizeInput_)) {
+            return false;
+        }
+        for (int tryTimes = 0; IfNeedRebuild(); tryTimes++) {
+            if (tryTimes >= MAX_BUILD_TRYTIMES ||
+                !PurgeableBuildHelper::Rebuild(dataPtr_, dataSizeInput_, *builder_)) {
+                backend_.Unpin(dataPtr_, dataSizeInput_);
+                return false;
+            }
+            buildDataCount_++;
+            backend_.AfterRebuildSucc();
+        }
+        pinCount_++;
+        return true;
+    }
+
+    void EndAccess()
+    {
+        std::lock_guard<std::mutex> lock(dataLock_);
+        if (pinCount_ == 0) {
+            return;
+        }
+        backend_.Unpin(dataPtr_, dataSizeInput_);
+        pinCount_--;
+    }
+
+    Policy backend_;
+    std::mutex dataLock_;
+    void *dataPtr_ = nullptr;
+    size_t dataSizeInput_ = 0;
+    unsigned int buildDataCount_ = 0;
+    unsigned int pinCount_ = 0;
+    std::unique_ptr<PurgeableMemBuilder> builder_ = nullptr;
+};
+
+using StaticPurgeableMem = BasicPurgeableMem<UxptPolicy>;
+using StaticPurgeableAshMem = BasicPurgeableMem<AshmemPolicy>;
+using StaticPurgeableMemfdMem = BasicPurgeableMem<MemfdPolicy>;
+using StaticEmulatedPurgeableMem = BasicPurgeableMem<EmulatedPolicy>;
+} /* namespace PurgeableMem */
+} /* namespace OHOS */
+#endif /* OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_STATIC_MEM_H */
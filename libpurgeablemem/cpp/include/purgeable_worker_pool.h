@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_WORKER_POOL_H
+#define OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_WORKER_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace OHOS {
+namespace PurgeableMem {
+/*
+ * Class PurgeableWorkerPool runs the chunks of a large rebuild in parallel.
+ * Workers are created on first use, the calling thread always takes part in the work.
+ */
+class PurgeableWorkerPool {
+public:
+    static PurgeableWorkerPool &GetInstance();
+
+    /*
+     * ParallelFor: call @task(i) for i in [0, @count) on the workers and the calling thread.
+     * Return:  true if all tasks succeed. It returns after all tasks are finished.
+     */
+    bool ParallelFor(size_t count, const std::function<bool(size_t)> &task);
+
+    /*
+     * ParallelForRange: split [0, @size) into page aligned chunks not smaller than @minChunk,
+     * and call @task(offset, len) for each chunk in parallel.
+     * Return:  true if all tasks succeed. It returns after all tasks are finished.
+     */
+    bool ParallelForRange(size_t size, size_t minChunk, const std::function<bool(size_t, size_t)> &task);
+
+    /* number of threads that can run tasks at the same time, including the calling thread */
+    size_t GetConcurrency();
+
+    PurgeableWorkerPool(const PurgeableWorkerPool&) = delete;
+    PurgeableWorkerPool& operator = (const PurgeableWorkerPool&) = delete;
+
+private:
+    PurgeableWorkerPool() = default;
+    ~PurgeableWorkerPool();
+    void StartWorkers();
+    void WorkerLoop();
+
+    std::mutex lock_;
+    std::condition_variable cond_;
+    std::deque<std::function<void()>> jobs_;
+    std::vector<std::thread> workers_;
+    bool isStarted_ = false;
+    bool isStopped_ = false;
+};
+} /* namespace PurgeableMem */
+} /* namespace OHOS */
+#endif /* OHOS_UTILS_MEMORY_LIBPURGEABLEMEM_CPP_INCLUDE_PURGEABLE_WORKER_POOL_H */
@@ -29,11 +29,23 @@ public:
 
 private:
     UxPageTableStruct *uxpt_;
-    friend class PurgeableMem;
-    /* only called by its friend */
-    void GetUxpte(uint64_t addr, size_t len);
-    void PutUxpte(uint64_t addr, size_t len);
-    bool CheckPresent(uint64_t addr, size_t len);
+    friend class UxptPolicy;
+    /* only called by its friend, inline since they are on the access path */
+    void GetUxpte(uint64_t addr, size_t len)
+    {
+        UxpteGet(uxpt_, addr, len);
+    }
+
+    void PutUxpte(uint64_t addr, size_t len)
+    {
+        UxptePut(uxpt_, addr, len);
+    }
+
+    bool CheckPresent(uint64_t addr, size_t len)
+    {
+        return UxpteIsPresent(uxpt_, addr, len);
+    }
+
     std::string ToString() const;
 };
 } /* namespace PurgeableMem */
@@ -13,7 +13,9 @@
  * limitations under the License.
  */
 
+#include <cerrno>
 #include <sys/mman.h> /* mmap */
+#include <sys/stat.h> /* fstat */
 
 #include "securec.h"
 #include "pm_util.h"
@@ -56,6 +58,12 @@ PurgeableAshMem::PurgeableAshMem(std::unique_ptr<PurgeableMemBuilder> builder)
 }
 
 PurgeableAshMem::PurgeableAshMem(size_t dataSize, std::unique_ptr<PurgeableMemBuilder> builder)
+    : PurgeableAshMem(dataSize, std::move(builder), false)
+{
+}
+
+PurgeableAshMem::PurgeableAshMem(size_t dataSize, std::unique_ptr<PurgeableMemBuilder> builder,
+    bool sharedRebuild)
 {
     dataPtr_ = nullptr;
     builder_ = nullptr;
@@ -63,6 +71,7 @@ PurgeableAshMem::PurgeableAshMem(size_t dataSize, std::unique_ptr<PurgeableMemBu
     buildDataCount_ = 0;
     isSupport_ = false;
     isChange_ = false;
+    sharedRebuild_ = sharedRebuild;
     if (dataSize == 0) {
         return;
     }
@@ -79,6 +88,8 @@ PurgeableAshMem::PurgeableAshMem(size_t dataSize, std::unique_ptr<PurgeableMemBu
 
 PurgeableAshMem::~PurgeableAshMem()
 {
+    StopMonitor();
+    DetachSharedCtrl();
     PM_HILOG_DEBUG(LOG_CORE, "%{public}s %{public}s", __func__, ToString().c_str());
     if (!isChange_ && dataPtr_) {
         if (munmap(dataPtr_, RoundUp(dataSizeInput_, PAGE_SIZE)) != 0) {
@@ -99,14 +110,28 @@ int PurgeableAshMem::GetAshmemFd()
     return ashmemFd_;
 }
 
+uint32_t PurgeableAshMem::GetSharedGeneration() const
+{
+    return sharedCtrl_.GetGeneration();
+}
+
 bool PurgeableAshMem::IsPurged()
 {
+    /* content being rebuilt by another process is cleared but present, it is not ready yet */
+    return sharedCtrl_.IsRebuilding() || IsContentPurged();
+}
+
+bool PurgeableAshMem::IsContentPurged()
+{
+    if (isMemfd_) {
+        return MemfdPolicy::IsFdRangePurged(ashmemFd_, 0, dataSizeInput_);
+    }
     if (!isSupport_) {
         return false;
     }
-    int ret = ioctl(ashmemFd_, PURGEABLE_ASHMEM_IS_PURGED);
+    bool ret = AshmemPolicy::IsFdPurged(ashmemFd_, isSupport_);
     PM_HILOG_DEBUG(LOG_CORE, "%{public}s: IsPurged %{public}d", __func__, ret);
-    return ret > 0 ? true : false;
+    return ret;
 }
 
 bool PurgeableAshMem::CreatePurgeableData()
@@ -116,11 +141,16 @@ bool PurgeableAshMem::CreatePurgeableData()
         return false;
     }
     size_t size = RoundUp(dataSizeInput_, PAGE_SIZE);
-    int fd = AshmemCreate("PurgeableAshmem", size);
+    size_t fdSize = sharedRebuild_ ? size + PurgeableSharedCtrl::GetCtrlSize() : size;
+    int fd = AshmemCreate("PurgeableAshmem", fdSize);
     if (fd < 0) {
-        return false;
-    }
-    if (AshmemSetProt(fd, PROT_READ | PROT_WRITE) < 0) {
+        /* no ashmem device, as on standard Linux */
+        fd = MemfdPolicy::CreateFd("PurgeableAshmem", fdSize);
+        if (fd < 0) {
+            PM_HILOG_ERROR(LOG_CORE, "%{public}s: create fd fail, errno %{public}d", __func__, errno);
+            return false;
+        }
+    } else if (AshmemSetProt(fd, PROT_READ | PROT_WRITE) < 0) {
         close(fd);
         return false;
     }
@@ -133,43 +163,71 @@ bool PurgeableAshMem::CreatePurgeableData()
         close(ashmemFd_);
         return false;
     }
-    TEMP_FAILURE_RETRY(ioctl(ashmemFd_, ASHMEM_SET_PURGEABLE));
-    if (TEMP_FAILURE_RETRY(ioctl(ashmemFd_, ASHMEM_GET_PURGEABLE)) == 1) {
+    if (AshmemPolicy::SetFdPurgeable(ashmemFd_)) {
         isSupport_ = true;
     }
+    isMemfd_ = !isSupport_ && MemfdPolicy::IsFdPunchable(ashmemFd_);
+    if (sharedRebuild_) {
+        AttachSharedCtrl(size, true);
+    }
     Unpin();
     return true;
 }
 
-bool PurgeableAshMem::Pin()
+void PurgeableAshMem::AttachSharedCtrl(size_t size, bool create)
 {
-    if (!isSupport_) {
-        return true;
+    /* ashmem reports its size by ioctl, a memfd by fstat */
+    off_t fdSize = AshmemGetSize(ashmemFd_);
+    struct stat st;
+    if (fdSize < 0 && fstat(ashmemFd_, &st) == 0) {
+        fdSize = st.st_size;
     }
-    if (ashmemFd_ > 0) {
-        TEMP_FAILURE_RETRY(ioctl(ashmemFd_, ASHMEM_PIN, &pin_));
-        PM_HILOG_DEBUG(LOG_CORE, "%{public}s: fd:%{public}d PURGEABLE_GET_PIN_STATE: %{public}d",
-                       __func__, ashmemFd_, ioctl(ashmemFd_, ASHMEM_GET_PIN_STATUS, &pin_));
-    } else {
+    if (fdSize < 0 || static_cast<size_t>(fdSize) < size + PurgeableSharedCtrl::GetCtrlSize()) {
+        return; /* the creator did not reserve a control block, rebuild alone */
+    }
+    if (!sharedCtrl_.Attach(ashmemFd_, size, create)) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: attach fail, rebuild is not coordinated", __func__);
+    }
+}
+
+void PurgeableAshMem::DetachSharedCtrl()
+{
+    /* pins left by this obj would block other processes from dropping forever */
+    for (; sharedPins_ > 0; sharedPins_--) {
+        sharedCtrl_.Unpin();
+    }
+    sharedCtrl_.Detach();
+}
+
+bool PurgeableAshMem::Pin()
+{
+    if (!AshmemPolicy::PinFd(ashmemFd_, isSupport_, pin_)) {
         PM_HILOG_DEBUG(LOG_CORE, "ashmemFd_ not exist!!");
         return false;
     }
+    /* a memfd is punched by any process sharing it, so the pin must be seen by all of them */
+    if (isMemfd_ && sharedCtrl_.IsAttached()) {
+        sharedCtrl_.Pin();
+        sharedPins_++;
+    }
+    PM_HILOG_DEBUG(LOG_CORE, "%{public}s: fd:%{public}d PURGEABLE_GET_PIN_STATE: %{public}d",
+                   __func__, ashmemFd_, GetPinStatus());
     return true;
 }
 
 bool PurgeableAshMem::Unpin()
 {
-    if (!isSupport_) {
-        return true;
+    /* the content is unpinned once at creation, without a pin before */
+    if (sharedPins_ > 0) {
+        sharedCtrl_.Unpin();
+        sharedPins_--;
     }
-    if (ashmemFd_ > 0) {
-        TEMP_FAILURE_RETRY(ioctl(ashmemFd_, ASHMEM_UNPIN, &pin_));
-        PM_HILOG_DEBUG(LOG_CORE, "%{public}s: fd:%{public}d PURGEABLE_GET_PIN_STATE: %{public}d",
-                       __func__, ashmemFd_, ioctl(ashmemFd_, ASHMEM_GET_PIN_STATUS, &pin_));
-    } else {
+    if (!AshmemPolicy::UnpinFd(ashmemFd_, isSupport_, pin_)) {
         PM_HILOG_DEBUG(LOG_CORE, "ashmemFd_ not exist!!");
         return false;
     }
+    PM_HILOG_DEBUG(LOG_CORE, "%{public}s: fd:%{public}d PURGEABLE_GET_PIN_STATE: %{public}d",
+                   __func__, ashmemFd_, GetPinStatus());
     return true;
 }
 
@@ -184,9 +242,59 @@ int PurgeableAshMem::GetPinStatus() const
     return ret;
 }
 
+bool PurgeableAshMem::RebuildContent()
+{
+    if (!sharedCtrl_.IsAttached()) {
+        return PurgeableMemBase::RebuildContent();
+    }
+    while (!sharedCtrl_.BeginRebuild()) {
+        /* another process has rebuilt the content, use it unless its rebuild failed */
+        if (!IsPurged()) {
+            buildDataCount_++;
+            BumpGeneration();
+            return true;
+        }
+    }
+    /* it may have been rebuilt by another process between our purge check and here */
+    if (buildDataCount_ != 0 && !IsContentPurged()) {
+        sharedCtrl_.EndRebuild(false);
+        BumpGeneration();
+        return true;
+    }
+    bool succ = PurgeableMemBase::RebuildContent();
+    sharedCtrl_.EndRebuild(succ);
+    return succ;
+}
+
 void PurgeableAshMem::AfterRebuildSucc()
 {
-    TEMP_FAILURE_RETRY(ioctl(ashmemFd_, PURGEABLE_ASHMEM_REBUILD_SUCCESS));
+    if (isMemfd_) {
+        return;
+    }
+    AshmemPolicy::FdRebuildSucc(ashmemFd_);
+}
+
+bool PurgeableAshMem::DropContent()
+{
+    if (isMemfd_) {
+        /* the hole is seen by all processes sharing the fd, so they rebuild too */
+        if (!sharedCtrl_.TryBeginDrop()) {
+            PM_HILOG_DEBUG(LOG_CORE, "%{public}s: pinned by another process", __func__);
+            return false;
+        }
+        bool succ = MemfdPolicy::PunchFdRange(ashmemFd_, 0, RoundUp(dataSizeInput_, PAGE_SIZE));
+        sharedCtrl_.EndDrop();
+        if (!succ) {
+            PM_HILOG_ERROR(LOG_CORE, "%{public}s: punch hole fail, errno %{public}d", __func__, errno);
+        }
+        return succ;
+    }
+    /* content is shared, MADV_DONTNEED only drops this mapping, so remove the backing pages */
+    if (madvise(dataPtr_, RoundUp(dataSizeInput_, PAGE_SIZE), MADV_REMOVE) != 0) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: madvise fail, errno %{public}d", __func__, errno);
+        return false;
+    }
+    return true;
 }
 
 void PurgeableAshMem::ResizeData(size_t newSize)
@@ -195,6 +303,7 @@ void PurgeableAshMem::ResizeData(size_t newSize)
         PM_HILOG_DEBUG(LOG_CORE, "Failed to apply for memory");
         return;
     }
+    DetachSharedCtrl();
     if (dataPtr_) {
         if (munmap(dataPtr_, RoundUp(dataSizeInput_, PAGE_SIZE)) != 0) {
             PM_HILOG_ERROR(LOG_CORE, "%{public}s: munmap dataPtr fail", __func__);
@@ -206,6 +315,7 @@ void PurgeableAshMem::ResizeData(size_t newSize)
         }
     }
     dataSizeInput_ = newSize;
+    BumpGeneration();
     if (!CreatePurgeableData()) {
         PM_HILOG_DEBUG(LOG_CORE, "Failed to create purgeabledata");
         return;
@@ -213,11 +323,17 @@ void PurgeableAshMem::ResizeData(size_t newSize)
 }
 
 bool PurgeableAshMem::ChangeAshmemData(size_t size, int fd, void *data)
+{
+    return ChangeAshmemData(size, fd, data, false);
+}
+
+bool PurgeableAshMem::ChangeAshmemData(size_t size, int fd, void *data, bool sharedRebuild)
 {
     if (size <= 0 || size >= OHOS_MAXIMUM_PURGEABLE_MEMORY) {
         PM_HILOG_DEBUG(LOG_CORE, "Failed to apply for memory");
         return false;
     }
+    DetachSharedCtrl();
     if (dataPtr_) {
         if (munmap(dataPtr_, RoundUp(dataSizeInput_, PAGE_SIZE)) != 0) {
             PM_HILOG_ERROR(LOG_CORE, "%{public}s: munmap dataPtr fail", __func__);
@@ -232,11 +348,17 @@ bool PurgeableAshMem::ChangeAshmemData(size_t size, int fd, void *data)
     ashmemFd_ = fd;
     dataPtr_ = data;
     buildDataCount_++;
+    BumpGeneration();
     isChange_ = true;
-    TEMP_FAILURE_RETRY(ioctl(ashmemFd_, ASHMEM_SET_PURGEABLE));
-    if (TEMP_FAILURE_RETRY(ioctl(ashmemFd_, ASHMEM_GET_PURGEABLE)) == 1) {
+    if (AshmemPolicy::SetFdPurgeable(ashmemFd_)) {
         isSupport_ = true;
     }
+    isMemfd_ = !isSupport_ && MemfdPolicy::IsFdPunchable(ashmemFd_);
+    /* the page after the content is only a control block if the consumer knows it is */
+    sharedRebuild_ = sharedRebuild;
+    if (sharedRebuild_) {
+        AttachSharedCtrl(RoundUp(size, PAGE_SIZE), false);
+    }
     Unpin();
     return true;
 }
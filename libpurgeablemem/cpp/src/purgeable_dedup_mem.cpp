@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <functional>
+#include <new> /* nothrow */
+
+#include "securec.h"
+#include "pm_smartptr_util.h"
+#include "pm_log.h"
+#include "purgeable_static_mem.h"
+
+#include "purgeable_dedup_mem.h"
+
+namespace OHOS {
+namespace PurgeableMem {
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "PurgeableMem: Dedup"
+
+/* Content shared by the PurgeableDedupMem objs of one key, every access is under its own lock. */
+class PurgeableDedupRegion {
+public:
+    PurgeableDedupRegion(const std::string &key, size_t size) : key_(key), size_(size)
+    {
+        dataPtr_ = backend_.Map(PurgeableBuildHelper::RoundUpPage(size));
+    }
+
+    ~PurgeableDedupRegion()
+    {
+        if (dataPtr_ != nullptr) {
+            backend_.Unmap(dataPtr_, PurgeableBuildHelper::RoundUpPage(size_));
+            dataPtr_ = nullptr;
+        }
+    }
+
+    PurgeableDedupRegion(const PurgeableDedupRegion&) = delete;
+    PurgeableDedupRegion& operator = (const PurgeableDedupRegion&) = delete;
+
+    const std::string &GetKey() const
+    {
+        return key_;
+    }
+
+    size_t GetSize() const
+    {
+        return size_;
+    }
+
+    void *GetData() const
+    {
+        return dataPtr_;
+    }
+
+    bool Pin()
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (!backend_.Pin(dataPtr_, size_)) {
+            return false;
+        }
+        pinCount_++;
+        return true;
+    }
+
+    bool Unpin()
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (!backend_.Unpin(dataPtr_, size_)) {
+            return false;
+        }
+        if (pinCount_ > 0) {
+            pinCount_--;
+        }
+        return true;
+    }
+
+    bool NeedBuild()
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        return NeedBuildLocked();
+    }
+
+    /*
+     * Build: build the content by @build unless another obj has built it meanwhile,
+     * then @adopted is set and the content is used as is.
+     */
+    bool Build(const std::function<bool()> &build, bool &adopted)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (!NeedBuildLocked()) {
+            adopted = true;
+            return true;
+        }
+        if (!build()) {
+            return false;
+        }
+        buildCount_++;
+        backend_.AfterRebuildSucc();
+        return true;
+    }
+
+    /* Return:  false if the content is not present, then nothing is copied */
+    bool CopyTo(void *dst)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        backend_.Pin(dataPtr_, size_);
+        bool succ = !NeedBuildLocked() && memcpy_s(dst, size_, dataPtr_, size_) == EOK;
+        backend_.Unpin(dataPtr_, size_);
+        return succ;
+    }
+
+    /* Return:  false if any obj pins the content */
+    bool Drop()
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (pinCount_ != 0 || !backend_.Drop(dataPtr_, PurgeableBuildHelper::RoundUpPage(size_))) {
+            return false;
+        }
+        buildCount_ = 0;
+        return true;
+    }
+
+private:
+    bool NeedBuildLocked()
+    {
+        return buildCount_ == 0 || backend_.IsPurged(dataPtr_, size_);
+    }
+
+    std::string key_;
+    size_t size_;
+    std::mutex lock_;
+    UxptPolicy backend_;
+    void *dataPtr_ = nullptr;
+    unsigned int buildCount_ = 0;
+    unsigned int pinCount_ = 0;
+};
+
+PurgeableDedupRegistry &PurgeableDedupRegistry::GetInstance()
+{
+    static PurgeableDedupRegistry instance;
+    return instance;
+}
+
+size_t PurgeableDedupRegistry::GetRegionCount()
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    size_t count = 0;
+    for (auto &item : regions_) {
+        if (!item.second.expired()) {
+            count++;
+        }
+    }
+    return count;
+}
+
+std::shared_ptr<PurgeableDedupRegion> PurgeableDedupRegistry::Acquire(const std::string &key, size_t size)
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = regions_.find({key, size});
+    if (it != regions_.end()) {
+        std::shared_ptr<PurgeableDedupRegion> region = it->second.lock();
+        if (region != nullptr) {
+            return region;
+        }
+    }
+    PurgeableDedupRegion *raw = new (std::nothrow) PurgeableDedupRegion(key, size);
+    if (raw == nullptr || raw->GetData() == nullptr) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: create region fail", __func__);
+        delete raw;
+        return nullptr;
+    }
+    /* the last obj sharing the region removes it from the registry */
+    std::shared_ptr<PurgeableDedupRegion> region(raw, [](PurgeableDedupRegion *r) {
+        PurgeableDedupRegistry::GetInstance().Release(r->GetKey(), r->GetSize());
+        delete r;
+    });
+    regions_[{key, size}] = region;
+    return region;
+}
+
+void PurgeableDedupRegistry::Release(const std::string &key, size_t size)
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = regions_.find({key, size});
+    /* the key may have a new region already, if it was acquired while the old one was dying */
+    if (it != regions_.end() && it->second.expired()) {
+        regions_.erase(it);
+    }
+}
+
+PurgeableDedupMem::PurgeableDedupMem(size_t dataSize, std::unique_ptr<PurgeableMemBuilder> builder)
+{
+    if (dataSize == 0 || dataSize >= OHOS_MAXIMUM_PURGEABLE_MEMORY) {
+        PM_HILOG_DEBUG(LOG_CORE, "Failed to apply for memory");
+        return;
+    }
+    IF_NULL_LOG_ACTION(builder, "%{public}s: input builder nullptr", return);
+    dataSizeInput_ = dataSize;
+    std::string key = builder->GetContentKey();
+    if (!key.empty()) {
+        region_ = PurgeableDedupRegistry::GetInstance().Acquire(key, dataSize);
+    }
+    if (region_ != nullptr) {
+        dataPtr_ = region_->GetData();
+    } else if (!CreatePrivateData()) {
+        return;
+    }
+    builder_ = std::move(builder);
+    PM_HILOG_DEBUG(LOG_CORE, "%{public}s init succ. %{public}s", __func__, ToString().c_str());
+}
+
+PurgeableDedupMem::~PurgeableDedupMem()
+{
+    StopMonitor();
+    if (region_ != nullptr) {
+        region_.reset();
+    } else if (dataPtr_ != nullptr && !backend_.Unmap(dataPtr_, PurgeableBuildHelper::RoundUpPage(dataSizeInput_))) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: munmap dataPtr fail", __func__);
+    }
+    dataPtr_ = nullptr;
+    builder_.reset();
+}
+
+bool PurgeableDedupMem::IsShared()
+{
+    std::lock_guard<std::mutex> lock(dataLock_);
+    return region_ != nullptr;
+}
+
+bool PurgeableDedupMem::CreatePrivateData()
+{
+    dataPtr_ = backend_.Map(PurgeableBuildHelper::RoundUpPage(dataSizeInput_));
+    if (dataPtr_ == nullptr) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: mmap fail", __func__);
+        return false;
+    }
+    return true;
+}
+
+bool PurgeableDedupMem::Pin()
+{
+    return (region_ != nullptr) ? region_->Pin() : backend_.Pin(dataPtr_, dataSizeInput_);
+}
+
+bool PurgeableDedupMem::Unpin()
+{
+    return (region_ != nullptr) ? region_->Unpin() : backend_.Unpin(dataPtr_, dataSizeInput_);
+}
+
+bool PurgeableDedupMem::IsPurged()
+{
+    return (region_ != nullptr) ? region_->NeedBuild() : backend_.IsPurged(dataPtr_, dataSizeInput_);
+}
+
+bool PurgeableDedupMem::RebuildContent()
+{
+    if (region_ == nullptr) {
+        return PurgeableMemBase::RebuildContent();
+    }
+    /* content built by another obj of the key is adopted, so it is built once for all of them */
+    bool adopted = false;
+    if (!region_->Build([this] { return BuildContent(); }, adopted)) {
+        return false;
+    }
+    if (adopted) {
+        buildDataCount_++;
+    }
+    BumpGeneration();
+    return true;
+}
+
+bool PurgeableDedupMem::BeforeWrite()
+{
+    if (region_ == nullptr) {
+        return true;
+    }
+    if (pinCount_ != 0) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: shared content is being read", __func__);
+        return false;
+    }
+    return Unshare();
+}
+
+bool PurgeableDedupMem::Unshare()
+{
+    void *sharedPtr = dataPtr_;
+    if (!CreatePrivateData()) {
+        dataPtr_ = sharedPtr;
+        return false;
+    }
+    /* a purged region is not rebuilt for the copy, the private content is built by own builders */
+    if (buildDataCount_ == 0 || !region_->CopyTo(dataPtr_)) {
+        buildDataCount_ = 0;
+    }
+    region_.reset();
+    PM_HILOG_DEBUG(LOG_CORE, "%{public}s: %{public}s", __func__, ToString().c_str());
+    return true;
+}
+
+bool PurgeableDedupMem::DropContent()
+{
+    return (region_ != nullptr) ? region_->Drop() : PurgeableMemBase::DropContent();
+}
+
+void PurgeableDedupMem::ResizeData(size_t newSize)
+{
+    if (newSize == 0 || newSize >= OHOS_MAXIMUM_PURGEABLE_MEMORY) {
+        PM_HILOG_DEBUG(LOG_CORE, "Failed to apply for memory");
+        return;
+    }
+    /* the content of the key has the old size, the resized obj never shares again */
+    if (region_ != nullptr) {
+        region_.reset();
+    } else if (dataPtr_ != nullptr && !backend_.Unmap(dataPtr_, PurgeableBuildHelper::RoundUpPage(dataSizeInput_))) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: munmap dataPtr fail", __func__);
+    }
+    dataPtr_ = nullptr;
+    dataSizeInput_ = newSize;
+    buildDataCount_ = 0;
+    BumpGeneration();
+    CreatePrivateData();
+}
+
+std::string PurgeableDedupMem::ToString() const
+{
+    std::string dataptrStr = dataPtr_ ? std::to_string((unsigned long long)dataPtr_) : "0";
+    return "dataAddr:" + dataptrStr + " dataSizeInput:" + std::to_string(dataSizeInput_) +
+        " shared:" + std::to_string(region_ != nullptr);
+}
+} /* namespace PurgeableMem */
+} /* namespace OHOS */
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "pm_log.h"
+
+#include "purgeable_file_builder.h"
+
+namespace OHOS {
+namespace PurgeableMem {
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "PurgeableMem: FileBuilder"
+
+FileRangeBuilder::FileRangeBuilder(int fd, uint64_t fileOffset) : fileOffset_(fileOffset)
+{
+    if (fd >= 0) {
+        fd_ = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    }
+    if (fd_ < 0) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: dup fd %{public}d fail, errno %{public}d", __func__, fd, errno);
+    }
+}
+
+FileRangeBuilder::FileRangeBuilder(const std::string &path, uint64_t fileOffset) : fileOffset_(fileOffset)
+{
+    fd_ = TEMP_FAILURE_RETRY(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd_ < 0) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: open fail, errno %{public}d", __func__, errno);
+    }
+}
+
+FileRangeBuilder::~FileRangeBuilder()
+{
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool FileRangeBuilder::IsValid() const
+{
+    return fd_ >= 0;
+}
+
+void FileRangeBuilder::SetTargetFd(int fd, const void *target)
+{
+    target_.store(fd < 0 ? nullptr : target, std::memory_order_relaxed);
+    targetFd_.store(fd, std::memory_order_relaxed);
+    copySupported_.store(true, std::memory_order_relaxed);
+}
+
+bool FileRangeBuilder::Build(void *data, size_t size)
+{
+    return BuildRange(data, size, 0, size);
+}
+
+bool FileRangeBuilder::BuildRange(void *data, size_t size, size_t offset, size_t len)
+{
+    if (fd_ < 0 || data == nullptr || offset > size || len > size - offset) {
+        return false;
+    }
+    /* only a hint, the read below still works if the kernel ignores it */
+    posix_fadvise(fd_, static_cast<off_t>(fileOffset_ + offset), static_cast<off_t>(len), POSIX_FADV_WILLNEED);
+    size_t copied = CopyRange(data, offset, len);
+    if (!ReadRange(static_cast<char *>(data) + offset + copied, offset + copied, len - copied)) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: read [%{public}zu, +%{public}zu) fail, errno %{public}d",
+            __func__, offset, len, errno);
+        return false;
+    }
+    return true;
+}
+
+/* Return:  bytes copied to the target fd, the caller reads the rest */
+size_t FileRangeBuilder::CopyRange(const void *data, size_t offset, size_t len)
+{
+    int targetFd = targetFd_.load(std::memory_order_relaxed);
+    if (targetFd < 0 || !copySupported_.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    /* copy only lands in @data if it maps the target fd, e.g. not a buffer of a snapshot load */
+    if (data != target_.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    loff_t inOff = static_cast<loff_t>(fileOffset_ + offset);
+    loff_t outOff = static_cast<loff_t>(offset);
+    size_t copied = 0;
+    while (copied < len) {
+        ssize_t n = TEMP_FAILURE_RETRY(copy_file_range(fd_, &inOff, targetFd, &outOff, len - copied, 0));
+        if (n < 0) {
+            /* e.g. EXDEV or EINVAL, the fds are on file systems that cannot copy to each other */
+            PM_HILOG_DEBUG(LOG_CORE, "%{public}s: unsupported, errno %{public}d, read instead", __func__, errno);
+            copySupported_.store(false, std::memory_order_relaxed);
+            break;
+        }
+        if (n == 0) {
+            break; /* end of file, reported by the read of the rest */
+        }
+        copied += static_cast<size_t>(n);
+    }
+    bytesRead_.fetch_add(copied, std::memory_order_relaxed);
+    return copied;
+}
+
+bool FileRangeBuilder::ReadRange(char *dst, size_t offset, size_t len)
+{
+    uint64_t fileOffset = fileOffset_ + offset;
+    while (len > 0) {
+        ssize_t n = TEMP_FAILURE_RETRY(pread(fd_, dst, len, static_cast<off_t>(fileOffset)));
+        if (n <= 0) {
+            return false;
+        }
+        bytesRead_.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+        dst += n;
+        len -= static_cast<size_t>(n);
+        fileOffset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+} /* namespace PurgeableMem */
+} /* namespace OHOS */
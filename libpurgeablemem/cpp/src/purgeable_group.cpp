@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <functional>
+
+#include "pm_log.h"
+
+#include "purgeable_group.h"
+
+namespace OHOS {
+namespace PurgeableMem {
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "PurgeableMem: Group"
+
+static constexpr int MAX_BUILD_TRYTIMES = 3;
+
+PurgeableGroup::~PurgeableGroup()
+{
+    EndAccess();
+}
+
+bool PurgeableGroup::Add(PurgeableMemBase *obj)
+{
+    if (obj == nullptr) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(groupLock_);
+    if (isAccessing_) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: group is being accessed", __func__);
+        return false;
+    }
+    auto it = std::lower_bound(members_.begin(), members_.end(), obj, std::less<PurgeableMemBase *>());
+    if (it != members_.end() && *it == obj) {
+        return false;
+    }
+    members_.insert(it, obj);
+    return true;
+}
+
+bool PurgeableGroup::Remove(PurgeableMemBase *obj)
+{
+    std::lock_guard<std::mutex> lock(groupLock_);
+    if (isAccessing_) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: group is being accessed", __func__);
+        return false;
+    }
+    auto it = std::lower_bound(members_.begin(), members_.end(), obj, std::less<PurgeableMemBase *>());
+    if (it == members_.end() || *it != obj) {
+        return false;
+    }
+    members_.erase(it);
+    return true;
+}
+
+size_t PurgeableGroup::GetSize()
+{
+    std::lock_guard<std::mutex> lock(groupLock_);
+    return members_.size();
+}
+
+bool PurgeableGroup::BeginRead()
+{
+    return BeginAccess(false);
+}
+
+bool PurgeableGroup::BeginWrite()
+{
+    return BeginAccess(true);
+}
+
+bool PurgeableGroup::BeginAccess(bool isWrite)
+{
+    std::lock_guard<std::mutex> groupLock(groupLock_);
+    if (isAccessing_) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: group is being accessed", __func__);
+        return false;
+    }
+    /* members are locked in address order, so groups sharing members never deadlock */
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(members_.size());
+    for (PurgeableMemBase *obj : members_) {
+        locks.emplace_back(obj->dataLock_);
+    }
+
+    /* pin all before rebuilding any, then no member is purged while another one is rebuilt */
+    size_t pinned = 0;
+    while (pinned < members_.size() && PinMember(members_[pinned], isWrite)) {
+        pinned++;
+    }
+    bool succ = (pinned == members_.size());
+    std::vector<bool> rebuilt(members_.size(), false);
+    for (size_t i = 0; succ && i < members_.size(); i++) {
+        bool memberRebuilt = false;
+        succ = RebuildMember(members_[i], memberRebuilt);
+        rebuilt[i] = memberRebuilt;
+    }
+
+    for (size_t i = 0; i < pinned; i++) {
+        if (succ) {
+            members_[i]->AfterBeginAccess();
+        } else {
+            members_[i]->Unpin();
+        }
+    }
+    locks.clear();
+    for (size_t i = 0; i < members_.size(); i++) {
+        if (rebuilt[i]) {
+            members_[i]->NotifyRebuildListeners();
+        }
+    }
+    if (!succ) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: fail, pinned %{public}zu of %{public}zu, rolled back",
+            __func__, pinned, members_.size());
+        return false;
+    }
+    isAccessing_ = true;
+    return true;
+}
+
+void PurgeableGroup::EndAccess()
+{
+    std::lock_guard<std::mutex> groupLock(groupLock_);
+    if (!isAccessing_) {
+        return;
+    }
+    for (PurgeableMemBase *obj : members_) {
+        UnpinMember(obj);
+    }
+    isAccessing_ = false;
+}
+
+bool PurgeableGroup::PinMember(PurgeableMemBase *obj, bool isWrite)
+{
+    /* the same checks as PurgeableMemBase::BeginRead() and BeginWrite() */
+    if (!obj->isDataValid_ || obj->dataPtr_ == nullptr || obj->builder_ == nullptr) {
+        return false;
+    }
+    /* copy on write before the pin, the shared content is never written through the group */
+    if (isWrite && !obj->BeforeWrite()) {
+        return false;
+    }
+    obj->Pin();
+    return true;
+}
+
+void PurgeableGroup::UnpinMember(PurgeableMemBase *obj)
+{
+    std::lock_guard<std::mutex> lock(obj->dataLock_);
+    obj->Unpin();
+    obj->AfterEndAccess();
+}
+
+bool PurgeableGroup::RebuildMember(PurgeableMemBase *obj, bool &rebuilt)
+{
+    for (int tryTimes = 0; obj->IfNeedRebuild(); tryTimes++) {
+        if (tryTimes >= MAX_BUILD_TRYTIMES || !obj->RebuildContent()) {
+            return false;
+        }
+        rebuilt = true;
+    }
+    return true;
+}
+} /* namespace PurgeableMem */
+} /* namespace OHOS */
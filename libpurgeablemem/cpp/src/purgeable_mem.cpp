@@ -46,7 +46,6 @@ PurgeableMem::PurgeableMem(size_t dataSize, std::unique_ptr<PurgeableMemBuilder>
 {
     dataPtr_ = nullptr;
     builder_ = nullptr;
-    pageTable_ = nullptr;
     buildDataCount_ = 0;
 
     if (dataSize <= 0 || dataSize >= OHOS_MAXIMUM_PURGEABLE_MEMORY) {
@@ -66,9 +65,10 @@ PurgeableMem::PurgeableMem(size_t dataSize, std::unique_ptr<PurgeableMemBuilder>
 
 PurgeableMem::~PurgeableMem()
 {
+    StopMonitor();
     PM_HILOG_DEBUG(LOG_CORE, "%{public}s %{public}s", __func__, ToString().c_str());
     if (dataPtr_) {
-        if (munmap(dataPtr_, RoundUp(dataSizeInput_, PAGE_SIZE)) != 0) {
+        if (!backend_.Unmap(dataPtr_, RoundUp(dataSizeInput_, PAGE_SIZE))) {
             PM_HILOG_ERROR(LOG_CORE, "%{public}s: munmap dataPtr fail", __func__);
         } else {
             if (UxpteIsEnabled() && !IsPurged()) {
@@ -78,50 +78,45 @@ PurgeableMem::~PurgeableMem()
         }
     }
     builder_.reset();
-    pageTable_.reset();
 }
 
 bool PurgeableMem::IsPurged()
 {
-    IF_NULL_LOG_ACTION(pageTable_, "pageTable_ is nullptrin BeginWrite", return false);
-    return !(pageTable_->CheckPresent((uint64_t)dataPtr_, dataSizeInput_));
+    return backend_.IsPurged(dataPtr_, dataSizeInput_);
 }
 
 bool PurgeableMem::CreatePurgeableData()
 {
     PM_HILOG_DEBUG(LOG_CORE, "%{public}s", __func__);
-    pageTable_ = nullptr;
-    size_t size = RoundUp(dataSizeInput_, PAGE_SIZE);
-    unsigned int utype = MAP_ANONYMOUS;
-    utype |= (UxpteIsEnabled() ? MAP_PURGEABLE : MAP_PRIVATE);
-    int type = static_cast<int>(utype);
-
-    dataPtr_ = mmap(nullptr, size, PROT_READ | PROT_WRITE, type, -1, 0);
-    if (dataPtr_ == MAP_FAILED) {
+    dataPtr_ = backend_.Map(RoundUp(dataSizeInput_, PAGE_SIZE));
+    if (dataPtr_ == nullptr) {
         PM_HILOG_ERROR(LOG_CORE, "%{public}s: mmap fail", __func__);
-        dataPtr_ = nullptr;
         return false;
     }
-    MAKE_UNIQUE(pageTable_, UxPageTable, "constructor uxpt make_unique fail", return false, (uint64_t)dataPtr_, size);
     return true;
 }
 
 bool PurgeableMem::Pin()
 {
-    IF_NULL_LOG_ACTION(pageTable_, "pageTable_ is nullptrin BeginWrite", return false);
-    pageTable_->GetUxpte((uint64_t)dataPtr_, dataSizeInput_);
+    if (!backend_.Pin(dataPtr_, dataSizeInput_)) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: uxpt is not created", __func__);
+        return false;
+    }
     return true;
 }
 
 bool PurgeableMem::Unpin()
 {
-    IF_NULL_LOG_ACTION(pageTable_, "pageTable_ is nullptrin BeginWrite", return false);
-    pageTable_->PutUxpte((uint64_t)dataPtr_, dataSizeInput_);
+    if (!backend_.Unpin(dataPtr_, dataSizeInput_)) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: uxpt is not created", __func__);
+        return false;
+    }
     return true;
 }
 
 void PurgeableMem::AfterRebuildSucc()
 {
+    backend_.AfterRebuildSucc();
 }
 
 int PurgeableMem::GetPinStatus() const
@@ -136,13 +131,14 @@ void PurgeableMem::ResizeData(size_t newSize)
         return;
     }
     if (dataPtr_) {
-        if (munmap(dataPtr_, RoundUp(dataSizeInput_, PAGE_SIZE)) != 0) {
+        if (!backend_.Unmap(dataPtr_, RoundUp(dataSizeInput_, PAGE_SIZE))) {
             PM_HILOG_ERROR(LOG_CORE, "%{public}s: munmap dataPtr fail", __func__);
         } else {
             dataPtr_ = nullptr;
         }
     }
     dataSizeInput_ = newSize;
+    BumpGeneration();
     if (!CreatePurgeableData()) {
         PM_HILOG_DEBUG(LOG_CORE, "Failed to create purgeabledata");
         return;
@@ -152,9 +148,8 @@ void PurgeableMem::ResizeData(size_t newSize)
 inline std::string PurgeableMem::ToString() const
 {
     std::string dataptrStr = dataPtr_ ? std::to_string((unsigned long long)dataPtr_) : "0";
-    std::string pageTableStr = pageTable_ ? pageTable_->ToString() : "0";
     return "dataAddr:" + dataptrStr + " dataSizeInput:" + std::to_string(dataSizeInput_) +
-        " " + pageTableStr;
+        " " + backend_.ToString();
 }
 } /* namespace PurgeableMem */
 } /* namespace OHOS */
@@ -13,6 +13,8 @@
  * limitations under the License.
  */
 
+#include <cerrno>
+#include <chrono>
 #include <sys/mman.h> /* mmap */
 
 #include "securec.h"
@@ -20,6 +22,9 @@
 #include "pm_state_c.h"
 #include "pm_smartptr_util.h"
 #include "pm_log.h"
+#include "purgeable_mem_monitor.h"
+#include "purgeable_snapshot.h"
+#include "purgeable_static_mem.h"
 
 #include "purgeable_mem_base.h"
 
@@ -49,16 +54,18 @@ PurgeableMemBase::PurgeableMemBase()
 
 PurgeableMemBase::~PurgeableMemBase()
 {
+    StopMonitor();
 }
 
 bool PurgeableMemBase::BeginRead()
 {
-    std::lock_guard<std::mutex> lock(dataLock_);
+    std::unique_lock<std::mutex> lock(dataLock_);
     if (!isDataValid_) {
         return false;
     }
 
     bool ret = false;
+    bool rebuilt = false;
     int tryTimes = 0;
 
     PM_HILOG_DEBUG(LOG_CORE, "%{public}s %{public}s", __func__, ToString().c_str());
@@ -74,10 +81,8 @@ bool PurgeableMemBase::BeginRead()
             break;
         }
 
-        bool succ = BuildContent();
-        if (succ) {
-            AfterRebuildSucc();
-        }
+        bool succ = RebuildContent();
+        rebuilt = rebuilt || succ;
         PM_HILOG_DEBUG(LOG_CORE, "%{public}s: purged, built %{public}s", __func__, succ ? "succ" : "fail");
 
         tryTimes++;
@@ -91,6 +96,12 @@ bool PurgeableMemBase::BeginRead()
         PM_HILOG_ERROR(LOG_CORE, "%{public}s: err %{public}s, UxptePut. tryTime:%{public}d",
             __func__, GetPMStateName(err), tryTimes);
         Unpin();
+    } else {
+        AfterBeginAccess();
+    }
+    lock.unlock();
+    if (ret && rebuilt) {
+        NotifyRebuildListeners();
     }
     return ret;
 }
@@ -101,6 +112,7 @@ void PurgeableMemBase::EndRead()
     if (isDataValid_) {
         Unpin();
     }
+    AfterEndAccess();
 
     return;
 }
@@ -108,8 +120,8 @@ void PurgeableMemBase::EndRead()
 bool PurgeableMemBase::BeginWrite()
 {
     PM_HILOG_DEBUG(LOG_CORE, "%{public}s %{public}s", __func__, ToString().c_str());
-    std::lock_guard<std::mutex> lock(dataLock_);
-    if (dataPtr_ == nullptr) {
+    std::unique_lock<std::mutex> lock(dataLock_);
+    if (dataPtr_ == nullptr || !BeforeWrite()) {
         return false;
     }
     IF_NULL_LOG_ACTION(dataPtr_, "dataPtr is nullptr in BeginWrite", return false);
@@ -117,21 +129,27 @@ bool PurgeableMemBase::BeginWrite()
 
     Pin();
     PMState err = PM_OK;
+    bool rebuilt = false;
     do {
         if (!IfNeedRebuild()) {
             /* data is not purged, return true */
             break;
         }
         /* data purged, rebuild it */
-        if (BuildContent()) {
+        if (RebuildContent()) {
             /* data rebuild succ, return true */
-            AfterRebuildSucc();
+            rebuilt = true;
             break;
         }
         err = PMB_BUILD_ALL_FAIL;
     } while (0);
 
     if (err == PM_OK) {
+        AfterBeginAccess();
+        lock.unlock();
+        if (rebuilt) {
+            NotifyRebuildListeners();
+        }
         return true;
     }
 
@@ -145,16 +163,23 @@ void PurgeableMemBase::EndWrite()
     std::lock_guard<std::mutex> lock(dataLock_);
     PM_HILOG_DEBUG(LOG_CORE, "%{public}s %{public}s", __func__, ToString().c_str());
     Unpin();
+    AfterEndAccess();
 }
 
 bool PurgeableMemBase::ModifyContentByBuilder(std::unique_ptr<PurgeableMemBuilder> modifier)
 {
     IF_NULL_LOG_ACTION(modifier, "input modifier is nullptr", return false);
     std::lock_guard<std::mutex> lock(dataLock_);
-    if (!modifier->Build(dataPtr_, dataSizeInput_)) {
+    if (dataPtr_ != nullptr && !BeforeWrite()) {
+        return false;
+    }
+    /* content of a purged or never built obj will be replayed from the log on next rebuild */
+    if (dataPtr_ != nullptr && !IfNeedRebuild() && !modifier->Build(dataPtr_, dataSizeInput_)) {
         PM_HILOG_ERROR(LOG_CORE, "%{public}s: modify content by builder fail!!", __func__);
         return false;
     }
+    /* the saved content does not include this modify */
+    snapshotEntry_ = nullptr;
     /* log modify */
     if (builder_) {
         builder_->AppendBuilder(std::move(modifier));
@@ -164,6 +189,75 @@ bool PurgeableMemBase::ModifyContentByBuilder(std::unique_ptr<PurgeableMemBuilde
     return true;
 }
 
+void PurgeableMemBase::AfterBeginAccess()
+{
+    pinCount_++;
+    if (!isMonitored_ && PurgeableMemMonitor::GetInstance().IsRunning()) {
+        isMonitored_ = PurgeableMemMonitor::GetInstance().Register(this);
+    }
+}
+
+void PurgeableMemBase::AfterEndAccess()
+{
+    if (pinCount_ > 0) {
+        pinCount_--;
+    }
+    lastAccessMs_ = NowMs();
+}
+
+void PurgeableMemBase::StopMonitor()
+{
+    /* must be called before content is unmapped, so the monitor never sheds a dying obj */
+    if (isMonitored_) {
+        PurgeableMemMonitor::GetInstance().Unregister(this);
+        isMonitored_ = false;
+    }
+}
+
+int64_t PurgeableMemBase::NowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool PurgeableMemBase::IsIdleSince(int64_t deadlineMs, int64_t &lastAccessMs, double &costNsPerByte)
+{
+    std::unique_lock<std::mutex> lock(dataLock_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return false;
+    }
+    lastAccessMs = lastAccessMs_;
+    costNsPerByte = GetRebuildCostNsPerByte();
+    return dataPtr_ != nullptr && pinCount_ == 0 && buildDataCount_ > 0 && lastAccessMs_ <= deadlineMs;
+}
+
+size_t PurgeableMemBase::PurgeIfIdle(int64_t deadlineMs)
+{
+    std::unique_lock<std::mutex> lock(dataLock_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return 0;
+    }
+    if (dataPtr_ == nullptr || pinCount_ != 0 || buildDataCount_ == 0 || lastAccessMs_ > deadlineMs) {
+        return 0;
+    }
+    if (!DropContent()) {
+        return 0;
+    }
+    /* force rebuild on next access */
+    buildDataCount_ = 0;
+    PM_HILOG_DEBUG(LOG_CORE, "%{public}s: purged %{public}zu bytes", __func__, dataSizeInput_);
+    return RoundUp(dataSizeInput_, PAGE_SIZE);
+}
+
+bool PurgeableMemBase::DropContent()
+{
+    if (madvise(dataPtr_, RoundUp(dataSizeInput_, PAGE_SIZE), MADV_DONTNEED) != 0) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: madvise fail, errno %{public}d", __func__, errno);
+        return false;
+    }
+    return true;
+}
+
 bool PurgeableMemBase::IfNeedRebuild()
 {
     if (buildDataCount_ == 0 || IsPurged()) {
@@ -176,6 +270,11 @@ void PurgeableMemBase::AfterRebuildSucc()
 {
 }
 
+bool PurgeableMemBase::BeforeWrite()
+{
+    return true;
+}
+
 void *PurgeableMemBase::GetContent()
 {
     std::lock_guard<std::mutex> lock(dataLock_);
@@ -195,20 +294,38 @@ bool PurgeableMemBase::IsPurged()
 
 bool PurgeableMemBase::BuildContent()
 {
-    bool succ = false;
-    /* clear content before rebuild */
-    if (memset_s(dataPtr_, RoundUp(dataSizeInput_, PAGE_SIZE), 0, dataSizeInput_) != EOK) {
-        PM_HILOG_ERROR(LOG_CORE, "%{public}s, clear content fail", __func__);
-        return succ;
-    }
     /* builder_ and dataPtr_ is never nullptr since it is checked by BeginAccess() before */
-    succ = builder_->BuildAll(dataPtr_, dataSizeInput_);
+    if (snapshotEntry_ != nullptr) {
+        /* first build after restart, the entry is used once, builders run if it mismatches */
+        std::shared_ptr<PurgeableSnapshotEntry> entry = std::move(snapshotEntry_);
+        snapshotEntry_ = nullptr;
+        if (entry->Restore(dataPtr_, dataSizeInput_)) {
+            buildDataCount_++;
+            return true;
+        }
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: snapshot mismatch, rebuild by builders", __func__);
+    }
+    auto start = std::chrono::steady_clock::now();
+    bool succ = PurgeableBuildHelper::Rebuild(dataPtr_, dataSizeInput_, *builder_);
     if (succ) {
         buildDataCount_++;
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        rebuildCostNsPerByte_.store(RollRebuildCost(GetRebuildCostNsPerByte(), ns / dataSizeInput_),
+            std::memory_order_relaxed);
     }
     return succ;
 }
 
+bool PurgeableMemBase::RebuildContent()
+{
+    if (!BuildContent()) {
+        return false;
+    }
+    AfterRebuildSucc();
+    BumpGeneration();
+    return true;
+}
+
 void PurgeableMemBase::ResizeData(size_t newSize)
 {
 }
@@ -241,6 +358,51 @@ void PurgeableMemBase::SetRebuildSuccessCallback(std::function<void()> &callback
     }
 }
 
+uint64_t PurgeableMemBase::GetGeneration() const
+{
+    return generation_.load(std::memory_order_acquire);
+}
+
+double PurgeableMemBase::GetRebuildCostNsPerByte() const
+{
+    return rebuildCostNsPerByte_.load(std::memory_order_relaxed);
+}
+
+void PurgeableMemBase::BumpGeneration()
+{
+    generation_.fetch_add(1, std::memory_order_release);
+}
+
+int PurgeableMemBase::AddRebuildListener(RebuildListener listener)
+{
+    IF_NULL_LOG_ACTION(listener, "input listener is empty", return -1);
+    std::lock_guard<std::mutex> lock(listenerLock_);
+    int id = nextListenerId_++;
+    listeners_.emplace_back(id, std::move(listener));
+    return id;
+}
+
+bool PurgeableMemBase::RemoveRebuildListener(int id)
+{
+    std::lock_guard<std::mutex> lock(listenerLock_);
+    for (auto it = listeners_.begin(); it != listeners_.end(); ++it) {
+        if (it->first == id) {
+            listeners_.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+void PurgeableMemBase::NotifyRebuildListeners()
+{
+    uint64_t generation = GetGeneration();
+    std::lock_guard<std::mutex> lock(listenerLock_);
+    for (auto &listener : listeners_) {
+        listener.second(generation);
+    }
+}
+
 bool PurgeableMemBase::IsDataValid()
 {
     std::lock_guard<std::mutex> lock(dataLock_);
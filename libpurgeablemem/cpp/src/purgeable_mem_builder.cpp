@@ -13,7 +13,10 @@
  * limitations under the License.
  */
 
+#include <chrono>
+
 #include "pm_smartptr_util.h"
+#include "purgeable_worker_pool.h"
 #include "purgeable_mem_builder.h"
 
 namespace OHOS {
@@ -40,9 +43,21 @@ void PurgeableMemBuilder::AppendBuilder(std::unique_ptr<PurgeableMemBuilder> bui
     }
 }
 
+bool PurgeableMemBuilder::BuildSplit(void *data, size_t size)
+{
+    return PurgeableWorkerPool::GetInstance().ParallelForRange(size, PARALLEL_BUILD_MIN_CHUNK,
+        [this, data, size](size_t offset, size_t len) { return BuildRange(data, size, offset, len); });
+}
+
 bool PurgeableMemBuilder::BuildAll(void *data, size_t size)
 {
-    if (!Build(data, size)) {
+    auto start = std::chrono::steady_clock::now();
+    bool succ = (IsSplittable() && size >= PARALLEL_BUILD_MIN_SIZE) ? BuildSplit(data, size) : Build(data, size);
+    if (succ && size > 0) {
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        costNsPerByte_.store(RollRebuildCost(GetCostNsPerByte(), ns / size), std::memory_order_relaxed);
+    }
+    if (!succ) {
         HILOG_ERROR(LOG_CORE, "%{public}s: build(0x%{public}llx, %{public}zu) fail",
             __func__, (unsigned long long)data, size);
         return false;
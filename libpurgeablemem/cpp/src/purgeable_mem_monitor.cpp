@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <tuple>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "pm_log.h"
+#include "purgeable_mem_base.h"
+
+#include "purgeable_mem_monitor.h"
+
+namespace OHOS {
+namespace PurgeableMem {
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "PurgeableMem: Monitor"
+
+static const char *PSI_MEMORY_PATH = "/proc/pressure/memory";
+static constexpr int PSI_TRIGGER_LEN = 64;
+static constexpr uint32_t US_PER_MS = 1000;
+
+PurgeableMemMonitor &PurgeableMemMonitor::GetInstance()
+{
+    static PurgeableMemMonitor instance;
+    return instance;
+}
+
+PurgeableMemMonitor::~PurgeableMemMonitor()
+{
+    Stop();
+}
+
+int PurgeableMemMonitor::OpenTrigger(const char *type, uint32_t stallUs)
+{
+    if (stallUs == 0) {
+        return -1;
+    }
+    int fd = open(PSI_MEMORY_PATH, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        PM_HILOG_ERROR(LOG_CORE, "open %{public}s fail, errno %{public}d", PSI_MEMORY_PATH, errno);
+        return -1;
+    }
+    char trigger[PSI_TRIGGER_LEN] = {0};
+    int len = snprintf(trigger, sizeof(trigger), "%s %u %u", type, stallUs, config_.windowUs);
+    if (len <= 0 || len >= PSI_TRIGGER_LEN) {
+        close(fd);
+        return -1;
+    }
+    /* kernel requires the trigger string to be nul terminated */
+    if (write(fd, trigger, static_cast<size_t>(len) + 1) < 0) {
+        PM_HILOG_ERROR(LOG_CORE, "write trigger [%{public}s] fail, errno %{public}d", trigger, errno);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void PurgeableMemMonitor::CloseTriggers()
+{
+    int *fds[] = { &someFd_, &fullFd_, &stopFd_ };
+    for (int *fd : fds) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+/* join the monitor thread, also when it quit by itself on a poll error, then close its fds */
+void PurgeableMemMonitor::JoinLoopLocked()
+{
+    if (!thread_.joinable()) {
+        return;
+    }
+    isRunning_.store(false);
+    uint64_t val = 1;
+    if (write(stopFd_, &val, sizeof(val)) < 0) {
+        PM_HILOG_ERROR(LOG_CORE, "wake monitor thread fail, errno %{public}d", errno);
+    }
+    thread_.join();
+    CloseTriggers();
+    graceMs_.store(config_.graceMs);
+}
+
+bool PurgeableMemMonitor::Start(const PurgeableMemMonitorConfig &config)
+{
+    std::lock_guard<std::mutex> lock(stateLock_);
+    if (isRunning_.load()) {
+        PM_HILOG_DEBUG(LOG_CORE, "monitor is already running");
+        return true;
+    }
+    JoinLoopLocked();
+    config_ = config;
+    someFd_ = OpenTrigger("some", config_.someStallUs);
+    fullFd_ = OpenTrigger("full", config_.fullStallUs);
+    if (someFd_ < 0 && fullFd_ < 0) {
+        PM_HILOG_ERROR(LOG_CORE, "no psi trigger registered, monitor not started");
+        CloseTriggers();
+        return false;
+    }
+    stopFd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (stopFd_ < 0) {
+        CloseTriggers();
+        return false;
+    }
+    graceMs_.store(config_.graceMs);
+    isRunning_.store(true);
+    try {
+        thread_ = std::thread(&PurgeableMemMonitor::MonitorLoop, this);
+    } catch (...) {
+        PM_HILOG_ERROR(LOG_CORE, "create monitor thread fail");
+        isRunning_.store(false);
+        CloseTriggers();
+        return false;
+    }
+    PM_HILOG_INFO(LOG_CORE, "monitor started, some %{public}u full %{public}u window %{public}u",
+        config_.someStallUs, config_.fullStallUs, config_.windowUs);
+    return true;
+}
+
+void PurgeableMemMonitor::Stop()
+{
+    std::lock_guard<std::mutex> lock(stateLock_);
+    JoinLoopLocked();
+}
+
+bool PurgeableMemMonitor::IsRunning() const
+{
+    return isRunning_.load(std::memory_order_relaxed);
+}
+
+uint32_t PurgeableMemMonitor::GetGraceOfLevel(PurgeablePressureLevel level) const
+{
+    switch (level) {
+        case PurgeablePressureLevel::FULL:
+            return config_.fullGraceMs;
+        case PurgeablePressureLevel::SOME:
+            return config_.someGraceMs;
+        default:
+            return config_.graceMs;
+    }
+}
+
+uint32_t PurgeableMemMonitor::GetGracePeriodMs() const
+{
+    return graceMs_.load();
+}
+
+void PurgeableMemMonitor::MonitorLoop()
+{
+    PurgeablePressureLevel level = PurgeablePressureLevel::NONE;
+    struct pollfd fds[] = {
+        { stopFd_, POLLIN, 0 },
+        { fullFd_, POLLPRI, 0 },
+        { someFd_, POLLPRI, 0 },
+    };
+    /* no event in a whole window means the pressure is relieved */
+    int timeoutMs = static_cast<int>(config_.windowUs / US_PER_MS);
+    while (isRunning_.load()) {
+        int ret = poll(fds, sizeof(fds) / sizeof(fds[0]), level == PurgeablePressureLevel::NONE ? -1 : timeoutMs);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            PM_HILOG_ERROR(LOG_CORE, "poll fail, errno %{public}d", errno);
+            break;
+        }
+        if (fds[0].revents != 0) {
+            break;
+        }
+        if ((fds[1].revents | fds[2].revents) & (POLLERR | POLLNVAL)) {
+            PM_HILOG_ERROR(LOG_CORE, "psi trigger is gone, monitor quit");
+            break;
+        }
+        PurgeablePressureLevel newLevel = PurgeablePressureLevel::NONE;
+        if (fds[1].revents & POLLPRI) {
+            newLevel = PurgeablePressureLevel::FULL;
+        } else if (fds[2].revents & POLLPRI) {
+            newLevel = PurgeablePressureLevel::SOME;
+        }
+        if (newLevel == PurgeablePressureLevel::NONE && level == PurgeablePressureLevel::NONE) {
+            continue;
+        }
+        level = newLevel;
+        graceMs_.store(GetGraceOfLevel(level));
+        size_t shed = (level == PurgeablePressureLevel::NONE) ? 0 : Shed(level);
+        PM_HILOG_INFO(LOG_CORE, "pressure level %{public}d, shed %{public}zu bytes", static_cast<int>(level), shed);
+        NotifyCallbacks(level);
+    }
+    isRunning_.store(false);
+}
+
+bool PurgeableMemMonitor::Register(PurgeableMemBase *obj)
+{
+    if (obj == nullptr) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(objsLock_);
+    try {
+        objs_.insert(obj);
+    } catch (...) {
+        return false;
+    }
+    return true;
+}
+
+void PurgeableMemMonitor::Unregister(PurgeableMemBase *obj)
+{
+    /* waits for Shed(), which holds objsLock_ while touching objs */
+    std::lock_guard<std::mutex> lock(objsLock_);
+    objs_.erase(obj);
+}
+
+size_t PurgeableMemMonitor::Shed(PurgeablePressureLevel level)
+{
+    int64_t deadline = PurgeableMemBase::NowMs() - static_cast<int64_t>(GetGraceOfLevel(level));
+    size_t shedBytes = 0;
+    std::lock_guard<std::mutex> lock(objsLock_);
+    /*
+     * sort key is (cost unmeasured, rebuild cost, last access), the cost is unknown rather than free
+     * when it was never measured, so those are shed after the measured ones, coldest first.
+     * Cost is ignored when sorting coldest first.
+     */
+    std::vector<std::tuple<bool, double, int64_t, PurgeableMemBase *>> candidates;
+    bool byCost = (config_.shedOrder == PurgeableShedOrder::CHEAPEST_FIRST);
+    for (PurgeableMemBase *obj : objs_) {
+        int64_t lastAccess = 0;
+        double cost = 0;
+        if (obj->IsIdleSince(deadline, lastAccess, cost)) {
+            candidates.emplace_back(byCost && cost == 0, byCost ? cost : 0, lastAccess, obj);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    for (auto &candidate : candidates) {
+        if (config_.maxShedBytes != 0 && shedBytes >= config_.maxShedBytes) {
+            break;
+        }
+        shedBytes += std::get<3>(candidate)->PurgeIfIdle(deadline);
+    }
+    return shedBytes;
+}
+
+int PurgeableMemMonitor::RegisterPressureCallback(const PurgeablePressureCallback &callback)
+{
+    if (!callback) {
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(callbackLock_);
+    int id = nextCallbackId_++;
+    callbacks_[id] = callback;
+    return id;
+}
+
+void PurgeableMemMonitor::UnregisterPressureCallback(int id)
+{
+    std::lock_guard<std::mutex> lock(callbackLock_);
+    callbacks_.erase(id);
+}
+
+void PurgeableMemMonitor::NotifyCallbacks(PurgeablePressureLevel level)
+{
+    std::map<int, PurgeablePressureCallback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(callbackLock_);
+        callbacks = callbacks_;
+    }
+    for (auto &item : callbacks) {
+        item.second(level);
+    }
+}
+} /* namespace PurgeableMem */
+} /* namespace OHOS */
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "pm_util.h"
+#include "pm_log.h"
+
+#include "purgeable_shared_ctrl.h"
+
+namespace OHOS {
+namespace PurgeableMem {
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "PurgeableMem: SharedCtrl"
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared ctrl block needs address free atomics");
+static_assert(sizeof(PurgeableSharedCtrlBlock) <= PAGE_SIZE, "shared ctrl block exceeds its page");
+
+static constexpr uint32_t CTRL_MAGIC = 0x50524243; /* "PRBC" */
+/* a waiter wakes up this often to check whether the rebuilder process is still alive */
+static constexpr long WAIT_TIMEOUT_NS = 100 * 1000 * 1000;
+
+static long Futex(std::atomic<uint32_t> *addr, int op, uint32_t val, const struct timespec *timeout)
+{
+    /* not FUTEX_PRIVATE_FLAG, the word is shared between processes */
+    return syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), op, val, timeout, nullptr, 0);
+}
+
+PurgeableSharedCtrl::~PurgeableSharedCtrl()
+{
+    Detach();
+}
+
+size_t PurgeableSharedCtrl::GetCtrlSize()
+{
+    return PAGE_SIZE;
+}
+
+bool PurgeableSharedCtrl::Attach(int fd, size_t offset, bool create)
+{
+    Detach();
+    void *addr = mmap(nullptr, GetCtrlSize(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, static_cast<off_t>(offset));
+    if (addr == MAP_FAILED) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: mmap fd %{public}d fail, errno %{public}d", __func__, fd, errno);
+        return false;
+    }
+    block_ = reinterpret_cast<PurgeableSharedCtrlBlock *>(addr);
+    /* the creator initializes its zeroed page, zero is a valid initial state of all fields */
+    uint32_t magic = 0;
+    if (create) {
+        block_->magic.compare_exchange_strong(magic, CTRL_MAGIC);
+    } else {
+        magic = block_->magic.load();
+    }
+    if (magic != 0 && magic != CTRL_MAGIC) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: bad magic 0x%{public}x", __func__, magic);
+        Detach();
+        return false;
+    }
+    if (!create && magic != CTRL_MAGIC) {
+        PM_HILOG_DEBUG(LOG_CORE, "%{public}s: no control block in fd %{public}d", __func__, fd);
+        Detach();
+        return false;
+    }
+    return true;
+}
+
+void PurgeableSharedCtrl::Detach()
+{
+    if (block_ == nullptr) {
+        return;
+    }
+    if (munmap(block_, GetCtrlSize()) != 0) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: munmap fail, errno %{public}d", __func__, errno);
+    }
+    block_ = nullptr;
+}
+
+bool PurgeableSharedCtrl::IsAttached() const
+{
+    return block_ != nullptr;
+}
+
+bool PurgeableSharedCtrl::IsRebuilding() const
+{
+    return block_ != nullptr && block_->state.load(std::memory_order_acquire) != REBUILD_IDLE;
+}
+
+uint32_t PurgeableSharedCtrl::GetGeneration() const
+{
+    return block_ == nullptr ? 0 : block_->generation.load(std::memory_order_acquire);
+}
+
+bool PurgeableSharedCtrl::BeginRebuild()
+{
+    if (block_ == nullptr) {
+        return true;
+    }
+    uint32_t self = static_cast<uint32_t>(getpid());
+    while (true) {
+        uint32_t state = REBUILD_IDLE;
+        if (block_->state.compare_exchange_strong(state, self)) {
+            return true;
+        }
+        if ((state & REBUILD_WAITED) == 0 &&
+            !block_->state.compare_exchange_strong(state, state | REBUILD_WAITED)) {
+            continue; /* state changed under us, retry */
+        }
+        state |= REBUILD_WAITED;
+        WaitRebuild(state);
+        if (block_->state.load() == REBUILD_IDLE) {
+            return false;
+        }
+        TakeOverIfRebuilderDied(state);
+    }
+}
+
+void PurgeableSharedCtrl::EndRebuild(bool succ)
+{
+    if (block_ == nullptr) {
+        return;
+    }
+    if (succ) {
+        block_->generation.fetch_add(1, std::memory_order_release);
+    }
+    if ((block_->state.exchange(REBUILD_IDLE) & REBUILD_WAITED) != 0) {
+        Futex(&block_->state, FUTEX_WAKE, INT_MAX, nullptr);
+    }
+}
+
+void PurgeableSharedCtrl::Pin()
+{
+    if (block_ == nullptr) {
+        return;
+    }
+    uint32_t pins = block_->pins.load();
+    while (true) {
+        if ((pins & PIN_DROPPING) != 0) {
+            WaitDrop(pins);
+            pins = block_->pins.load();
+            continue;
+        }
+        if (block_->pins.compare_exchange_weak(pins, pins + 1)) {
+            return;
+        }
+    }
+}
+
+void PurgeableSharedCtrl::Unpin()
+{
+    if (block_ == nullptr) {
+        return;
+    }
+    block_->pins.fetch_sub(1);
+}
+
+bool PurgeableSharedCtrl::TryBeginDrop()
+{
+    if (block_ == nullptr) {
+        return true;
+    }
+    uint32_t pins = 0;
+    return block_->pins.compare_exchange_strong(pins, PIN_DROPPING | static_cast<uint32_t>(getpid()));
+}
+
+void PurgeableSharedCtrl::EndDrop()
+{
+    if (block_ == nullptr) {
+        return;
+    }
+    block_->pins.store(0);
+    Futex(&block_->pins, FUTEX_WAKE, INT_MAX, nullptr);
+}
+
+void PurgeableSharedCtrl::WaitDrop(uint32_t pins)
+{
+    struct timespec timeout = { 0, WAIT_TIMEOUT_NS };
+    Futex(&block_->pins, FUTEX_WAIT, pins, &timeout);
+    pid_t pid = static_cast<pid_t>(pins & ~PIN_DROPPING);
+    if (block_->pins.load() != pins || kill(pid, 0) == 0 || errno != ESRCH) {
+        return;
+    }
+    /* the dropper died while punching, nothing is pinned, so unblock the pins */
+    if (block_->pins.compare_exchange_strong(pins, 0)) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: dropper %{public}d died, reset pins", __func__, pid);
+        Futex(&block_->pins, FUTEX_WAKE, INT_MAX, nullptr);
+    }
+}
+
+void PurgeableSharedCtrl::WaitRebuild(uint32_t state)
+{
+    /* returns on wake up, timeout, or at once if the state is no longer @state */
+    struct timespec timeout = { 0, WAIT_TIMEOUT_NS };
+    Futex(&block_->state, FUTEX_WAIT, state, &timeout);
+}
+
+void PurgeableSharedCtrl::TakeOverIfRebuilderDied(uint32_t state)
+{
+    pid_t pid = static_cast<pid_t>(state & ~REBUILD_WAITED);
+    if (pid <= 0 || kill(pid, 0) == 0 || errno != ESRCH) {
+        return;
+    }
+    /* only one waiter resets the state, the others see it changed */
+    if (!block_->state.compare_exchange_strong(state, REBUILD_IDLE)) {
+        return;
+    }
+    PM_HILOG_ERROR(LOG_CORE, "%{public}s: rebuilder %{public}d died, reset state", __func__, pid);
+    Futex(&block_->state, FUTEX_WAKE, INT_MAX, nullptr);
+}
+} /* namespace PurgeableMem */
+} /* namespace OHOS */
@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cerrno>
+#include <cstddef> /* offsetof */
+#include <cstdio> /* rename */
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "securec.h"
+#include "pm_util.h"
+#include "pm_log.h"
+
+#include "purgeable_snapshot.h"
+
+namespace OHOS {
+namespace PurgeableMem {
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "PurgeableMem: Snapshot"
+
+namespace {
+constexpr uint32_t SNAPSHOT_MAGIC = 0x53534d50; /* "PMSS" */
+constexpr uint32_t SNAPSHOT_FORMAT_VERSION = 1;
+constexpr uint32_t MAX_KEY_LEN = 4096;
+constexpr uint64_t MAX_TABLE_SIZE = 16 * 1024 * 1024;
+
+struct SnapshotHeader {
+    uint32_t magic;
+    uint32_t formatVersion;
+    uint32_t version;
+    uint32_t entryCount;
+    uint64_t tableSize;
+    uint32_t tableCrc;
+    uint32_t headerCrc; /* of the fields above */
+};
+
+/* an entry of the table, followed by keyLen bytes of key */
+struct SnapshotEntryHeader {
+    uint64_t offset;
+    uint64_t size;
+    uint32_t crc;
+    uint32_t keyLen;
+};
+
+uint32_t Crc32(uint32_t crc, const void *data, size_t len)
+{
+    static const std::vector<uint32_t> table = [] {
+        constexpr uint32_t poly = 0xedb88320;
+        constexpr int bitsPerByte = 8;
+        std::vector<uint32_t> t(256); /* one for each byte value */
+        for (uint32_t i = 0; i < t.size(); i++) {
+            uint32_t c = i;
+            for (int k = 0; k < bitsPerByte; k++) {
+                c = (c & 1) ? (poly ^ (c >> 1)) : (c >> 1);
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8); /* 8: bits per byte */
+    }
+    return ~crc;
+}
+
+uint32_t HeaderCrc(const SnapshotHeader &header)
+{
+    return Crc32(0, &header, offsetof(SnapshotHeader, headerCrc));
+}
+
+uint64_t RoundUpPage(uint64_t val)
+{
+    return ((val + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+}
+
+bool PreadAll(int fd, void *buf, size_t len, uint64_t offset)
+{
+    char *p = static_cast<char *>(buf);
+    while (len > 0) {
+        ssize_t n = TEMP_FAILURE_RETRY(pread(fd, p, len, static_cast<off_t>(offset)));
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+bool PwriteAll(int fd, const void *buf, size_t len, uint64_t offset)
+{
+    const char *p = static_cast<const char *>(buf);
+    while (len > 0) {
+        ssize_t n = TEMP_FAILURE_RETRY(pwrite(fd, p, len, static_cast<off_t>(offset)));
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+} /* namespace */
+
+PurgeableSnapshotEntry::PurgeableSnapshotEntry(std::shared_ptr<int> fd, uint64_t offset, uint64_t size, uint32_t crc)
+    : fd_(std::move(fd)), offset_(offset), size_(size), crc_(crc)
+{
+}
+
+bool PurgeableSnapshotEntry::Restore(void *data, size_t size) const
+{
+    if (size != size_ || !PreadAll(*fd_, data, size, offset_)) {
+        return false;
+    }
+    return Crc32(0, data, size) == crc_;
+}
+
+PurgeableSnapshot::PurgeableSnapshot(const std::string &path, uint32_t version) : path_(path), version_(version)
+{
+}
+
+bool PurgeableSnapshot::Add(const std::string &key, PurgeableMemBase *obj)
+{
+    if (obj == nullptr || key.empty() || key.size() > MAX_KEY_LEN) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(lock_);
+    return objs_.emplace(key, obj).second;
+}
+
+bool PurgeableSnapshot::Remove(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    return objs_.erase(key) != 0;
+}
+
+int PurgeableSnapshot::Save()
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    std::string tmpPath = path_ + ".tmp";
+    int saved = 0;
+    if (!WriteFile(tmpPath, saved)) {
+        unlink(tmpPath.c_str());
+        return -1;
+    }
+    if (rename(tmpPath.c_str(), path_.c_str()) != 0) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: rename fail, errno %{public}d", __func__, errno);
+        unlink(tmpPath.c_str());
+        return -1;
+    }
+    return saved;
+}
+
+bool PurgeableSnapshot::WriteFile(const std::string &tmpPath, int &saved)
+{
+    int fd = TEMP_FAILURE_RETRY(open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR));
+    if (fd < 0) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: open fail, errno %{public}d", __func__, errno);
+        return false;
+    }
+    /* contents start after the largest possible table, so they are written before the table */
+    uint64_t maxTableSize = 0;
+    for (auto &item : objs_) {
+        maxTableSize += sizeof(SnapshotEntryHeader) + item.first.size();
+    }
+    uint64_t offset = RoundUpPage(sizeof(SnapshotHeader) + maxTableSize);
+    std::vector<uint8_t> table;
+    bool succ = true;
+    for (auto &item : objs_) {
+        PurgeableMemBase *obj = item.second;
+        std::lock_guard<std::mutex> objLock(obj->dataLock_);
+        if (obj->dataPtr_ == nullptr) {
+            continue;
+        }
+        /* pin before the purge check, as BeginRead, so the content is not purged while written */
+        obj->Pin();
+        if (obj->IfNeedRebuild()) {
+            obj->Unpin();
+            continue; /* nothing to save, and not worth a rebuild */
+        }
+        uint64_t size = obj->dataSizeInput_;
+        SnapshotEntryHeader entry = { offset, size, Crc32(0, obj->dataPtr_, size),
+            static_cast<uint32_t>(item.first.size()) };
+        succ = PwriteAll(fd, obj->dataPtr_, size, offset);
+        obj->Unpin();
+        if (!succ) {
+            break;
+        }
+        const uint8_t *entryBytes = reinterpret_cast<const uint8_t *>(&entry);
+        table.insert(table.end(), entryBytes, entryBytes + sizeof(entry));
+        table.insert(table.end(), item.first.begin(), item.first.end());
+        offset = RoundUpPage(offset + size);
+        saved++;
+    }
+    SnapshotHeader header = { SNAPSHOT_MAGIC, SNAPSHOT_FORMAT_VERSION, version_, static_cast<uint32_t>(saved),
+        table.size(), Crc32(0, table.data(), table.size()), 0 };
+    header.headerCrc = HeaderCrc(header);
+    succ = succ && PwriteAll(fd, table.data(), table.size(), sizeof(header)) &&
+        PwriteAll(fd, &header, sizeof(header), 0) && fsync(fd) == 0;
+    if (!succ) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: write fail, errno %{public}d", __func__, errno);
+    }
+    close(fd);
+    return succ;
+}
+
+int PurgeableSnapshot::Load()
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    int fd = TEMP_FAILURE_RETRY(open(path_.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd < 0) {
+        return -1;
+    }
+    std::shared_ptr<int> sharedFd(new int(fd), [](int *p) {
+        close(*p);
+        delete p;
+    });
+    struct stat st;
+    SnapshotHeader header;
+    if (fstat(fd, &st) != 0 || !PreadAll(fd, &header, sizeof(header), 0) || header.magic != SNAPSHOT_MAGIC ||
+        header.formatVersion != SNAPSHOT_FORMAT_VERSION || header.headerCrc != HeaderCrc(header)) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: bad header", __func__);
+        return -1;
+    }
+    uint64_t fileSize = static_cast<uint64_t>(st.st_size);
+    if (header.version != version_) {
+        return -1;
+    }
+    if (header.tableSize > MAX_TABLE_SIZE || sizeof(header) + header.tableSize > fileSize) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: bad table size", __func__);
+        return -1;
+    }
+    std::vector<uint8_t> table(header.tableSize);
+    if (!PreadAll(fd, table.data(), table.size(), sizeof(header)) ||
+        Crc32(0, table.data(), table.size()) != header.tableCrc) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: bad table", __func__);
+        return -1;
+    }
+
+    int attached = 0;
+    size_t pos = 0;
+    for (uint32_t i = 0; i < header.entryCount; i++) {
+        SnapshotEntryHeader entry;
+        if (table.size() - pos < sizeof(entry) ||
+            memcpy_s(&entry, sizeof(entry), table.data() + pos, sizeof(entry)) != EOK) {
+            break;
+        }
+        pos += sizeof(entry);
+        if (entry.keyLen > table.size() - pos || entry.offset > fileSize || entry.size > fileSize - entry.offset) {
+            break;
+        }
+        std::string key(reinterpret_cast<const char *>(table.data() + pos), entry.keyLen);
+        pos += entry.keyLen;
+        auto it = objs_.find(key);
+        if (it == objs_.end()) {
+            continue;
+        }
+        PurgeableMemBase *obj = it->second;
+        std::lock_guard<std::mutex> objLock(obj->dataLock_);
+        if (obj->buildDataCount_ != 0 || obj->dataSizeInput_ != entry.size) {
+            continue;
+        }
+        obj->snapshotEntry_ = std::make_shared<PurgeableSnapshotEntry>(sharedFd, entry.offset, entry.size, entry.crc);
+        attached++;
+    }
+    return attached;
+}
+} /* namespace PurgeableMem */
+} /* namespace OHOS */
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "securec.h"
+#include "pm_util.h"
+#include "pm_log.h"
+#include "pm_trace_c.h"
+#include "purgeable_worker_pool.h"
+
+#include "purgeable_static_mem.h"
+
+namespace OHOS {
+namespace PurgeableMem {
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "PurgeableMem"
+
+size_t PurgeableBuildHelper::RoundUpPage(size_t size)
+{
+    if (size + PAGE_SIZE < size) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: Addition overflow!", __func__);
+        return size;
+    }
+    return ((size + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+}
+
+bool PurgeableBuildHelper::Clear(void *data, size_t size)
+{
+    if (size < PARALLEL_BUILD_MIN_SIZE) {
+        return memset_s(data, RoundUpPage(size), 0, size) == EOK;
+    }
+    /* clear large content in page aligned chunks on the worker pool */
+    return PurgeableWorkerPool::GetInstance().ParallelForRange(size, PARALLEL_BUILD_MIN_CHUNK,
+        [data](size_t offset, size_t len) {
+            return memset_s(static_cast<char *>(data) + offset, len, 0, len) == EOK;
+        });
+}
+
+bool PurgeableBuildHelper::Rebuild(void *data, size_t size, PurgeableMemBuilder &builder)
+{
+    uint64_t objId = reinterpret_cast<uint64_t>(data);
+    uint32_t pageCount = static_cast<uint32_t>(RoundUpPage(size) / PAGE_SIZE);
+    PmTraceRecord(PM_TRACE_REBUILD_BEGIN, objId, pageCount);
+    /* clear content before rebuild */
+    bool succ = Clear(data, size);
+    if (!succ) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s, clear content fail", __func__);
+    } else {
+        succ = builder.BuildAll(data, size);
+    }
+    PmTraceRecord(PM_TRACE_REBUILD_END, objId, succ ? pageCount : 0);
+    return succ;
+}
+
+void PurgeableBuildHelper::Append(PurgeableMemBuilder &builder, std::unique_ptr<PurgeableMemBuilder> modifier)
+{
+    builder.AppendBuilder(std::move(modifier));
+}
+} /* namespace PurgeableMem */
+} /* namespace OHOS */
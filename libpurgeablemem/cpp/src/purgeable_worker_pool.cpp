@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <memory>
+
+#include "pm_log.h"
+#include "pm_util.h"
+
+#include "purgeable_worker_pool.h"
+
+namespace OHOS {
+namespace PurgeableMem {
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "PurgeableMem: WorkerPool"
+
+static constexpr size_t MAX_WORKER_NUM = 8;
+
+namespace {
+struct ParallelJob {
+    const std::function<bool(size_t)> *task = nullptr;
+    size_t count = 0;
+    std::atomic<size_t> next {0};
+    std::atomic<bool> succ {true};
+    size_t finished = 0;
+    std::mutex lock;
+    std::condition_variable cond;
+
+    /* grab and run tasks until none is left */
+    void Run()
+    {
+        size_t done = 0;
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            if (!(*task)(i)) {
+                succ.store(false);
+            }
+            done++;
+        }
+        if (done == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        finished += done;
+        if (finished == count) {
+            cond.notify_all();
+        }
+    }
+};
+} /* namespace */
+
+PurgeableWorkerPool &PurgeableWorkerPool::GetInstance()
+{
+    static PurgeableWorkerPool instance;
+    return instance;
+}
+
+PurgeableWorkerPool::~PurgeableWorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        isStopped_ = true;
+    }
+    cond_.notify_all();
+    for (auto &worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void PurgeableWorkerPool::StartWorkers()
+{
+    /* called with lock_ held */
+    if (isStarted_) {
+        return;
+    }
+    isStarted_ = true;
+    size_t cpuNum = std::thread::hardware_concurrency();
+    size_t workerNum = cpuNum > 1 ? cpuNum - 1 : 0;
+    if (workerNum > MAX_WORKER_NUM) {
+        workerNum = MAX_WORKER_NUM;
+    }
+    for (size_t i = 0; i < workerNum; i++) {
+        try {
+            workers_.emplace_back(&PurgeableWorkerPool::WorkerLoop, this);
+        } catch (...) {
+            PM_HILOG_ERROR(LOG_CORE, "create worker fail, %{public}zu workers", workers_.size());
+            break;
+        }
+    }
+}
+
+size_t PurgeableWorkerPool::GetConcurrency()
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    StartWorkers();
+    return workers_.size() + 1;
+}
+
+void PurgeableWorkerPool::WorkerLoop()
+{
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(lock_);
+            cond_.wait(lock, [this] { return isStopped_ || !jobs_.empty(); });
+            if (isStopped_) {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        job();
+    }
+}
+
+bool PurgeableWorkerPool::ParallelFor(size_t count, const std::function<bool(size_t)> &task)
+{
+    if (count == 0) {
+        return true;
+    }
+    std::shared_ptr<ParallelJob> job = nullptr;
+    try {
+        job = std::make_shared<ParallelJob>();
+    } catch (...) {
+        PM_HILOG_ERROR(LOG_CORE, "%{public}s: make job fail", __func__);
+        return false;
+    }
+    job->task = &task;
+    job->count = count;
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        StartWorkers();
+        size_t helperNum = workers_.size() < count - 1 ? workers_.size() : count - 1;
+        for (size_t i = 0; i < helperNum; i++) {
+            /* a helper started after all tasks are taken returns at once, @job keeps alive for it */
+            jobs_.emplace_back([job] { job->Run(); });
+        }
+    }
+    cond_.notify_all();
+    job->Run();
+
+    std::unique_lock<std::mutex> lock(job->lock);
+    job->cond.wait(lock, [&job] { return job->finished == job->count; });
+    return job->succ.load();
+}
+
+bool PurgeableWorkerPool::ParallelForRange(size_t size, size_t minChunk,
+    const std::function<bool(size_t, size_t)> &task)
+{
+    size_t chunk = size / GetConcurrency();
+    if (chunk < minChunk) {
+        chunk = minChunk;
+    }
+    chunk = ((chunk + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+    if (chunk == 0) {
+        return task(0, size);
+    }
+    size_t count = (size + chunk - 1) / chunk;
+    return ParallelFor(count, [&task, size, chunk](size_t i) {
+        size_t offset = i * chunk;
+        size_t len = (size - offset < chunk) ? (size - offset) : chunk;
+        return task(offset, len);
+    });
+}
+} /* namespace PurgeableMem */
+} /* namespace OHOS */
@@ -53,22 +53,6 @@ UxPageTable::~UxPageTable()
     }
 }
 
-void UxPageTable::GetUxpte(uint64_t addr, size_t len)
-{
-    UxpteGet(uxpt_, addr, len);
-}
-
-void UxPageTable::PutUxpte(uint64_t addr, size_t len)
-{
-    UxptePut(uxpt_, addr, len);
-}
-
-
-bool UxPageTable::CheckPresent(uint64_t addr, size_t len)
-{
-    return UxpteIsPresent(uxpt_, addr, len);
-}
-
 std::string UxPageTable::ToString() const
 {
     std::string uxptStr = uxpt_ ? std::to_string((unsigned long long)uxpt_) : "0";
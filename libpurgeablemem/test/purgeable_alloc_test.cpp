@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#include "gtest/gtest.h"
+#include "purgeable_ashmem.h"
+#include "purgeable_mem.h"
+
+/*
+ * Interposed allocator: count heap allocations made by the current thread while counting is on,
+ * so that the Begin/End access path can be checked to never allocate.
+ */
+static thread_local bool g_countAlloc = false;
+static thread_local size_t g_allocCount = 0;
+
+static void *CountedAlloc(size_t size)
+{
+    if (g_countAlloc) {
+        g_allocCount++;
+    }
+    void *ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void *operator new(size_t size)
+{
+    return CountedAlloc(size);
+}
+
+void *operator new[](size_t size)
+{
+    return CountedAlloc(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    if (g_countAlloc) {
+        g_allocCount++;
+    }
+    return malloc(size == 0 ? 1 : size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+namespace OHOS {
+namespace PurgeableMem {
+using namespace testing;
+using namespace testing::ext;
+
+static constexpr int ACCESS_LOOP_TIMES = 1000;
+
+class TestFillBuilder : public PurgeableMemBuilder {
+public:
+    bool Build(void *data, size_t size)
+    {
+        return memset(data, 'A', size) != nullptr;
+    }
+};
+
+class PurgeableAllocTest : public testing::Test {
+public:
+    static void SetUpTestCase();
+    static void TearDownTestCase();
+    void SetUp();
+    void TearDown();
+};
+
+void PurgeableAllocTest::SetUpTestCase()
+{
+}
+
+void PurgeableAllocTest::TearDownTestCase()
+{
+}
+
+void PurgeableAllocTest::SetUp()
+{
+    g_countAlloc = false;
+    g_allocCount = 0;
+}
+
+void PurgeableAllocTest::TearDown()
+{
+    g_countAlloc = false;
+}
+
+/* @accessed: accesses begun successfully after the warm up, the allocations of failed ones prove nothing */
+static size_t CountAccessAlloc(PurgeableMemBase &pobj, int &accessed)
+{
+    /* warm up: first access builds the content */
+    accessed = 0;
+    if (!pobj.BeginRead()) {
+        return 0;
+    }
+    pobj.EndRead();
+    g_allocCount = 0;
+    g_countAlloc = true;
+    for (int i = 0; i < ACCESS_LOOP_TIMES; i++) {
+        if (pobj.BeginRead()) {
+            pobj.EndRead();
+            accessed++;
+        }
+        if (pobj.BeginWrite()) {
+            pobj.EndWrite();
+            accessed++;
+        }
+    }
+    g_countAlloc = false;
+    return g_allocCount;
+}
+
+HWTEST_F(PurgeableAllocTest, InterposedAllocatorTest, TestSize.Level1)
+{
+    g_countAlloc = true;
+    std::unique_ptr<int> ptr = std::make_unique<int>(1);
+    g_countAlloc = false;
+    EXPECT_EQ(g_allocCount, 1);
+}
+
+HWTEST_F(PurgeableAllocTest, PurgeableMemAccessNoAllocTest, TestSize.Level1)
+{
+    PurgeableMem pobj(4096 * 3, std::make_unique<TestFillBuilder>());
+    int accessed = 0;
+    size_t allocCount = CountAccessAlloc(pobj, accessed);
+    ASSERT_EQ(accessed, ACCESS_LOOP_TIMES * 2);
+    EXPECT_EQ(allocCount, 0);
+}
+
+HWTEST_F(PurgeableAllocTest, PurgeableAshMemAccessNoAllocTest, TestSize.Level1)
+{
+    PurgeableAshMem pobj(4096 * 3, std::make_unique<TestFillBuilder>());
+    int accessed = 0;
+    size_t allocCount = CountAccessAlloc(pobj, accessed);
+    ASSERT_EQ(accessed, ACCESS_LOOP_TIMES * 2);
+    EXPECT_EQ(allocCount, 0);
+}
+} /* namespace PurgeableMem */
+} /* namespace OHOS */
@@ -13,12 +13,22 @@
  * limitations under the License.
  */
 
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <climits>
+#include <cstring>
+#include <string>
 #include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include "gtest/gtest.h"
+#include "purgeable_file_builder_c.h"
 #include "purgeable_mem_c.h"
+#include "pm_trace_c.h"
 
 namespace {
 using namespace testing;
@@ -175,6 +185,309 @@ HWTEST_F(PurgeableCTest, ReadWriteTest, TestSize.Level1)
     PurgMemDestroy(pobj);
 }
 
+HWTEST_F(PurgeableCTest, LazyModifyTest, TestSize.Level1)
+{
+    const char alphabet[] = "CCCDEFGHIJKLMNOPQRSTUVWXYZ\0";
+    struct AlphabetInitParam initPara = {'A', 'Z'};
+    struct AlphabetModifyParam a2b = {'A', 'B'};
+    struct AlphabetModifyParam b2c = {'B', 'C'};
+    struct PurgMem *pobj = PurgMemCreate(27, InitAlphabet, &initPara);
+    ASSERT_NE(pobj, nullptr);
+    /* never built, modifies are only logged and content is untouched */
+    ASSERT_TRUE(PurgMemAppendModify(pobj, ModifyAlphabetX2Y, static_cast<void *>(&a2b)));
+    ASSERT_TRUE(PurgMemAppendModify(pobj, ModifyAlphabetX2Y, static_cast<void *>(&b2c)));
+    ASSERT_EQ(static_cast<char *>(PurgMemGetContent(pobj))[0], 0);
+
+    if (PurgMemBeginRead(pobj)) {
+        ASSERT_STREQ(alphabet, static_cast<char *>(PurgMemGetContent(pobj)));
+        PurgMemEndRead(pobj);
+    } else {
+        std::cout << __func__ << ": ERROR! BeginRead failed." << std::endl;
+    }
+
+    PurgMemDestroy(pobj);
+}
+
+static void CountRebuild(struct PurgMem *purgObj, uint64_t generation, void *param)
+{
+    *static_cast<uint64_t *>(param) = generation;
+}
+
+static bool SlowInitAlphabet(void *data, size_t size, void *param)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(10)); /* as costly as a decode */
+    return InitAlphabet(data, size, param);
+}
+
+HWTEST_F(PurgeableCTest, RebuildCostTest, TestSize.Level1)
+{
+    struct AlphabetInitParam initPara = {'A', 'Z'};
+    struct PurgMem *cheap = PurgMemCreate(27, InitAlphabet, &initPara);
+    struct PurgMem *costly = PurgMemCreate(27, SlowInitAlphabet, &initPara);
+    ASSERT_NE(cheap, nullptr);
+    ASSERT_NE(costly, nullptr);
+    EXPECT_EQ(PurgMemGetRebuildCost(cheap), 0);
+    EXPECT_EQ(PurgMemGetRebuildCost(nullptr), 0);
+    ASSERT_TRUE(PurgMemBeginRead(cheap));
+    PurgMemEndRead(cheap);
+    ASSERT_TRUE(PurgMemBeginRead(costly));
+    PurgMemEndRead(costly);
+    EXPECT_GT(PurgMemGetRebuildCost(cheap), 0);
+    EXPECT_GT(PurgMemGetRebuildCost(costly), PurgMemGetRebuildCost(cheap));
+    PurgMemDestroy(cheap);
+    PurgMemDestroy(costly);
+}
+
+HWTEST_F(PurgeableCTest, GenerationTest, TestSize.Level1)
+{
+    struct AlphabetInitParam initPara = {'A', 'Z'};
+    struct PurgMem *pobj = PurgMemCreate(27, InitAlphabet, &initPara);
+    ASSERT_NE(pobj, nullptr);
+    uint64_t notified1 = 0;
+    uint64_t notified2 = 0;
+    EXPECT_FALSE(PurgMemAddRebuildListener(pobj, nullptr, nullptr));
+    ASSERT_TRUE(PurgMemAddRebuildListener(pobj, CountRebuild, &notified1));
+    ASSERT_TRUE(PurgMemAddRebuildListener(pobj, CountRebuild, &notified2));
+    EXPECT_EQ(PurgMemGetGeneration(pobj), 0);
+    EXPECT_EQ(PurgMemGetGeneration(nullptr), 0);
+
+    ASSERT_TRUE(PurgMemBeginRead(pobj));
+    EXPECT_EQ(notified1, 1);
+    EXPECT_EQ(notified2, 1);
+    PurgMemEndRead(pobj);
+    EXPECT_EQ(PurgMemGetGeneration(pobj), 1);
+
+    /* present content is not rebuilt */
+    ASSERT_TRUE(PurgMemBeginRead(pobj));
+    PurgMemEndRead(pobj);
+    EXPECT_EQ(PurgMemGetGeneration(pobj), 1);
+    EXPECT_TRUE(PurgMemRemoveRebuildListener(pobj, CountRebuild, &notified1));
+    EXPECT_FALSE(PurgMemRemoveRebuildListener(pobj, CountRebuild, &notified1));
+    PurgMemDestroy(pobj);
+
+    /* rebuild by write is notified when the write ends */
+    pobj = PurgMemCreate(27, InitAlphabet, &initPara);
+    ASSERT_NE(pobj, nullptr);
+    notified1 = 0;
+    ASSERT_TRUE(PurgMemAddRebuildListener(pobj, CountRebuild, &notified1));
+    ASSERT_TRUE(PurgMemBeginWrite(pobj));
+    EXPECT_EQ(notified1, 0);
+    PurgMemEndWrite(pobj);
+    EXPECT_EQ(notified1, 1);
+    PurgMemDestroy(pobj);
+}
+
+HWTEST_F(PurgeableCTest, ConcurrentReadTest, TestSize.Level1)
+{
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    const int readerNum = 8;
+    const int readLoops = 100000;
+    const int writeLoops = 100;
+    struct AlphabetInitParam initPara = {'A', 'Z'};
+    struct PurgMem *pobj = PurgMemCreate(27, InitAlphabet, &initPara);
+    ASSERT_NE(pobj, nullptr);
+    ASSERT_TRUE(PurgMemBeginRead(pobj));
+    PurgMemEndRead(pobj);
+
+    /* readers never see the content in the middle of a write */
+    std::atomic<int> torn {0};
+    std::atomic<int> failed {0};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> readers;
+    for (int i = 0; i < readerNum; i++) {
+        readers.emplace_back([&] {
+            for (int j = 0; j < readLoops; j++) {
+                if (!PurgMemBeginRead(pobj)) {
+                    failed++;
+                    continue;
+                }
+                if (strncmp(static_cast<char *>(PurgMemGetContent(pobj)), alphabet, 26) != 0) {
+                    torn++;
+                }
+                PurgMemEndRead(pobj);
+            }
+        });
+    }
+    for (int i = 0; i < writeLoops; i++) {
+        ASSERT_TRUE(PurgMemBeginWrite(pobj));
+        char *str = static_cast<char *>(PurgMemGetContent(pobj));
+        memset(str, 'W', 26);
+        std::this_thread::yield();
+        memcpy(str, alphabet, 26);
+        PurgMemEndWrite(pobj);
+    }
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    RecordProperty("readsPerSec", std::to_string(static_cast<long long>(readerNum * readLoops / secs)));
+    EXPECT_EQ(torn.load(), 0);
+    EXPECT_EQ(failed.load(), 0);
+    PurgMemDestroy(pobj);
+}
+
+static int CountTraceEvents(int fd, uint64_t objId, uint16_t event)
+{
+    int count = 0;
+    struct PmTraceChunkHeader header;
+    lseek(fd, 0, SEEK_SET);
+    while (read(fd, &header, sizeof(header)) == sizeof(header)) {
+        EXPECT_EQ(header.magic, PM_TRACE_MAGIC);
+        for (uint32_t i = 0; i < header.count; i++) {
+            struct PmTraceRecord record;
+            if (read(fd, &record, sizeof(record)) != sizeof(record)) {
+                return -1;
+            }
+            if (record.objId == objId && record.event == event) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+/* Return:  tid of the chunk holding records of @objId, 0 if none */
+static uint32_t GetTraceTid(int fd, uint64_t objId)
+{
+    struct PmTraceChunkHeader header;
+    lseek(fd, 0, SEEK_SET);
+    while (read(fd, &header, sizeof(header)) == sizeof(header)) {
+        for (uint32_t i = 0; i < header.count; i++) {
+            struct PmTraceRecord record;
+            if (read(fd, &record, sizeof(record)) != sizeof(record)) {
+                return 0;
+            }
+            if (record.objId == objId) {
+                return header.tid;
+            }
+        }
+    }
+    return 0;
+}
+
+/* @count and @lost: total of all chunks */
+static void SumTraceChunks(int fd, uint32_t &count, uint32_t &lost)
+{
+    struct PmTraceChunkHeader header;
+    count = 0;
+    lost = 0;
+    lseek(fd, 0, SEEK_SET);
+    while (read(fd, &header, sizeof(header)) == sizeof(header)) {
+        count += header.count;
+        lost += header.lost;
+        lseek(fd, sizeof(struct PmTraceRecord) * header.count, SEEK_CUR);
+    }
+}
+
+HWTEST_F(PurgeableCTest, TraceTest, TestSize.Level1)
+{
+    const char *path = "/data/local/tmp/purgeable_trace_test";
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    ASSERT_GE(fd, 0);
+    struct AlphabetInitParam initPara = {'A', 'Z'};
+    struct PurgMem *pobj = PurgMemCreate(27, InitAlphabet, &initPara);
+    ASSERT_NE(pobj, nullptr);
+    uint64_t objId = (uint64_t)PurgMemGetContent(pobj);
+
+    /* nothing is recorded while disabled */
+    EXPECT_FALSE(PmTraceIsEnabled());
+    PmTraceRecord(PM_TRACE_PIN, objId, 1);
+    EXPECT_EQ(PmTraceDump(fd), 0);
+
+    PmTraceSetEnabled(true);
+    ASSERT_TRUE(PurgMemBeginRead(pobj));
+    PurgMemEndRead(pobj);
+    EXPECT_GE(PmTraceDump(fd), 2);
+    EXPECT_EQ(CountTraceEvents(fd, objId, PM_TRACE_REBUILD_BEGIN), 1);
+    EXPECT_EQ(CountTraceEvents(fd, objId, PM_TRACE_REBUILD_END), 1);
+
+    /* records are dumped once, the drain thread dumps the new ones */
+    ASSERT_EQ(ftruncate(fd, 0), 0);
+    lseek(fd, 0, SEEK_SET);
+    ASSERT_TRUE(PmTraceStartDrain(fd, 10)); /* 10: drain interval in ms */
+    EXPECT_FALSE(PmTraceStartDrain(fd, 10));
+    std::thread worker([objId] {
+        for (int i = 0; i < PM_TRACE_RING_SIZE * 2; i++) {
+            PmTraceRecord(PM_TRACE_PIN, objId, 1);
+        }
+    });
+    worker.join();
+    PmTraceStopDrain();
+    PmTraceSetEnabled(false);
+    int pins = CountTraceEvents(fd, objId, PM_TRACE_PIN);
+    EXPECT_GE(pins, PM_TRACE_RING_SIZE - 1); /* the record being written, if any, is never dumped */
+    EXPECT_LE(pins, PM_TRACE_RING_SIZE * 2);
+    EXPECT_EQ(CountTraceEvents(fd, objId, PM_TRACE_REBUILD_BEGIN), 0);
+
+    /* records of an exited thread are dumped under its tid, not the tid of the next thread */
+    ASSERT_EQ(ftruncate(fd, 0), 0);
+    lseek(fd, 0, SEEK_SET);
+    PmTraceSetEnabled(true);
+    uint32_t tids[2] = { 0, 0 };
+    for (int i = 0; i < 2; i++) {
+        std::thread([objId, i, &tids] {
+            tids[i] = (uint32_t)syscall(SYS_gettid);
+            PmTraceRecord(PM_TRACE_PIN, objId + 1 + i, 1);
+        }).join();
+    }
+    PmTraceSetEnabled(false);
+    EXPECT_EQ(PmTraceDump(fd), 2);
+    EXPECT_EQ(GetTraceTid(fd, objId + 1), tids[0]);
+    EXPECT_EQ(GetTraceTid(fd, objId + 2), tids[1]);
+
+    /* rings are capped without any dump, the records of the threads taken over are counted as lost */
+    ASSERT_EQ(ftruncate(fd, 0), 0);
+    lseek(fd, 0, SEEK_SET);
+    PmTraceSetEnabled(true);
+    const uint32_t threadNum = PM_TRACE_MAX_RINGS * 2;
+    for (uint32_t i = 0; i < threadNum; i++) {
+        std::thread([objId] { PmTraceRecord(PM_TRACE_PIN, objId, 1); }).join();
+    }
+    PmTraceSetEnabled(false);
+    EXPECT_GT(PmTraceDump(fd), 0);
+    uint32_t count = 0;
+    uint32_t lost = 0;
+    SumTraceChunks(fd, count, lost);
+    EXPECT_LT(count, PM_TRACE_MAX_RINGS);
+    EXPECT_EQ(count + lost, threadNum);
+
+    PurgMemDestroy(pobj);
+    close(fd);
+    unlink(path);
+}
+
+HWTEST_F(PurgeableCTest, FileRangeBuildTest, TestSize.Level1)
+{
+    const char *path = "/data/local/tmp/purgeable_file_builder_c_test";
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ\0";
+    const uint64_t fileOffset = 5;
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(pwrite(fd, alphabet, sizeof(alphabet) - 1, fileOffset), (ssize_t)(sizeof(alphabet) - 1));
+    struct PurgMemFileRange *range = PurgMemFileRangeCreate(fd, fileOffset);
+    close(fd);
+    ASSERT_NE(range, nullptr);
+    EXPECT_EQ(PurgMemFileRangeCreate(-1, 0), nullptr);
+
+    struct PurgMem *pobj = PurgMemCreate(27, PurgMemFileRangeBuild, range);
+    ASSERT_NE(pobj, nullptr);
+    ASSERT_TRUE(PurgMemBeginRead(pobj));
+    EXPECT_STREQ((char *)PurgMemGetContent(pobj), alphabet);
+    PurgMemEndRead(pobj);
+    EXPECT_EQ(PurgMemFileRangeGetBytesRead(range), 27);
+    PurgMemDestroy(pobj);
+
+    char buf[27] = { 0 };
+    EXPECT_TRUE(PurgMemFileRangeBuildRange(range, buf, sizeof(buf), 3, 2));
+    EXPECT_EQ(buf[3], 'D');
+    EXPECT_EQ(buf[4], 'E');
+    EXPECT_EQ(buf[0], 0);
+    EXPECT_FALSE(PurgMemFileRangeBuildRange(range, buf, sizeof(buf), 26, 2));
+    EXPECT_EQ(PurgMemFileRangeGetBytesRead(range), 29);
+    PurgMemFileRangeDestroy(range);
+    unlink(path);
+}
+
 bool InitData(void *data, size_t size, char start, char end)
 {
     char *str = (char *)data;
@@ -13,7 +13,9 @@
  * limitations under the License.
  */
 
+#include <atomic>
 #include <sys/mman.h>
+#include <unistd.h>
 #include <cstdio>
 #include <thread>
 #include <memory> /* unique_ptr */
@@ -23,7 +25,13 @@
 
 #define private public
 #define protected public
+#include "purgeable_dedup_mem.h"
+#include "purgeable_file_builder.h"
+#include "purgeable_group.h"
 #include "purgeable_mem.h"
+#include "purgeable_mem_monitor.h"
+#include "purgeable_snapshot.h"
+#include "purgeable_worker_pool.h"
 #undef private
 #undef protected
 
@@ -103,6 +111,15 @@ private:
     char to_;
 };
 
+class TestSlowDataBuilder : public PurgeableMemBuilder {
+public:
+    bool Build(void *data, size_t size)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10)); /* as costly as a decode */
+        return true;
+    }
+};
+
 class TestBigDataBuilder : public PurgeableMemBuilder {
 public:
     explicit TestBigDataBuilder(char target)
@@ -133,6 +150,54 @@ private:
     char target_;
 };
 
+class TestSplitDataBuilder : public PurgeableMemBuilder {
+public:
+    bool Build(void *data, size_t size)
+    {
+        return BuildRange(data, size, 0, size);
+    }
+
+    bool IsSplittable() const
+    {
+        return true;
+    }
+
+    bool BuildRange(void *data, size_t size, size_t offset, size_t len)
+    {
+        char *str = static_cast<char *>(data);
+        for (size_t i = offset; i < offset + len; i++) {
+            str[i] = 'A' + (i % 26);
+        }
+        rangeCount_++;
+        return true;
+    }
+
+    std::atomic<int> rangeCount_ {0};
+};
+
+class TestKeyedDataBuilder : public TestBigDataBuilder {
+public:
+    TestKeyedDataBuilder(char target, const std::string &key, std::atomic<int> &buildCount)
+        : TestBigDataBuilder(target), key_(key), buildCount_(buildCount)
+    {
+    }
+
+    bool Build(void *data, size_t size)
+    {
+        buildCount_++;
+        return TestBigDataBuilder::Build(data, size);
+    }
+
+    std::string GetContentKey() const
+    {
+        return key_;
+    }
+
+private:
+    std::string key_;
+    std::atomic<int> &buildCount_;
+};
+
 class PurgeableCppTest : public testing::Test {
 public:
     static void SetUpTestCase();
@@ -488,6 +553,478 @@ HWTEST_F(PurgeableCppTest, ResizeDataTest, TestSize.Level1)
     pobj2 = nullptr;
 }
 
+HWTEST_F(PurgeableCppTest, LazyModifyTest, TestSize.Level1)
+{
+    const char alphabet[] = "CCCDEFGHIJKLMNOPQRSTUVWXYZ\0";
+    std::unique_ptr<PurgeableMemBuilder> builder = std::make_unique<TestDataBuilder>('A', 'Z');
+    PurgeableMem *pobj = new PurgeableMem(27, std::move(builder));
+
+    /* never built, modifiers are only logged and content is untouched */
+    EXPECT_TRUE(pobj->ModifyContentByBuilder(std::make_unique<TestDataModifier>('A', 'B')));
+    EXPECT_TRUE(pobj->ModifyContentByBuilder(std::make_unique<TestDataModifier>('B', 'C')));
+    EXPECT_EQ(static_cast<char *>(pobj->dataPtr_)[0], 0);
+
+    int ret = 1;
+    if (pobj->BeginRead()) {
+        ret = strncmp(alphabet, static_cast<char *>(pobj->GetContent()), 26);
+        pobj->EndRead();
+    }
+    delete pobj;
+    pobj = nullptr;
+    EXPECT_EQ(ret, 0);
+}
+
+HWTEST_F(PurgeableCppTest, SplitBuildTest, TestSize.Level1)
+{
+    size_t size = PARALLEL_BUILD_MIN_SIZE * 2 + 123;
+    std::unique_ptr<PurgeableMemBuilder> builder = std::make_unique<TestSplitDataBuilder>();
+    TestSplitDataBuilder *splitBuilder = static_cast<TestSplitDataBuilder *>(builder.get());
+    PurgeableMem *pobj = new PurgeableMem(size, std::move(builder));
+
+    int ret = 1;
+    if (pobj->BeginRead()) {
+        char *str = static_cast<char *>(pobj->GetContent());
+        ret = 0;
+        for (size_t i = 0; i < size; i++) {
+            if (str[i] != 'A' + (i % 26)) {
+                ret = 1;
+                break;
+            }
+        }
+        pobj->EndRead();
+    }
+    EXPECT_EQ(ret, 0);
+    EXPECT_GE(splitBuilder->rangeCount_.load(), 1);
+    delete pobj;
+    pobj = nullptr;
+}
+
+HWTEST_F(PurgeableCppTest, WorkerPoolTest, TestSize.Level1)
+{
+    PurgeableWorkerPool &pool = PurgeableWorkerPool::GetInstance();
+    EXPECT_GE(pool.GetConcurrency(), 1);
+    std::atomic<size_t> sum {0};
+    EXPECT_TRUE(pool.ParallelFor(100, [&sum](size_t i) {
+        sum += i;
+        return true;
+    }));
+    EXPECT_EQ(sum.load(), 4950);
+    EXPECT_FALSE(pool.ParallelFor(10, [](size_t i) { return i != 5; }));
+    size_t total = 0;
+    EXPECT_TRUE(pool.ParallelForRange(PAGE_SIZE * 3 + 1, PAGE_SIZE, [&total](size_t offset, size_t len) {
+        EXPECT_EQ(offset % PAGE_SIZE, 0);
+        __sync_fetch_and_add(&total, len);
+        return true;
+    }));
+    EXPECT_EQ(total, PAGE_SIZE * 3 + 1);
+}
+
+HWTEST_F(PurgeableCppTest, MonitorShedTest, TestSize.Level1)
+{
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ\0";
+    std::unique_ptr<PurgeableMemBuilder> builder = std::make_unique<TestDataBuilder>('A', 'Z');
+    PurgeableMem *pobj = new PurgeableMem(27, std::move(builder));
+    PurgeableMemMonitor &monitor = PurgeableMemMonitor::GetInstance();
+    ASSERT_TRUE(pobj->BeginRead());
+    pobj->isMonitored_ = monitor.Register(pobj);
+    EXPECT_TRUE(pobj->isMonitored_);
+    /* pinned obj is never shed */
+    EXPECT_EQ(monitor.Shed(PurgeablePressureLevel::FULL), 0);
+    pobj->EndRead();
+    EXPECT_EQ(pobj->pinCount_, 0);
+    /* grace period of NONE level is not expired */
+    EXPECT_EQ(monitor.Shed(PurgeablePressureLevel::NONE), 0);
+    EXPECT_EQ(monitor.Shed(PurgeablePressureLevel::FULL), PAGE_SIZE);
+    EXPECT_EQ(pobj->buildDataCount_, 0);
+
+    int ret = 1;
+    if (pobj->BeginRead()) {
+        ret = strncmp(alphabet, static_cast<char *>(pobj->GetContent()), 26);
+        pobj->EndRead();
+    }
+    EXPECT_EQ(ret, 0);
+    EXPECT_EQ(pobj->buildDataCount_, 1);
+    delete pobj;
+    pobj = nullptr;
+    EXPECT_TRUE(monitor.objs_.empty());
+}
+
+HWTEST_F(PurgeableCppTest, MonitorCallbackTest, TestSize.Level1)
+{
+    PurgeableMemMonitor &monitor = PurgeableMemMonitor::GetInstance();
+    PurgeablePressureLevel notified = PurgeablePressureLevel::NONE;
+    EXPECT_EQ(monitor.RegisterPressureCallback(nullptr), -1);
+    int id = monitor.RegisterPressureCallback([&notified](PurgeablePressureLevel level) { notified = level; });
+    EXPECT_GE(id, 0);
+    monitor.NotifyCallbacks(PurgeablePressureLevel::SOME);
+    EXPECT_EQ(notified, PurgeablePressureLevel::SOME);
+    monitor.UnregisterPressureCallback(id);
+    monitor.NotifyCallbacks(PurgeablePressureLevel::FULL);
+    EXPECT_EQ(notified, PurgeablePressureLevel::SOME);
+
+    PurgeableMemMonitorConfig config;
+    config.someStallUs = 0;
+    config.fullStallUs = 0;
+    EXPECT_FALSE(monitor.Start(config));
+    EXPECT_FALSE(monitor.IsRunning());
+    monitor.Stop();
+}
+
+HWTEST_F(PurgeableCppTest, GenerationTest, TestSize.Level1)
+{
+    std::unique_ptr<PurgeableMemBuilder> builder = std::make_unique<TestDataBuilder>('A', 'Z');
+    PurgeableMem *pobj = new PurgeableMem(27, std::move(builder));
+    uint64_t notified1 = 0;
+    uint64_t notified2 = 0;
+    EXPECT_EQ(pobj->AddRebuildListener(nullptr), -1);
+    int id1 = pobj->AddRebuildListener([&notified1](uint64_t generation) { notified1 = generation; });
+    int id2 = pobj->AddRebuildListener([&notified2](uint64_t generation) { notified2 = generation; });
+    EXPECT_NE(id1, id2);
+    EXPECT_EQ(pobj->GetGeneration(), 0);
+
+    ASSERT_TRUE(pobj->BeginRead());
+    pobj->EndRead();
+    EXPECT_EQ(pobj->GetGeneration(), 1);
+    EXPECT_EQ(notified1, 1);
+    EXPECT_EQ(notified2, 1);
+
+    /* present content is not rebuilt, generation is the same */
+    ASSERT_TRUE(pobj->BeginRead());
+    pobj->EndRead();
+    EXPECT_EQ(pobj->GetGeneration(), 1);
+
+    /* rebuild after purge notifies the remaining listener */
+    EXPECT_TRUE(pobj->RemoveRebuildListener(id1));
+    EXPECT_FALSE(pobj->RemoveRebuildListener(id1));
+    pobj->buildDataCount_ = 0;
+    ASSERT_TRUE(pobj->BeginWrite());
+    pobj->EndWrite();
+    EXPECT_EQ(pobj->GetGeneration(), 2);
+    EXPECT_EQ(notified1, 1);
+    EXPECT_EQ(notified2, 2);
+
+    pobj->ResizeData(PAGE_SIZE + 1);
+    EXPECT_EQ(pobj->GetGeneration(), 3);
+    EXPECT_EQ(notified2, 2);
+    delete pobj;
+    pobj = nullptr;
+}
+
+HWTEST_F(PurgeableCppTest, GroupAccessTest, TestSize.Level1)
+{
+    PurgeableMem obj1(27, std::make_unique<TestDataBuilder>('A', 'Z'));
+    PurgeableMem obj2(27, std::make_unique<TestDataBuilder>('A', 'Z'));
+    PurgeableMem obj3(PAGE_SIZE * 3, std::make_unique<TestBigDataBuilder>('X'));
+    PurgeableGroup group;
+    EXPECT_FALSE(group.Add(nullptr));
+    EXPECT_TRUE(group.Add(&obj3));
+    EXPECT_TRUE(group.Add(&obj1));
+    EXPECT_TRUE(group.Add(&obj2));
+    EXPECT_FALSE(group.Add(&obj1));
+    EXPECT_EQ(group.GetSize(), 3);
+
+    ASSERT_TRUE(group.BeginRead());
+    EXPECT_FALSE(group.BeginRead());
+    EXPECT_FALSE(group.Remove(&obj1));
+    EXPECT_EQ(obj1.pinCount_, 1);
+    EXPECT_EQ(obj3.pinCount_, 1);
+    EXPECT_STREQ(static_cast<char *>(obj2.GetContent()), "ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+    EXPECT_EQ(static_cast<char *>(obj3.GetContent())[PAGE_SIZE], 'X');
+    group.EndAccess();
+    EXPECT_EQ(obj1.pinCount_, 0);
+    EXPECT_EQ(obj3.pinCount_, 0);
+
+    /* only the purged member is rebuilt */
+    obj2.buildDataCount_ = 0;
+    ASSERT_TRUE(group.BeginRead());
+    EXPECT_EQ(obj1.GetGeneration(), 1);
+    EXPECT_EQ(obj2.GetGeneration(), 2);
+    EXPECT_EQ(obj3.GetGeneration(), 1);
+    group.EndAccess();
+
+    /* a member fails, the others are rolled back */
+    obj3.SetDataValid(false);
+    obj1.buildDataCount_ = 0;
+    EXPECT_FALSE(group.BeginRead());
+    EXPECT_EQ(obj1.pinCount_, 0);
+    EXPECT_EQ(obj2.pinCount_, 0);
+    EXPECT_EQ(obj3.pinCount_, 0);
+    EXPECT_TRUE(group.Remove(&obj3));
+    EXPECT_FALSE(group.Remove(&obj3));
+    ASSERT_TRUE(group.BeginWrite());
+    EXPECT_STREQ(static_cast<char *>(obj1.GetContent()), "ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+    group.EndAccess();
+}
+
+HWTEST_F(PurgeableCppTest, RebuildCostShedTest, TestSize.Level1)
+{
+    PurgeableMem cheap(PAGE_SIZE, std::make_unique<TestDataBuilder>('A', 'Z'));
+    PurgeableMem costly(PAGE_SIZE, std::make_unique<TestSlowDataBuilder>());
+    EXPECT_EQ(cheap.GetRebuildCostNsPerByte(), 0);
+    /* access the cheap one first, so it is not the coldest */
+    ASSERT_TRUE(costly.BeginRead());
+    costly.EndRead();
+    ASSERT_TRUE(cheap.BeginRead());
+    cheap.EndRead();
+    EXPECT_GT(cheap.GetRebuildCostNsPerByte(), 0);
+    EXPECT_GT(costly.GetRebuildCostNsPerByte(), cheap.GetRebuildCostNsPerByte());
+    EXPECT_GT(costly.builder_->GetCostNsPerByte(), cheap.builder_->GetCostNsPerByte());
+    EXPECT_LE(costly.builder_->GetCostNsPerByte(), costly.GetRebuildCostNsPerByte());
+
+    PurgeableMemMonitor &monitor = PurgeableMemMonitor::GetInstance();
+    PurgeableMemMonitorConfig oldConfig = monitor.config_;
+    monitor.config_.maxShedBytes = PAGE_SIZE;
+    cheap.isMonitored_ = monitor.Register(&cheap);
+    costly.isMonitored_ = monitor.Register(&costly);
+    EXPECT_EQ(monitor.Shed(PurgeablePressureLevel::FULL), PAGE_SIZE);
+    EXPECT_EQ(cheap.buildDataCount_, 0);
+    EXPECT_EQ(costly.buildDataCount_, 1);
+
+    ASSERT_TRUE(cheap.BeginRead());
+    cheap.EndRead();
+    monitor.config_.shedOrder = PurgeableShedOrder::COLDEST_FIRST;
+    EXPECT_EQ(monitor.Shed(PurgeablePressureLevel::FULL), PAGE_SIZE);
+    EXPECT_EQ(cheap.buildDataCount_, 1);
+    EXPECT_EQ(costly.buildDataCount_, 0);
+    monitor.config_ = oldConfig;
+}
+
+HWTEST_F(PurgeableCppTest, SnapshotRestoreTest, TestSize.Level1)
+{
+    const char *path = "/data/local/tmp/purgeable_snapshot_test";
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ\0";
+    const uint32_t version = 1;
+    {
+        PurgeableMem obj1(27, std::make_unique<TestDataBuilder>('A', 'Z'));
+        PurgeableMem obj2(27, std::make_unique<TestDataBuilder>('A', 'Z'));
+        PurgeableSnapshot snapshot(path, version);
+        EXPECT_TRUE(snapshot.Add("obj1", &obj1));
+        EXPECT_FALSE(snapshot.Add("obj1", &obj2));
+        EXPECT_TRUE(snapshot.Add("obj2", &obj2));
+        ASSERT_TRUE(obj1.BeginRead());
+        obj1.EndRead();
+        EXPECT_EQ(snapshot.Save(), 1); /* obj2 is never built, not saved */
+    }
+
+    /* after restart, content is read from the file, builders with other content are not run */
+    PurgeableMem obj1(27, std::make_unique<TestBigDataBuilder>('X'));
+    PurgeableMem obj2(27, std::make_unique<TestBigDataBuilder>('X'));
+    PurgeableSnapshot snapshot(path, version);
+    EXPECT_TRUE(snapshot.Add("obj1", &obj1));
+    EXPECT_TRUE(snapshot.Add("obj2", &obj2));
+    EXPECT_EQ(PurgeableSnapshot(path, version + 1).Load(), -1);
+    EXPECT_EQ(snapshot.Load(), 1);
+    ASSERT_TRUE(obj1.BeginRead());
+    EXPECT_STREQ(static_cast<char *>(obj1.GetContent()), alphabet);
+    obj1.EndRead();
+    EXPECT_EQ(obj1.builder_->GetCostNsPerByte(), 0);
+    ASSERT_TRUE(obj2.BeginRead());
+    EXPECT_EQ(static_cast<char *>(obj2.GetContent())[0], 'X');
+    obj2.EndRead();
+
+    /* the snapshot is used once, a purged obj is rebuilt by its builders */
+    obj1.buildDataCount_ = 0;
+    ASSERT_TRUE(obj1.BeginRead());
+    EXPECT_EQ(static_cast<char *>(obj1.GetContent())[0], 'X');
+    obj1.EndRead();
+
+    /* corrupted content falls back to the builders */
+    PurgeableMem obj3(27, std::make_unique<TestBigDataBuilder>('Y'));
+    PurgeableSnapshot snapshot3(path, version);
+    EXPECT_TRUE(snapshot3.Add("obj1", &obj3));
+    FILE *f = fopen(path, "r+");
+    ASSERT_NE(f, nullptr);
+    ASSERT_EQ(fseek(f, PAGE_SIZE, SEEK_SET), 0); /* content of the first entry */
+    ASSERT_NE(fputc('Z', f), EOF);
+    fclose(f);
+    EXPECT_EQ(snapshot3.Load(), 1);
+    ASSERT_TRUE(obj3.BeginRead());
+    EXPECT_EQ(static_cast<char *>(obj3.GetContent())[0], 'Y');
+    obj3.EndRead();
+    unlink(path);
+}
+
+HWTEST_F(PurgeableCppTest, UnmeasuredCostShedTest, TestSize.Level1)
+{
+    const char *path = "/data/local/tmp/purgeable_snapshot_cost_test";
+    const uint32_t version = 1;
+    {
+        PurgeableMem obj(PAGE_SIZE, std::make_unique<TestSlowDataBuilder>());
+        PurgeableSnapshot snapshot(path, version);
+        EXPECT_TRUE(snapshot.Add("slow", &obj));
+        ASSERT_TRUE(obj.BeginRead());
+        obj.EndRead();
+        EXPECT_EQ(snapshot.Save(), 1);
+    }
+
+    /* the restored obj is the coldest and its cost is unknown, the measured cheap one is shed first */
+    PurgeableMem restored(PAGE_SIZE, std::make_unique<TestSlowDataBuilder>());
+    PurgeableMem cheap(PAGE_SIZE, std::make_unique<TestDataBuilder>('A', 'Z'));
+    PurgeableSnapshot snapshot(path, version);
+    EXPECT_TRUE(snapshot.Add("slow", &restored));
+    EXPECT_EQ(snapshot.Load(), 1);
+    ASSERT_TRUE(restored.BeginRead());
+    restored.EndRead();
+    ASSERT_TRUE(cheap.BeginRead());
+    cheap.EndRead();
+    EXPECT_EQ(restored.GetRebuildCostNsPerByte(), 0);
+    EXPECT_GT(cheap.GetRebuildCostNsPerByte(), 0);
+
+    PurgeableMemMonitor &monitor = PurgeableMemMonitor::GetInstance();
+    PurgeableMemMonitorConfig oldConfig = monitor.config_;
+    monitor.config_.maxShedBytes = PAGE_SIZE;
+    restored.isMonitored_ = monitor.Register(&restored);
+    cheap.isMonitored_ = monitor.Register(&cheap);
+    EXPECT_EQ(monitor.Shed(PurgeablePressureLevel::FULL), PAGE_SIZE);
+    EXPECT_EQ(cheap.buildDataCount_, 0);
+    EXPECT_EQ(restored.buildDataCount_, 1);
+    monitor.config_ = oldConfig;
+    unlink(path);
+}
+
+HWTEST_F(PurgeableCppTest, FileRangeBuildTest, TestSize.Level1)
+{
+    const char *path = "/data/local/tmp/purgeable_file_builder_test";
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ\0";
+    const uint64_t fileOffset = 5;
+    FILE *f = fopen(path, "w");
+    ASSERT_NE(f, nullptr);
+    ASSERT_EQ(fwrite("#####", 1, fileOffset, f), fileOffset);
+    ASSERT_EQ(fwrite(alphabet, 1, sizeof(alphabet) - 1, f), sizeof(alphabet) - 1);
+    fclose(f);
+
+    std::unique_ptr<FileRangeBuilder> builder = std::make_unique<FileRangeBuilder>(path, fileOffset);
+    FileRangeBuilder *fileBuilder = builder.get();
+    ASSERT_TRUE(fileBuilder->IsValid());
+    PurgeableMem obj(27, std::move(builder));
+    ASSERT_TRUE(obj.BeginRead());
+    EXPECT_STREQ(static_cast<char *>(obj.GetContent()), alphabet);
+    obj.EndRead();
+    EXPECT_EQ(fileBuilder->GetBytesRead(), 27);
+
+    /* a range is read alone, the rest of the content is untouched */
+    char buf[27] = { 0 };
+    EXPECT_TRUE(fileBuilder->BuildRange(buf, sizeof(buf), 3, 2));
+    EXPECT_EQ(buf[3], 'D');
+    EXPECT_EQ(buf[4], 'E');
+    EXPECT_EQ(buf[0], 0);
+    EXPECT_EQ(fileBuilder->GetBytesRead(), 29);
+    EXPECT_FALSE(fileBuilder->BuildRange(buf, sizeof(buf), 26, 2));
+
+    /* copied into a target fd, or read if the kernel cannot copy between them */
+    int memFd = memfd_create("purgeable_file_builder_test", MFD_CLOEXEC);
+    ASSERT_GE(memFd, 0);
+    ASSERT_EQ(ftruncate(memFd, PAGE_SIZE), 0);
+    void *mapped = mmap(nullptr, PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+    ASSERT_NE(mapped, MAP_FAILED);
+    fileBuilder->SetTargetFd(memFd, mapped);
+    EXPECT_TRUE(fileBuilder->Build(mapped, 27));
+    EXPECT_STREQ(static_cast<char *>(mapped), alphabet);
+    EXPECT_EQ(fileBuilder->GetBytesRead(), 56);
+
+    /* a build into another buffer is read into it, the target fd is untouched */
+    static_cast<char *>(mapped)[0] = 0;
+    char other[27] = { 0 };
+    EXPECT_TRUE(fileBuilder->Build(other, sizeof(other)));
+    EXPECT_STREQ(other, alphabet);
+    EXPECT_EQ(static_cast<char *>(mapped)[0], 0);
+    EXPECT_EQ(fileBuilder->GetBytesRead(), 83);
+    munmap(mapped, PAGE_SIZE);
+    close(memFd);
+
+    /* a file too short for the content fails the build */
+    PurgeableMem shortObj(27, std::make_unique<FileRangeBuilder>(path, fileOffset + 1));
+    EXPECT_FALSE(shortObj.BeginRead());
+    EXPECT_FALSE(FileRangeBuilder("/data/local/tmp/purgeable_file_builder_none", 0).IsValid());
+    unlink(path);
+}
+
+HWTEST_F(PurgeableCppTest, DedupShareTest, TestSize.Level1)
+{
+    std::atomic<int> buildCount {0};
+    size_t regionCount = PurgeableDedupRegistry::GetInstance().GetRegionCount();
+    {
+        PurgeableDedupMem obj1(27, std::make_unique<TestKeyedDataBuilder>('A', "icon", buildCount));
+        PurgeableDedupMem obj2(27, std::make_unique<TestKeyedDataBuilder>('A', "icon", buildCount));
+        PurgeableDedupMem obj3(27, std::make_unique<TestKeyedDataBuilder>('A', "", buildCount));
+        EXPECT_TRUE(obj1.IsShared());
+        EXPECT_TRUE(obj2.IsShared());
+        EXPECT_FALSE(obj3.IsShared());
+        EXPECT_EQ(PurgeableDedupRegistry::GetInstance().GetRegionCount(), regionCount + 1);
+
+        /* equal content is built once and shared */
+        ASSERT_TRUE(obj1.BeginRead());
+        ASSERT_TRUE(obj2.BeginRead());
+        EXPECT_EQ(obj1.GetContent(), obj2.GetContent());
+        EXPECT_EQ(static_cast<char *>(obj2.GetContent())[0], 'A');
+        EXPECT_EQ(buildCount.load(), 1);
+        obj1.EndRead();
+        obj2.EndRead();
+
+        /* shared content is not purged while pinned, and rebuilt once after purge */
+        ASSERT_TRUE(obj2.BeginRead());
+        EXPECT_EQ(obj1.PurgeIfIdle(PurgeableMemBase::NowMs()), 0);
+        obj2.EndRead();
+        EXPECT_GT(obj1.PurgeIfIdle(PurgeableMemBase::NowMs()), 0);
+        ASSERT_TRUE(obj2.BeginRead());
+        obj2.EndRead();
+        ASSERT_TRUE(obj1.BeginRead());
+        EXPECT_EQ(buildCount.load(), 2);
+        EXPECT_FALSE(obj1.BeginWrite()); /* shared content is being read */
+        obj1.EndRead();
+
+        /* write copies the content, the other obj keeps the shared one */
+        ASSERT_TRUE(obj2.BeginWrite());
+        EXPECT_FALSE(obj2.IsShared());
+        EXPECT_NE(obj1.GetContent(), obj2.GetContent());
+        char *str = static_cast<char *>(obj2.GetContent());
+        EXPECT_EQ(str[0], 'A');
+        str[0] = 'Z';
+        obj2.EndWrite();
+        EXPECT_EQ(buildCount.load(), 2);
+        ASSERT_TRUE(obj1.BeginRead());
+        EXPECT_EQ(static_cast<char *>(obj1.GetContent())[0], 'A');
+        obj1.EndRead();
+    }
+    EXPECT_EQ(PurgeableDedupRegistry::GetInstance().GetRegionCount(), regionCount);
+}
+
+HWTEST_F(PurgeableCppTest, GroupWriteDedupTest, TestSize.Level1)
+{
+    std::atomic<int> buildCount {0};
+    PurgeableDedupMem obj1(27, std::make_unique<TestKeyedDataBuilder>('A', "group_icon", buildCount));
+    PurgeableDedupMem obj2(27, std::make_unique<TestKeyedDataBuilder>('A', "group_icon", buildCount));
+    PurgeableGroup group;
+    ASSERT_TRUE(group.Add(&obj1));
+
+    /* read through the group keeps the content shared */
+    ASSERT_TRUE(group.BeginRead());
+    EXPECT_TRUE(obj1.IsShared());
+    group.EndAccess();
+
+    /* write through the group copies the content first, the other obj keeps the shared one */
+    ASSERT_TRUE(group.BeginWrite());
+    EXPECT_FALSE(obj1.IsShared());
+    EXPECT_TRUE(obj2.IsShared());
+    EXPECT_EQ(obj1.pinCount_, 1);
+    char *str = static_cast<char *>(obj1.GetContent());
+    EXPECT_EQ(str[0], 'A');
+    str[0] = 'Z';
+    group.EndAccess();
+    EXPECT_EQ(obj1.pinCount_, 0);
+    ASSERT_TRUE(obj2.BeginRead());
+    EXPECT_EQ(static_cast<char *>(obj2.GetContent())[0], 'A');
+    obj2.EndRead();
+
+    /* a shared member being read cannot be copied, the group is rolled back */
+    EXPECT_TRUE(group.Add(&obj2));
+    ASSERT_TRUE(obj2.BeginRead());
+    EXPECT_FALSE(group.BeginWrite());
+    EXPECT_EQ(obj1.pinCount_, 0);
+    EXPECT_EQ(obj2.pinCount_, 1);
+    obj2.EndRead();
+}
+
 void LoopPrintAlphabet(PurgeableMem *pdata, unsigned int loopCount)
 {
     std::cout << "inter " << __func__ << std::endl;
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory> /* unique_ptr */
+#include "gtest/gtest.h"
+#include "pm_util.h"
+
+#include "purgeable_ashmem.h"
+#include "purgeable_mem.h"
+#include "purgeable_static_mem.h"
+
+namespace OHOS {
+namespace PurgeableMem {
+using namespace testing;
+using namespace testing::ext;
+
+static constexpr size_t SMALL_OBJ_SIZE = 64;
+static constexpr int BENCH_LOOP_TIMES = 200000;
+
+class TestAlphabetBuilder : public PurgeableMemBuilder {
+public:
+    bool Build(void *data, size_t size)
+    {
+        char *str = static_cast<char *>(data);
+        for (size_t i = 0; i + 1 < size; i++) {
+            str[i] = static_cast<char>('A' + i % 26); /* 26 letters */
+        }
+        str[size - 1] = 0;
+        buildTimes_++;
+        return true;
+    }
+
+    int buildTimes_ = 0;
+};
+
+class TestUpperToLowerModifier : public PurgeableMemBuilder {
+public:
+    bool Build(void *data, size_t size)
+    {
+        char *str = static_cast<char *>(data);
+        for (size_t i = 0; i < size && str[i]; i++) {
+            if (str[i] >= 'A' && str[i] <= 'Z') {
+                str[i] = static_cast<char>(str[i] - 'A' + 'a');
+            }
+        }
+        return true;
+    }
+};
+
+class PurgeableStaticMemTest : public testing::Test {
+public:
+    static void SetUpTestCase();
+    static void TearDownTestCase();
+    void SetUp();
+    void TearDown();
+};
+
+void PurgeableStaticMemTest::SetUpTestCase()
+{
+}
+
+void PurgeableStaticMemTest::TearDownTestCase()
+{
+}
+
+void PurgeableStaticMemTest::SetUp()
+{
+}
+
+void PurgeableStaticMemTest::TearDown()
+{
+}
+
+template <typename T>
+static void ReadWriteCheck(T &pobj)
+{
+    ASSERT_TRUE(pobj.BeginRead());
+    EXPECT_STREQ(static_cast<char *>(pobj.GetContent()), "ABCDEFGHIJKLMNOPQRSTUVWXY");
+    pobj.EndRead();
+
+    ASSERT_TRUE(pobj.BeginWrite());
+    EXPECT_TRUE(pobj.ModifyContentByBuilder(std::make_unique<TestUpperToLowerModifier>()));
+    EXPECT_STREQ(static_cast<char *>(pobj.GetContent()), "abcdefghijklmnopqrstuvwxy");
+    pobj.EndWrite();
+}
+
+template <typename T>
+static int64_t BenchAccessNs(T &pobj)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_LOOP_TIMES; i++) {
+        if (pobj.BeginRead()) {
+            pobj.EndRead();
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / BENCH_LOOP_TIMES;
+}
+
+HWTEST_F(PurgeableStaticMemTest, EmulatedReadWriteTest, TestSize.Level1)
+{
+    StaticEmulatedPurgeableMem pobj(26, std::make_unique<TestAlphabetBuilder>()); /* 26 letters */
+    ReadWriteCheck(pobj);
+}
+
+HWTEST_F(PurgeableStaticMemTest, UxptReadWriteTest, TestSize.Level1)
+{
+    StaticPurgeableMem pobj(26, std::make_unique<TestAlphabetBuilder>()); /* 26 letters */
+    ReadWriteCheck(pobj);
+}
+
+HWTEST_F(PurgeableStaticMemTest, AshmemReadWriteTest, TestSize.Level1)
+{
+    StaticPurgeableAshMem pobj(26, std::make_unique<TestAlphabetBuilder>()); /* 26 letters */
+    EXPECT_GE(pobj.GetBackend().GetFd(), 0);
+    ReadWriteCheck(pobj);
+}
+
+HWTEST_F(PurgeableStaticMemTest, MemfdReadWriteTest, TestSize.Level1)
+{
+    StaticPurgeableMemfdMem pobj(26, std::make_unique<TestAlphabetBuilder>()); /* 26 letters */
+    int fd = pobj.GetBackend().GetFd();
+    ASSERT_GE(fd, 0);
+    ReadWriteCheck(pobj);
+    EXPECT_FALSE(MemfdPolicy::IsFdRangePurged(fd, 0, PAGE_SIZE));
+    EXPECT_TRUE(pobj.Purge());
+    EXPECT_TRUE(MemfdPolicy::IsFdRangePurged(fd, 0, PAGE_SIZE));
+    ASSERT_TRUE(pobj.BeginRead());
+    EXPECT_EQ(static_cast<char *>(pobj.GetContent())[0], 'a');
+    pobj.EndRead();
+}
+
+HWTEST_F(PurgeableStaticMemTest, PurgeRebuildTest, TestSize.Level1)
+{
+    std::unique_ptr<TestAlphabetBuilder> builder = std::make_unique<TestAlphabetBuilder>();
+    TestAlphabetBuilder *rawBuilder = builder.get();
+    StaticEmulatedPurgeableMem pobj(26, std::move(builder)); /* 26 letters */
+    EXPECT_FALSE(pobj.Purge()); /* never built */
+    ASSERT_TRUE(pobj.BeginRead());
+    EXPECT_FALSE(pobj.Purge()); /* pinned */
+    pobj.EndRead();
+    EXPECT_TRUE(pobj.Purge());
+    EXPECT_EQ(static_cast<char *>(pobj.GetContent())[0], 0);
+
+    /* modify on purged content is replayed on rebuild */
+    EXPECT_TRUE(pobj.ModifyContentByBuilder(std::make_unique<TestUpperToLowerModifier>()));
+    ASSERT_TRUE(pobj.BeginRead());
+    EXPECT_STREQ(static_cast<char *>(pobj.GetContent()), "abcdefghijklmnopqrstuvwxy");
+    pobj.EndRead();
+    EXPECT_EQ(rawBuilder->buildTimes_, 2); /* built, purged and rebuilt */
+}
+
+HWTEST_F(PurgeableStaticMemTest, InvalidInputTest, TestSize.Level1)
+{
+    StaticEmulatedPurgeableMem pobj1(0, std::make_unique<TestAlphabetBuilder>());
+    EXPECT_FALSE(pobj1.BeginRead());
+    EXPECT_EQ(pobj1.GetContent(), nullptr);
+    StaticEmulatedPurgeableMem pobj2(SMALL_OBJ_SIZE, nullptr);
+    EXPECT_FALSE(pobj2.BeginWrite());
+    EXPECT_FALSE(pobj2.ModifyContentByBuilder(nullptr));
+    StaticEmulatedPurgeableMem pobj3(OHOS_MAXIMUM_PURGEABLE_MEMORY, std::make_unique<TestAlphabetBuilder>());
+    EXPECT_FALSE(pobj3.BeginRead());
+    pobj3.EndRead();
+}
+
+HWTEST_F(PurgeableStaticMemTest, SmallObjAccessBenchmark, TestSize.Level1)
+{
+    PurgeableMem uxptObj(SMALL_OBJ_SIZE, std::make_unique<TestAlphabetBuilder>());
+    StaticPurgeableMem uxptStaticObj(SMALL_OBJ_SIZE, std::make_unique<TestAlphabetBuilder>());
+    PurgeableAshMem ashObj(SMALL_OBJ_SIZE, std::make_unique<TestAlphabetBuilder>());
+    StaticPurgeableAshMem ashStaticObj(SMALL_OBJ_SIZE, std::make_unique<TestAlphabetBuilder>());
+    StaticEmulatedPurgeableMem emuStaticObj(SMALL_OBJ_SIZE, std::make_unique<TestAlphabetBuilder>());
+
+    /* build content before timing */
+    ASSERT_TRUE(uxptObj.BeginRead());
+    uxptObj.EndRead();
+    ASSERT_TRUE(uxptStaticObj.BeginRead());
+    uxptStaticObj.EndRead();
+    ASSERT_TRUE(ashObj.BeginRead());
+    ashObj.EndRead();
+    ASSERT_TRUE(ashStaticObj.BeginRead());
+    ashStaticObj.EndRead();
+    ASSERT_TRUE(emuStaticObj.BeginRead());
+    emuStaticObj.EndRead();
+
+    std::cout << "BeginRead/EndRead of " << SMALL_OBJ_SIZE << " bytes obj, ns per access:" << std::endl;
+    std::cout << "  uxpt   virtual: " << BenchAccessNs(uxptObj) <<
+        ", static: " << BenchAccessNs(uxptStaticObj) << std::endl;
+    std::cout << "  ashmem virtual: " << BenchAccessNs(ashObj) <<
+        ", static: " << BenchAccessNs(ashStaticObj) << std::endl;
+    std::cout << "  emulated static: " << BenchAccessNs(emuStaticObj) << std::endl;
+}
+} /* namespace PurgeableMem */
+} /* namespace OHOS */
@@ -13,11 +13,14 @@
  * limitations under the License.
  */
 
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <cstring>
 #include <memory>
 #include <sys/mman.h>
 #include <sys/ioctl.h>
+#include <sys/wait.h>
 #include <thread>
 #include <unistd.h>
 
@@ -140,6 +143,27 @@ private:
     char target_;
 };
 
+class TestCountingBuilder : public PurgeableMemBuilder {
+public:
+    explicit TestCountingBuilder(int delayMs) : delayMs_(delayMs) {}
+
+    bool Build(void *data, size_t size)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(delayMs_));
+        if (memset_s(data, size, 'S', size) != EOK) {
+            return false;
+        }
+        static_cast<char *>(data)[size - 1] = 0;
+        buildTimes_++;
+        return true;
+    }
+
+    std::atomic<int> buildTimes_ {0};
+
+private:
+    int delayMs_;
+};
+
 class PurgeableAshmemTest : public testing::Test {
 public:
     static void SetUpTestCase();
@@ -636,6 +660,218 @@ HWTEST_F(PurgeableAshmemTest, GetContentSizeTest, TestSize.Level1)
     EXPECT_NE(pobj.GetAshmemFd(), -1);
 }
 
+HWTEST_F(PurgeableAshmemTest, MemfdPurgeTest, TestSize.Level1)
+{
+    std::unique_ptr<PurgeableMemBuilder> builder1 = std::make_unique<TestDataBuilder>('A', 'Z');
+    PurgeableAshMem pobj(27, std::move(builder1));
+    if (!pobj.isMemfd_) {
+        return; /* purgeable ashmem is supported, covered by the tests above */
+    }
+    ASSERT_TRUE(pobj.BeginRead());
+    EXPECT_STREQ(static_cast<char *>(pobj.GetContent()), "ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+    pobj.EndRead();
+    EXPECT_FALSE(pobj.IsPurged());
+
+    EXPECT_TRUE(pobj.DropContent());
+    EXPECT_TRUE(pobj.IsPurged());
+    ASSERT_TRUE(pobj.BeginRead());
+    EXPECT_STREQ(static_cast<char *>(pobj.GetContent()), "ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+    pobj.EndRead();
+    EXPECT_FALSE(pobj.IsPurged());
+
+    /* purge is detected per range */
+    size_t size = 3 * PAGE_SIZE;
+    int fd = MemfdPolicy::CreateFd("MemfdPurgeTest", size);
+    ASSERT_GE(fd, 0);
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ASSERT_NE(data, MAP_FAILED);
+    EXPECT_EQ(memset_s(data, size, 'A', size), EOK);
+    EXPECT_FALSE(MemfdPolicy::IsFdRangePurged(fd, 0, size));
+    EXPECT_TRUE(MemfdPolicy::PunchFdRange(fd, PAGE_SIZE, PAGE_SIZE));
+    EXPECT_FALSE(MemfdPolicy::IsFdRangePurged(fd, 0, PAGE_SIZE));
+    EXPECT_TRUE(MemfdPolicy::IsFdRangePurged(fd, PAGE_SIZE, PAGE_SIZE));
+    EXPECT_FALSE(MemfdPolicy::IsFdRangePurged(fd, 2 * PAGE_SIZE, PAGE_SIZE));
+    EXPECT_TRUE(MemfdPolicy::IsFdRangePurged(fd, 0, size));
+    EXPECT_EQ(static_cast<char *>(data)[PAGE_SIZE], 0);
+    munmap(data, size);
+    close(fd);
+}
+
+HWTEST_F(PurgeableAshmemTest, MemfdShareTest, TestSize.Level1)
+{
+    std::unique_ptr<PurgeableMemBuilder> builder1 = std::make_unique<TestDataBuilder>('A', 'Z');
+    std::unique_ptr<PurgeableMemBuilder> builder2 = std::make_unique<TestDataBuilder>('A', 'Z');
+    PurgeableAshMem owner(27, std::move(builder1));
+    if (!owner.isMemfd_) {
+        return;
+    }
+    ASSERT_TRUE(owner.BeginRead());
+    owner.EndRead();
+
+    /* a consumer maps the shared fd as it would after receiving it from the owner */
+    size_t size = ((owner.GetContentSize() + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+    int fd = dup(owner.GetAshmemFd());
+    ASSERT_GE(fd, 0);
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ASSERT_NE(data, MAP_FAILED);
+    PurgeableAshMem consumer(std::move(builder2));
+    EXPECT_TRUE(consumer.ChangeAshmemData(owner.GetContentSize(), fd, data));
+    EXPECT_TRUE(consumer.isMemfd_);
+    EXPECT_FALSE(consumer.IsPurged());
+    ASSERT_TRUE(consumer.BeginRead());
+    EXPECT_STREQ(static_cast<char *>(consumer.GetContent()), "ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+    consumer.EndRead();
+
+    /* purge by owner is seen by consumer */
+    EXPECT_TRUE(owner.DropContent());
+    EXPECT_TRUE(consumer.IsPurged());
+    ASSERT_TRUE(consumer.BeginRead());
+    EXPECT_STREQ(static_cast<char *>(consumer.GetContent()), "ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+    consumer.EndRead();
+    EXPECT_FALSE(owner.IsPurged());
+    munmap(data, size);
+    close(fd);
+}
+
+HWTEST_F(PurgeableAshmemTest, SharedRebuildOnceTest, TestSize.Level1)
+{
+    constexpr int rebuildDelayMs = 200;
+    std::unique_ptr<TestCountingBuilder> builder1 = std::make_unique<TestCountingBuilder>(rebuildDelayMs);
+    std::unique_ptr<TestCountingBuilder> builder2 = std::make_unique<TestCountingBuilder>(rebuildDelayMs);
+    TestCountingBuilder *ownerBuilder = builder1.get();
+    TestCountingBuilder *consumerBuilder = builder2.get();
+    PurgeableAshMem owner(27, std::move(builder1), true);
+    if (!owner.isMemfd_) {
+        return; /* a kernel purge of ashmem is not triggered from the test */
+    }
+    ASSERT_TRUE(owner.sharedCtrl_.IsAttached());
+    ASSERT_TRUE(owner.BeginRead());
+    owner.EndRead();
+    EXPECT_EQ(owner.GetSharedGeneration(), 1u);
+
+    size_t size = ((owner.GetContentSize() + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+    int fd = dup(owner.GetAshmemFd());
+    ASSERT_GE(fd, 0);
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ASSERT_NE(data, MAP_FAILED);
+    /* the control block is only used by a consumer opting in */
+    PurgeableAshMem plain(std::make_unique<TestDataBuilder>('A', 'Z'));
+    EXPECT_TRUE(plain.ChangeAshmemData(owner.GetContentSize(), fd, data));
+    EXPECT_FALSE(plain.sharedCtrl_.IsAttached());
+    PurgeableAshMem consumer(std::move(builder2));
+    EXPECT_TRUE(consumer.ChangeAshmemData(owner.GetContentSize(), fd, data, true));
+    EXPECT_TRUE(consumer.sharedCtrl_.IsAttached());
+    EXPECT_EQ(consumer.GetSharedGeneration(), 1u);
+
+    /* both see the purge, the consumer waits for the owner's rebuild instead of building */
+    EXPECT_TRUE(owner.DropContent());
+    std::thread ownerThread([&owner] {
+        if (owner.BeginRead()) {
+            owner.EndRead();
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(rebuildDelayMs / 4)); /* owner is rebuilding */
+    ASSERT_TRUE(consumer.BeginRead());
+    EXPECT_EQ(static_cast<char *>(consumer.GetContent())[0], 'S');
+    consumer.EndRead();
+    ownerThread.join();
+    EXPECT_EQ(ownerBuilder->buildTimes_.load(), 2);
+    EXPECT_EQ(consumerBuilder->buildTimes_.load(), 0);
+    EXPECT_EQ(consumer.GetSharedGeneration(), 2u);
+
+    /* the consumer rebuilds alone when it is the first to access */
+    EXPECT_TRUE(owner.DropContent());
+    ASSERT_TRUE(consumer.BeginRead());
+    consumer.EndRead();
+    ASSERT_TRUE(owner.BeginRead());
+    owner.EndRead();
+    EXPECT_EQ(ownerBuilder->buildTimes_.load(), 2);
+    EXPECT_EQ(consumerBuilder->buildTimes_.load(), 1);
+    EXPECT_EQ(owner.GetSharedGeneration(), 3u);
+    munmap(data, size);
+    close(fd);
+}
+
+HWTEST_F(PurgeableAshmemTest, SharedRebuildNotReservedTest, TestSize.Level1)
+{
+    PurgeableAshMem owner(27, std::make_unique<TestDataBuilder>('A', 'Z'));
+    EXPECT_FALSE(owner.sharedCtrl_.IsAttached());
+    EXPECT_EQ(owner.GetSharedGeneration(), 0u);
+
+    /* a consumer of an fd without control block rebuilds on its own */
+    size_t size = ((owner.GetContentSize() + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+    int fd = dup(owner.GetAshmemFd());
+    ASSERT_GE(fd, 0);
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ASSERT_NE(data, MAP_FAILED);
+    PurgeableAshMem consumer(std::make_unique<TestDataBuilder>('A', 'Z'));
+    EXPECT_TRUE(consumer.ChangeAshmemData(owner.GetContentSize(), fd, data, true));
+    EXPECT_FALSE(consumer.sharedCtrl_.IsAttached());
+    ASSERT_TRUE(consumer.BeginRead());
+    consumer.EndRead();
+    munmap(data, size);
+    close(fd);
+}
+
+HWTEST_F(PurgeableAshmemTest, SharedCtrlRebuilderDiedTest, TestSize.Level1)
+{
+    int fd = MemfdPolicy::CreateFd("SharedCtrlTest", PurgeableSharedCtrl::GetCtrlSize());
+    ASSERT_GE(fd, 0);
+    PurgeableSharedCtrl ctrl;
+    EXPECT_FALSE(ctrl.Attach(fd, 0, false));
+    EXPECT_FALSE(ctrl.IsAttached());
+    ASSERT_TRUE(ctrl.Attach(fd, 0, true));
+
+    /* a child becomes the rebuilder and exits without ending the rebuild */
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        PurgeableSharedCtrl childCtrl;
+        _exit(childCtrl.Attach(fd, 0, false) && childCtrl.BeginRebuild() ? 0 : 1);
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    /* the waiter takes over instead of sleeping forever */
+    EXPECT_TRUE(ctrl.BeginRebuild());
+    ctrl.EndRebuild(true);
+    EXPECT_EQ(ctrl.GetGeneration(), 1u);
+    ctrl.Detach();
+    EXPECT_FALSE(ctrl.IsAttached());
+    close(fd);
+}
+
+HWTEST_F(PurgeableAshmemTest, SharedPinTest, TestSize.Level1)
+{
+    PurgeableAshMem owner(27, std::make_unique<TestDataBuilder>('A', 'Z'), true);
+    if (!owner.isMemfd_) {
+        return; /* ashmem pins are shared by the kernel */
+    }
+    ASSERT_TRUE(owner.BeginRead());
+    owner.EndRead();
+
+    size_t size = ((owner.GetContentSize() + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+    int fd = dup(owner.GetAshmemFd());
+    ASSERT_GE(fd, 0);
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ASSERT_NE(data, MAP_FAILED);
+    PurgeableAshMem consumer(std::make_unique<TestDataBuilder>('A', 'Z'));
+    EXPECT_TRUE(consumer.ChangeAshmemData(owner.GetContentSize(), fd, data, true));
+    ASSERT_TRUE(consumer.sharedCtrl_.IsAttached());
+
+    /* the owner does not punch content pinned by the consumer */
+    ASSERT_TRUE(consumer.BeginRead());
+    EXPECT_FALSE(owner.DropContent());
+    EXPECT_FALSE(consumer.IsPurged());
+    EXPECT_STREQ(static_cast<char *>(consumer.GetContent()), "ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+    consumer.EndRead();
+    EXPECT_TRUE(owner.DropContent());
+    EXPECT_TRUE(consumer.IsPurged());
+    munmap(data, size);
+    close(fd);
+}
+
 void LoopPrintAlphabet(PurgeableAshMem *pdata, unsigned int loopCount)
 {
     std::cout << "inter " << __func__ << std::endl;